@@ -9,6 +9,7 @@
 #include "IO/DIM/CommandManager.hpp"
 #include "IO/DSP/DSPExNodeSession.hpp"
 #include "file_logger.hpp"
+#include "io/kernel32_io_backend.hpp"
 
 #include "clr_host.hpp"
 #include "TrinketNatives.hpp"
@@ -23,6 +24,8 @@
 #include "Subsystems/KernelSubsystem.hpp"
 #include "Subsystems/Direct3D9Subsystem.hpp"
 #include "SystemState.hpp"
+#include "thread_pool.hpp"
+#include "vfm/vfm_read_ahead.hpp"
 #include "vfm/vfm_reader.hpp"
 
 using namespace dargon;
@@ -71,13 +74,29 @@ void Application::Initialize(std::shared_ptr<const bootstrap_context> context) {
    auto dtp_session = context->dtp_session;
    auto logger = context->logger;
 
-   // initialize libvfm dependencies
-   auto sector_factory = std::make_shared<vfm_sector_factory>(io_proxy);
-   auto vfm_reader = std::make_shared<dargon::vfm_reader>(sector_factory);
-
    // load configuration
    auto configuration = Configuration::Parse(flags, properties);
 
+   // initialize libvfm dependencies
+   auto vfm_io = std::make_shared<kernel32_io_backend>(io_proxy);
+   auto handle_cache_capacity = static_cast<size_t>(configuration->GetIntegerProperty(Configuration::VfmHandleCacheCapacityKey, vfm_handle_cache::kDefaultCapacity));
+   auto handle_cache = std::make_shared<vfm_handle_cache>(vfm_io, handle_cache_capacity);
+   auto block_cache_budget = configuration->GetIntegerProperty(Configuration::VfmBlockCacheBudgetKey, vfm_block_cache::kDefaultBudget);
+   auto block_cache = block_cache_budget > 0 ? std::make_shared<vfm_block_cache>(block_cache_budget) : nullptr;
+   auto io_thread_count = static_cast<size_t>(configuration->GetIntegerProperty(Configuration::VfmIoThreadCountKey, thread_pool::kDefaultThreadCount));
+   auto io_thread_pool = std::make_shared<thread_pool>(io_thread_count);
+   auto mapping_budget = configuration->GetIntegerProperty(Configuration::VfmMappingBudgetKey, vfm_mapping_cache::kDefaultBudget);
+   auto mapping_cache = std::make_shared<vfm_mapping_cache>(vfm_io, mapping_budget);
+   auto sector_factory = std::make_shared<vfm_sector_factory>(vfm_io, handle_cache, block_cache, mapping_cache);
+   // content sharing reads and hashes backing files, so it's opt-in
+   sector_factory->enable_content_sharing(configuration->GetIntegerProperty(Configuration::VfmContentSharingMaxLengthKey, 0), io_thread_pool);
+   auto vfm_reader = std::make_shared<dargon::vfm_reader>(vfm_io, sector_factory);
+   auto parallel_read_threshold = configuration->GetIntegerProperty(Configuration::VfmParallelReadThresholdKey, vfm_file::kDefaultMinParallelReadLength);
+   if (parallel_read_threshold > 0) {
+      vfm_reader->set_parallel_reads(io_thread_pool, parallel_read_threshold);
+   }
+   auto read_ahead_max_window = configuration->GetIntegerProperty(Configuration::VfmReadAheadMaxWindowKey, vfm_read_ahead::kDefaultMaxWindow);
+
    // boot up the clr
    auto trinketNatives = std::make_shared<TrinketNatives>();
    trinketNatives->startCanary = TRINKET_NATIVES_START_CANARY;
@@ -117,10 +136,15 @@ void Application::Initialize(std::shared_ptr<const bootstrap_context> context) {
    auto file_redirection_command_handler = std::make_shared<FileRedirectionCommandHandler>(command_manager, file_subsystem, redirected_file_operation_proxy_factory_factory);
    file_redirection_command_handler->Initialize();
 
-   auto remapped_file_operation_proxy_factory_factory = std::make_shared<RemappedFileOperationProxyFactoryFactory>(io_proxy, vfm_reader);
+   auto remapped_file_operation_proxy_factory_factory = std::make_shared<RemappedFileOperationProxyFactoryFactory>(io_proxy, vfm_reader, io_thread_pool, read_ahead_max_window);
    auto file_remapping_command_handler = std::make_shared<FileRemappingCommandHandler>(command_manager, file_subsystem, remapped_file_operation_proxy_factory_factory);
    file_remapping_command_handler->Initialize();
 
+   // command lists, initial or reloaded, replace every file override at once
+   command_manager->SetReloadScope([file_subsystem](const std::function<void()>& reprocess) {
+      file_subsystem->ReloadFileOverrides(reprocess);
+   });
+
    // initialize command manager
    command_manager->Initialize();
 
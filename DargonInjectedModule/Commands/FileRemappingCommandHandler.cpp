@@ -40,7 +40,23 @@ void FileRemappingCommandHandler::ProcessCommands(DIMHandlerToCommandsMap::itera
       reader.read_bytes(vfmPath, vfmPathLength);
       vfmPath[vfmPathLength] = 0;
 
-      auto fileProxyFactory = proxy_factory_factory->create(vfmPath);
-      file_subsystem->AddFileOverride(fileIdentifier, fileProxyFactory);
+      // Commands may append the paths of delta vfms to overlay on the base, in priority order.
+      std::vector<std::string> layerPaths;
+      auto bytesConsumed = sizeof(fileIdentifier.targetVolumeSerialNumber) + sizeof(fileIdentifier.targetFileIndexHigh) + sizeof(fileIdentifier.targetFileIndexLow) + sizeof(UINT32) + vfmPathLength;
+      if (command->length > bytesConsumed) {
+         UINT32 layerCount = reader.read_uint32();
+         for (UINT32 i = 0; i < layerCount; i++) {
+            UINT32 layerPathLength = reader.read_uint32();
+            std::string layerPath(layerPathLength, '\0');
+            reader.read_bytes(&layerPath[0], layerPathLength);
+            layerPaths.push_back(layerPath);
+         }
+      }
+
+      auto fileProxyFactory = proxy_factory_factory->create(vfmPath, layerPaths);
+      delete[] vfmPath;
+      if (fileProxyFactory) {
+         file_subsystem->AddFileOverride(fileIdentifier, fileProxyFactory);
+      }
    }
 }
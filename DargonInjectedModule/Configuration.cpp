@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include <algorithm>
+#include <iostream>
+#include <stdexcept>
 
 #include "base.hpp"
 #include "util.hpp"
@@ -11,6 +13,13 @@ const std::string Configuration::EnableCommandListFlag = "--enable-dim-command-l
 const std::string Configuration::EnableFileSystemHooksFlag = "--enable-filesystem-hooks";
 const std::string Configuration::EnableTrinketManagedFlag = "--enable-trinket-managed";
 const std::string Configuration::LaunchSuspendedKey = "launchsuspended";
+const std::string Configuration::VfmHandleCacheCapacityKey = "vfmhandlecachecapacity";
+const std::string Configuration::VfmBlockCacheBudgetKey = "vfmblockcachebudget";
+const std::string Configuration::VfmMappingBudgetKey = "vfmmappingbudget";
+const std::string Configuration::VfmIoThreadCountKey = "vfmiothreadcount";
+const std::string Configuration::VfmReadAheadMaxWindowKey = "vfmreadaheadmaxwindow";
+const std::string Configuration::VfmParallelReadThresholdKey = "vfmparallelreadthreshold";
+const std::string Configuration::VfmContentSharingMaxLengthKey = "vfmcontentsharingmaxlength";
 
 std::shared_ptr<Configuration> Configuration::Parse(flags_t flags, property_pairs_t property_pairs) {
    properties_t properties;
@@ -45,4 +54,22 @@ std::string Configuration::GetProperty(const std::string& key) {
    } else {
       return "";
    }
+}
+
+int64_t Configuration::GetIntegerProperty(const std::string& key, int64_t defaultValue) {
+   auto value = GetProperty(key);
+   if (value.empty()) {
+      return defaultValue;
+   }
+   try {
+      size_t parsedLength = 0;
+      auto result = std::stoll(value, &parsedLength);
+      if (parsedLength == value.size() && result >= 0) {
+         return result;
+      }
+   } catch (std::logic_error&) {
+      // std::invalid_argument or std::out_of_range; reported below.
+   }
+   std::cout << "Ignoring property " << key << "=" << value << ": expected a non-negative integer, using " << defaultValue << std::endl;
+   return defaultValue;
 }
\ No newline at end of file
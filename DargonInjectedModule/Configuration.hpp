@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint> // int64_t
 #include <memory> // shared_ptr
 #include <string> // string
 #include <unordered_map> // unordered_map
@@ -16,6 +17,13 @@ namespace dargon {
       static const std::string EnableFileSystemHooksFlag;
       static const std::string EnableTrinketManagedFlag;
       static const std::string LaunchSuspendedKey;
+      static const std::string VfmHandleCacheCapacityKey;
+      static const std::string VfmBlockCacheBudgetKey;
+      static const std::string VfmMappingBudgetKey;
+      static const std::string VfmIoThreadCountKey;
+      static const std::string VfmReadAheadMaxWindowKey;
+      static const std::string VfmParallelReadThresholdKey;
+      static const std::string VfmContentSharingMaxLengthKey;
 
       static std::shared_ptr<Configuration> Parse(flags_t flags, property_pairs_t properties);
       static std::shared_ptr<Configuration> Parse(flags_t flags, properties_t properties);
@@ -32,5 +40,9 @@ namespace dargon {
       bool IsFlagSet(const std::string& flag);
       bool IsFlagSet(const char* flag);
       std::string GetProperty(const std::string& key);
+
+      // Returns key's value parsed as a non-negative integer, or defaultValue if it's unset. Values
+      // that aren't one are logged and ignored in favour of defaultValue.
+      int64_t GetIntegerProperty(const std::string& key, int64_t defaultValue);
    };
 }
\ No newline at end of file
@@ -28,7 +28,7 @@ void CommandManager::Initialize() {
 
       std::cout << "Processing Initial DIM Command List... " << std::endl;
       auto commands = handler->ReleaseCommands();
-      ProcessCommands(commands);
+      ProcessCommandList(commands);
 
       std::cout << "Initial DIM Command List processed." << std::endl;
    }
@@ -44,6 +44,24 @@ void CommandManager::UnregisterCommandHandler(IDIMCommandHandler* handler) {
    m_handlers.erase(handler);
 }
 
+void CommandManager::SetReloadScope(ReloadScope reloadScope) {
+   m_reloadScope = reloadScope;
+}
+
+void CommandManager::ReloadCommands(std::vector<DIMCommand*>& commands) {
+   std::cout << "Reloading " << commands.size() << " DIM Commands" << std::endl;
+   ProcessCommandList(commands);
+   std::cout << "DIM Command reload processed." << std::endl;
+}
+
+void CommandManager::ProcessCommandList(std::vector<DIMCommand*>& commands) {
+   if (m_reloadScope) {
+      m_reloadScope([this, &commands] { ProcessCommands(commands); });
+   } else {
+      ProcessCommands(commands);
+   }
+}
+
 void CommandManager::ProcessCommands(std::vector<DIMCommand*>& commands) {
    LockType lock(m_mutex);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <unordered_set>
@@ -23,11 +24,18 @@ namespace dargon { namespace IO { namespace DIM {
       typedef std::mutex MutexType;
       typedef std::unique_lock<MutexType> LockType;
 
+   public:
+      // Runs the given processing of a whole command list, the initial one or a reload, e.g. so
+      // that overrides it produces can be staged and published together. The list replaces the
+      // commands in effect, of which there are none before the initial one.
+      typedef std::function<void(const std::function<void()>& reprocess)> ReloadScope;
+
    private:
       std::shared_ptr<dargon::IO::DSP::DSPExNodeSession> session;
       std::shared_ptr<dargon::Configuration> configuration;
       std::unordered_set<IDIMCommandHandler*> m_handlers;
       MutexType m_mutex;
+      ReloadScope m_reloadScope;
       
    public:
       CommandManager(std::shared_ptr<dargon::IO::DSP::DSPExNodeSession> session, std::shared_ptr<dargon::Configuration>);
@@ -37,7 +45,14 @@ namespace dargon { namespace IO { namespace DIM {
       void ProcessCommands(std::vector<DIMCommand*>& 
          s);
 
+      // Must be set before Initialize.
+      void SetReloadScope(ReloadScope reloadScope);
+
+      // Processes a command list sent on resources reload, which replaces the commands in effect.
+      void ReloadCommands(std::vector<DIMCommand*>& commands);
+
    private:
+      void ProcessCommandList(std::vector<DIMCommand*>& commands);
       DSPExLITDIMQueryInitialCommandListHandler* ConstructInitialCommandListQueryHandler(UINT32 transactionId);
    };
 } } }
\ No newline at end of file
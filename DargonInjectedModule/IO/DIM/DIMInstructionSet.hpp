@@ -8,6 +8,7 @@
 #include "../DSP/DSPExLITransactionHandler.hpp"
 #include "../DSP/DSPExRITransactionHandler.hpp"
 #include "DSPExRITDIMProcessTaskListHandler.hpp"
+#include "DSPExRITDIMReloadResourcesHandler.hpp"
 #include "DSPExLITDIMQueryInitialCommandListHandler.hpp";
 
 namespace dargon { namespace IO { namespace DIM {
@@ -30,6 +31,9 @@ namespace dargon { namespace IO { namespace DIM {
                *ppResult = new dargon::IO::DIM::DSPExRITDIMProcessTaskListHandler(transactionId, m_owner, m_completeOnCompletion);
                m_completeOnCompletion = nullptr;
                break;
+            case DSP_EX_S2C_EVENT_RESOURCES_RELOAD:
+               *ppResult = new dargon::IO::DIM::DSPExRITDIMReloadResourcesHandler(transactionId, m_owner);
+               break;
          }
          return *ppResult == nullptr;
       }
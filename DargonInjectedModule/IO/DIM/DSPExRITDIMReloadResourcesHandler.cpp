@@ -0,0 +1,57 @@
+#include "stdafx.h"
+#include <process.h>
+#include "binary_reader.hpp"
+#include "IO/DSP/DSPExMessage.hpp"
+#include "IO/DSP/DSPExInitialMessage.hpp"
+#include "CommandManager.hpp"
+#include "DSPExRITDIMReloadResourcesHandler.hpp"
+
+using namespace dargon::IO::DIM;
+using namespace dargon::IO::DSP;
+
+DSPExRITDIMReloadResourcesHandler::DSPExRITDIMReloadResourcesHandler(UINT32 transactionId, CommandManager* owner)
+   : DSPExRITransactionHandler(transactionId), m_owner(owner)
+{
+}
+
+void DSPExRITDIMReloadResourcesHandler::ProcessInitialMessage(IDSPExSession& session, DSPExInitialMessage& message) {
+   auto context = new ReloadContext();
+   context->owner = m_owner;
+
+   dargon::binary_reader reader(message.DataBuffer, message.DataLength);
+   UINT32 commandCount = reader.read_uint32();
+   std::cout << "Resources reload requested with " << commandCount << " commands" << std::endl;
+
+   for (UINT32 i = 0; i < commandCount; i++) {
+      std::string type = reader.read_long_text();
+      UINT32 dataLength = reader.read_uint32();
+      UINT8* commandData = new UINT8[dataLength];
+      reader.read_bytes(commandData, dataLength);
+
+      DIMCommand* command = new DIMCommand();
+      command->type = type;
+      command->length = dataLength;
+      command->data = commandData;
+      context->commands.push_back(command);
+   }
+
+   // Disposes of this handler, so nothing below may touch members.
+   session.DeregisterRITransactionHandler(this);
+
+   // _beginthreadex over std::thread as we permit C-RunTime usage
+   if (_beginthreadex(nullptr, 0, StaticReloadThreadStart, context, 0, nullptr) == 0) {
+      std::cout << "Failed to start resources reload thread" << std::endl;
+      delete context;
+   }
+}
+
+void DSPExRITDIMReloadResourcesHandler::ProcessMessage(IDSPExSession& session, DSPExMessage& message) {
+   // The command list arrives whole in the initial message.
+}
+
+unsigned int WINAPI DSPExRITDIMReloadResourcesHandler::StaticReloadThreadStart(void* pContext) {
+   auto context = reinterpret_cast<ReloadContext*>(pContext);
+   context->owner->ReloadCommands(context->commands);
+   delete context;
+   return 0;
+}
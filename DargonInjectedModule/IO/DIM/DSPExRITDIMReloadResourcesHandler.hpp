@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "dargon.hpp"
+#include "IO/DSP/DSPEx.hpp"
+#include "IO/DSP/IDSPExSession.hpp"
+#include "IO/DSP/DSPExRITransactionHandler.hpp"
+#include "IO/DIM/DIMCommand.hpp"
+
+namespace dargon { namespace IO { namespace DIM {
+   class CommandManager;
+
+   // Handles DSP_EX_S2C_EVENT_RESOURCES_RELOAD, whose initial message carries a complete command
+   // list in the same layout as the response to DSP_EX_C2S_DIM_READY_FOR_TASKS. The list replaces
+   // the commands currently in effect; it is applied on a background thread so the session's
+   // frame processors are never blocked loading vfms.
+   class DSPExRITDIMReloadResourcesHandler : public dargon::IO::DSP::DSPExRITransactionHandler
+   {
+      // Owns the parsed commands, which handlers only read while ReloadCommands runs.
+      struct ReloadContext {
+         CommandManager* owner;
+         std::vector<dargon::IO::DIM::DIMCommand*> commands;
+
+         ~ReloadContext() {
+            for (auto command : commands) {
+               delete[] command->data;
+               delete command;
+            }
+         }
+      };
+
+      CommandManager* m_owner;
+
+   public:
+      DSPExRITDIMReloadResourcesHandler(UINT32 transactionId, CommandManager* owner);
+
+      void ProcessInitialMessage(dargon::IO::DSP::IDSPExSession& session, dargon::IO::DSP::DSPExInitialMessage& message) override;
+      void ProcessMessage(dargon::IO::DSP::IDSPExSession& session, dargon::IO::DSP::DSPExMessage& message) override;
+
+   private:
+      static unsigned int WINAPI StaticReloadThreadStart(void* pContext);
+   };
+} } }
@@ -39,5 +39,9 @@ namespace dargon { namespace Subsystems {
       virtual DWORD Seek(int64_t distance_to_move, int64_t* new_file_pointer, DWORD dwMoveMethod) = 0;
       virtual BOOL Close() = 0;
       virtual std::string ToString() = 0;
+
+      // Invoked when the application associates the proxied handle with an I/O completion port.
+      // Proxies whose overlapped operations don't go through the kernel post their own packets.
+      virtual void AssociateCompletionPort(HANDLE completion_port, ULONG_PTR completion_key) { }
    };
 } }
\ No newline at end of file
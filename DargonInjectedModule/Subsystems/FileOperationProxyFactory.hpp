@@ -3,6 +3,14 @@
 namespace dargon { namespace Subsystems {
    class FileOperationProxyFactory {
    public:
+      // Called off the game's threads before a reload publishes this factory, so that costly
+      // setup (parsing a vfm, say) is not paid by the first open.
+      virtual void prepare() { }
+
+      // Called before prepare() when a reload publishes this factory, to drop whatever is cached
+      // from the files it serves; a mod update may have rewritten them since they were read.
+      virtual void invalidate() { }
+
 #ifdef WIN32
       virtual std::shared_ptr<FileOperationProxy> create() = 0;
 #endif
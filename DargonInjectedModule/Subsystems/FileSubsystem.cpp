@@ -1,4 +1,5 @@
 #include "stdafx.h"
+#include <chrono>
 #include <iostream>
 #include <Psapi.h>
 #include "util.hpp"
@@ -51,6 +52,7 @@ bool FileSubsystem::Initialize()
       InstallCloseHandleDetour(hModuleKernel32);
       InstallSetFilePointerDetour(hModuleKernel32);
       InstallSetFilePointerExDetour(hModuleKernel32);
+      InstallCreateIoCompletionPortDetour(hModuleKernel32);
       m_trampCreateEventA = nullptr;
       m_trampCreateEventW = nullptr;
       m_trampCreateFileA = nullptr;
@@ -103,17 +105,61 @@ bool FileSubsystem::Uninitialize()
       UninstallCloseHandleDetour();
       UninstallSetFilePointerDetour();
       UninstallSetFilePointerExDetour();
+      UninstallCreateIoCompletionPortDetour();
       return true;
    }
 }
 
 void FileSubsystem::AddFileOverride(FileIdentifier fileIdentifier, std::shared_ptr<FileOperationProxyFactory> proxyFactory) {
-   proxyFactoriesByFileIdentifier.insert(fileIdentifier, proxyFactory);
+   std::lock_guard<std::mutex> lock(fileOverridesWriteMutex);
+   if (stagedFileOverrides) {
+      stagedFileOverrides->assign(fileIdentifier, std::move(proxyFactory));
+   } else {
+      fileOverrides.assign(fileIdentifier, std::move(proxyFactory));
+   }
+}
+
+void FileSubsystem::ReloadFileOverrides(const std::function<void()>& addOverrides) {
+   std::lock_guard<std::mutex> reloadLock(fileOverridesReloadMutex);
+   auto start_time = std::chrono::steady_clock::now();
+   {
+      std::lock_guard<std::mutex> lock(fileOverridesWriteMutex);
+      stagedFileOverrides.reset(new FileOverrideTable::batch());
+      stagedFileOverrides->clear();
+   }
+
+   addOverrides();
+
+   std::unique_ptr<FileOverrideTable::batch> overrides;
+   {
+      std::lock_guard<std::mutex> lock(fileOverridesWriteMutex);
+      overrides.swap(stagedFileOverrides);
+   }
+   // The initial command list is published while the game is still suspended, so its factories
+   // are left to load on first open rather than holding up the launch. Nothing is cached yet then;
+   // on a reload, the files behind the new list may have changed since they were cached, so all
+   // of that is dropped before any factory loads again. Handles already open keep reading the
+   // backing files their vfm was loaded against.
+   if (fileOverrides.size() > 0) {
+      overrides->for_each_assignment([](const FileIdentifier&, const std::shared_ptr<FileOperationProxyFactory>& proxyFactory) {
+         proxyFactory->invalidate();
+      });
+      overrides->for_each_assignment([](const FileIdentifier&, const std::shared_ptr<FileOperationProxyFactory>& proxyFactory) {
+         proxyFactory->prepare();
+      });
+   }
+
+   fileOverrides.publish(*overrides);
+   auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+   std::cout << "Published " << fileOverrides.size() << " file overrides in " << elapsed.count() << "ms" << std::endl;
 }
 
 // - static ---------------------------------------------------------------------------------------
-concurrent_dictionary<FileIdentifier, std::shared_ptr<FileOperationProxyFactory>, FileIdentifierHash> FileSubsystem::proxyFactoriesByFileIdentifier;
-concurrent_dictionary<HANDLE, std::shared_ptr<FileOperationProxy>> FileSubsystem::fileOperationProxiesByHandle;
+FileSubsystem::FileOverrideTable FileSubsystem::fileOverrides;
+std::mutex FileSubsystem::fileOverridesWriteMutex;
+std::mutex FileSubsystem::fileOverridesReloadMutex;
+std::unique_ptr<FileSubsystem::FileOverrideTable::batch> FileSubsystem::stagedFileOverrides;
+lock_free_dictionary<HANDLE, std::shared_ptr<FileOperationProxy>> FileSubsystem::fileOperationProxiesByHandle;
 FileHookEventPublisher* FileSubsystem::fileHookEventPublisher;
 
 
@@ -126,6 +172,7 @@ DIM_IMPL_STATIC_DETOUR(FileSubsystem, WriteFile, FunctionWriteFile, "WriteFile",
 DIM_IMPL_STATIC_DETOUR(FileSubsystem, CloseHandle, FunctionCloseHandle, "CloseHandle", MyCloseHandle);
 DIM_IMPL_STATIC_DETOUR(FileSubsystem, SetFilePointer, FunctionSetFilePointer, "SetFilePointer", MySetFilePointer);
 DIM_IMPL_STATIC_DETOUR(FileSubsystem, SetFilePointerEx, FunctionSetFilePointerEx, "SetFilePointerEx", MySetFilePointerEx);
+DIM_IMPL_STATIC_DETOUR(FileSubsystem, CreateIoCompletionPort, FunctionCreateIoCompletionPort, "CreateIoCompletionPort", MyCreateIoCompletionPort);
 
 HANDLE WINAPI FileSubsystem::MyCreateEventA(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCSTR lpName) {
    return m_trampCreateEventA(lpEventAttributes, bManualReset, bInitialState, lpName);
@@ -163,10 +210,10 @@ HANDLE WINAPI FileSubsystem::MyCreateFileW(LPCWSTR lpFilePath, DWORD dwDesiredAc
 BOOL WINAPI FileSubsystem::MyReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped)
 {
    BOOL result = 0;
-   auto proxy = fileOperationProxiesByHandle.get_value_or_default(hFile);
-   if (proxy == nullptr) {
-      result = m_trampReadFile(hFile, lpBuffer, nNumberOfBytesToRead, lpNumberOfBytesRead, lpOverlapped);
-   } else {
+   // The proxy is used in place under the table's epoch guard rather than copied out, so hooked
+   // I/O takes no reference on it. A slow read only delays reclaiming removed entries, and
+   // handles come and go rarely.
+   auto proxied = fileOperationProxiesByHandle.visit(hFile, [&](const std::shared_ptr<FileOperationProxy>& proxy) {
       LARGE_INTEGER file_offset = {};
       if (lpOverlapped == nullptr) {
          LARGE_INTEGER zero = {};
@@ -198,17 +245,20 @@ BOOL WINAPI FileSubsystem::MyReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumb
       fileHookEventPublisher->PublishReadFileEventPost(&postArgs);
 
       ::SetLastError(error);
+   });
+   if (!proxied) {
+      result = m_trampReadFile(hFile, lpBuffer, nNumberOfBytesToRead, lpNumberOfBytesRead, lpOverlapped);
    }
    return result;
 }
 
 BOOL WINAPI FileSubsystem::MyWriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, LPDWORD lpNumberOfBytesWritten, LPOVERLAPPED lpOverlapped) {
-   BOOL result;
-   auto proxy = fileOperationProxiesByHandle.get_value_or_default(hFile);
-   if (proxy == nullptr) {
-      result = m_trampWriteFile(hFile, lpBuffer, nNumberOfBytesToWrite, lpNumberOfBytesWritten, lpOverlapped);
-   } else {
+   BOOL result = FALSE;
+   auto proxied = fileOperationProxiesByHandle.visit(hFile, [&](const std::shared_ptr<FileOperationProxy>& proxy) {
       result = proxy->Write(lpBuffer, nNumberOfBytesToWrite, (uint32_t*)lpNumberOfBytesWritten, lpOverlapped);
+   });
+   if (!proxied) {
+      result = m_trampWriteFile(hFile, lpBuffer, nNumberOfBytesToWrite, lpNumberOfBytesWritten, lpOverlapped);
    }
    return result;
 }
@@ -220,7 +270,7 @@ BOOL WINAPI FileSubsystem::MyCloseHandle(HANDLE hObject)
    std::shared_ptr<FileOperationProxy> proxyToClose;
    fileOperationProxiesByHandle.conditional_remove(
       hObject,
-      [&](const HANDLE test, std::shared_ptr<FileOperationProxy> existing) {
+      [&](const HANDLE test, const std::shared_ptr<FileOperationProxy>& existing) {
          if (existing->__DecrementReferenceCount() == 0) {
             if (kEnableInterceptLogging) {
                std::cout << hObject << " T" << ::GetCurrentThreadId() << " CLOSE HANDLE " << std::endl;
@@ -335,21 +385,22 @@ DWORD WINAPI FileSubsystem::MySetFilePointer(HANDLE hFile, LONG lDistanceToMove,
    }
 
    LARGE_INTEGER final_position;
-   auto proxy = fileOperationProxiesByHandle.get_value_or_default(hFile);
-   if (proxy) {
-      auto result = proxy->Seek(distance.QuadPart, &final_position.QuadPart, dwMoveMethod);
+   DWORD result = INVALID_SET_FILE_POINTER;
+   auto proxied = fileOperationProxiesByHandle.visit(hFile, [&](const std::shared_ptr<FileOperationProxy>& proxy) {
+      result = proxy->Seek(distance.QuadPart, &final_position.QuadPart, dwMoveMethod);
+   });
+   if (!proxied) {
+      return m_trampSetFilePointer(hFile, lDistanceToMove, lpDistanceToMoveHigh, dwMoveMethod);
+   }
 
-      if (lpDistanceToMoveHigh != nullptr) {
-         *lpDistanceToMoveHigh = final_position.HighPart;
-      }
+   if (lpDistanceToMoveHigh != nullptr) {
+      *lpDistanceToMoveHigh = final_position.HighPart;
+   }
 
-      if (result == INVALID_SET_FILE_POINTER) {
-         return INVALID_SET_FILE_POINTER;
-      } else {
-         return final_position.LowPart;
-      }
+   if (result == INVALID_SET_FILE_POINTER) {
+      return INVALID_SET_FILE_POINTER;
    } else {
-      return m_trampSetFilePointer(hFile, lDistanceToMove, lpDistanceToMoveHigh, dwMoveMethod);
+      return final_position.LowPart;
    }
 }
 
@@ -365,17 +416,25 @@ DWORD WINAPI FileSubsystem::MySetFilePointerEx(HANDLE hFile, LARGE_INTEGER liDis
 //            << " dwMoveMethod: " << dwMoveMethod << std::endl;
 //      });
 //   }
-   auto proxy = fileOperationProxiesByHandle.get_value_or_default(hFile);
-   if (proxy) {
-      auto result = proxy->Seek(liDistanceToMove.QuadPart, &lpNewFilePointer->QuadPart, dwMoveMethod);
-      if (result == INVALID_SET_FILE_POINTER) {
-         return FALSE;
-      } else {
-         return TRUE;
-      }
-   } else {
+   DWORD result = INVALID_SET_FILE_POINTER;
+   auto proxied = fileOperationProxiesByHandle.visit(hFile, [&](const std::shared_ptr<FileOperationProxy>& proxy) {
+      result = proxy->Seek(liDistanceToMove.QuadPart, &lpNewFilePointer->QuadPart, dwMoveMethod);
+   });
+   if (!proxied) {
       return m_trampSetFilePointerEx(hFile, liDistanceToMove, lpNewFilePointer, dwMoveMethod);
    }
+   return result == INVALID_SET_FILE_POINTER ? FALSE : TRUE;
+}
+
+HANDLE WINAPI FileSubsystem::MyCreateIoCompletionPort(HANDLE FileHandle, HANDLE ExistingCompletionPort, ULONG_PTR CompletionKey, DWORD NumberOfConcurrentThreads) {
+   auto result = m_trampCreateIoCompletionPort(FileHandle, ExistingCompletionPort, CompletionKey, NumberOfConcurrentThreads);
+   if (result != NULL && FileHandle != INVALID_HANDLE_VALUE) {
+      // Proxies that complete overlapped reads themselves need to know where to post packets.
+      fileOperationProxiesByHandle.visit(FileHandle, [&](const std::shared_ptr<FileOperationProxy>& proxy) {
+         proxy->AssociateCompletionPort(result, CompletionKey);
+      });
+   }
+   return result;
 }
 
 FileIdentifier FileSubsystem::GetFileIdentifier(LPCWSTR file_path) {
@@ -431,8 +490,10 @@ HANDLE WINAPI FileSubsystem::InternalCreateFileW(bool isPermittedRecursion, LPCW
    fileIdentifier.targetFileIndexLow = fileInfo.nFileIndexLow;
    fileIdentifier.targetVolumeSerialNumber = fileInfo.dwVolumeSerialNumber;
 
+   // The factory is copied out so create(), which may load a vfm, runs after the epoch guard
+   // taken by the lookup is released.
    std::shared_ptr<FileOperationProxy> proxy;
-   auto proxyFactory = proxyFactoriesByFileIdentifier.get_value_or_default(fileIdentifier);
+   auto proxyFactory = fileOverrides.get_value_or_default(fileIdentifier);
    if (proxyFactory) {
       proxy = proxyFactory->create();
    } else {
@@ -447,11 +508,12 @@ HANDLE WINAPI FileSubsystem::InternalCreateFileW(bool isPermittedRecursion, LPCW
       std::cout << fileHandle << " T" << ::GetCurrentThreadId() << " CREATE FILE " << dargon::narrow(filePath) << std::endl;
    }
 
-   fileOperationProxiesByHandle.add_or_update(
-      fileHandle,
-      [proxy](const HANDLE add) { proxy->__IncrementReferenceCount(); return proxy; },
-      [proxy, &filePath](const HANDLE update, std::shared_ptr<FileOperationProxy> existing) { std::cout << ":( T_T" << dargon::narrow(filePath) << std::endl; return existing; }
-    );
+   // The handle isn't visible to the application yet, so the proxy can be counted before it's
+   // published, and moved in rather than copied.
+   proxy->__IncrementReferenceCount();
+   if (!fileOperationProxiesByHandle.try_emplace(fileHandle, std::move(proxy))) {
+      std::cout << ":( T_T" << dargon::narrow(filePath) << std::endl;
+   }
 
    CreateFileEventArgsPost eventArgsPost = {};
    eventArgsPost.arguments = &args;
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "stdafx.h"
-#include <unordered_map>
-#include <concurrent_dictionary.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <lock_free_dictionary.hpp>
+#include <snapshot_map.hpp>
 
 #include <TrinketNatives.hpp>
 
@@ -15,8 +18,17 @@
 namespace dargon { namespace Subsystems {
    class FileSubsystem : public dargon::Subsystem
    {
-      static dargon::concurrent_dictionary<FileIdentifier, std::shared_ptr<FileOperationProxyFactory>, FileIdentifierHash> proxyFactoriesByFileIdentifier;
-      static dargon::concurrent_dictionary<HANDLE, std::shared_ptr<FileOperationProxy>> fileOperationProxiesByHandle;
+      typedef dargon::snapshot_map<FileIdentifier, std::shared_ptr<FileOperationProxyFactory>, FileIdentifierHash> FileOverrideTable;
+
+      // Opens look overrides up in the published snapshot and never block on writers. Overrides
+      // added while a command list is processed are staged in one batch and published with a
+      // single swap. A replaced snapshot and its factories are freed once no open is using them,
+      // while the proxies of handles already open keep their own vfms alive until closed.
+      static FileOverrideTable fileOverrides;
+      static std::mutex fileOverridesWriteMutex;
+      static std::mutex fileOverridesReloadMutex;
+      static std::unique_ptr<FileOverrideTable::batch> stagedFileOverrides;
+      static dargon::lock_free_dictionary<HANDLE, std::shared_ptr<FileOperationProxy>> fileOperationProxiesByHandle;
    
    private:
       static dargon::FileHookEventPublisher* fileHookEventPublisher;
@@ -27,6 +39,12 @@ namespace dargon { namespace Subsystems {
       bool Uninitialize() override;
 
       void AddFileOverride(FileIdentifier fileIdentifier, std::shared_ptr<FileOperationProxyFactory> proxyFactory);
+
+      // Replaces every file override with those added by addOverrides, which runs on the calling
+      // thread. The new overrides are staged in one batch, prepared if they replace a published
+      // set, and then published at once: opens before that see only the old set, opens after
+      // see only the new one.
+      void ReloadFileOverrides(const std::function<void()>& addOverrides);
       
       // - static ---------------------------------------------------------------------------------
    private:
@@ -39,6 +57,7 @@ namespace dargon { namespace Subsystems {
       DIM_DECL_STATIC_DETOUR(FileSubsystem, CloseHandle, FunctionCloseHandle, "CloseHandle", MyCloseHandle);
       DIM_DECL_STATIC_DETOUR(FileSubsystem, SetFilePointer, FunctionSetFilePointer, "SetFilePointer", MySetFilePointer);
       DIM_DECL_STATIC_DETOUR(FileSubsystem, SetFilePointerEx, FunctionSetFilePointerEx, "SetFilePointerEx", MySetFilePointerEx);
+      DIM_DECL_STATIC_DETOUR(FileSubsystem, CreateIoCompletionPort, FunctionCreateIoCompletionPort, "CreateIoCompletionPort", MyCreateIoCompletionPort);
       
       static HANDLE WINAPI MyCreateEventA(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCSTR lpName);
       static HANDLE WINAPI MyCreateEventW(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCWSTR lpName);
@@ -49,6 +68,7 @@ namespace dargon { namespace Subsystems {
       static BOOL WINAPI MyCloseHandle(HANDLE hObject);
       static DWORD WINAPI MySetFilePointer(HANDLE hFile, LONG lDistanceToMove, PLONG lpDistanceToMoveHigh, DWORD dwMoveMethod);
       static DWORD WINAPI MySetFilePointerEx(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer, DWORD dwMoveMethod);
+      static HANDLE WINAPI MyCreateIoCompletionPort(HANDLE FileHandle, HANDLE ExistingCompletionPort, ULONG_PTR CompletionKey, DWORD NumberOfConcurrentThreads);
 
       static FileIdentifier GetFileIdentifier(LPCWSTR file_path);
       static HANDLE WINAPI InternalCreateFileW(bool isPermittedRecursion, LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile);
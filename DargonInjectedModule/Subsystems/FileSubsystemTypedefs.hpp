@@ -6,6 +6,14 @@
 #include <unordered_map>
 #include <Windows.h>
 
+//-------------------------------------------------------------------------------------------------
+// ::CreateIoCompletionPort
+//-------------------------------------------------------------------------------------------------
+typedef HANDLE(WINAPI FunctionCreateIoCompletionPort)(HANDLE FileHandle, HANDLE ExistingCompletionPort, ULONG_PTR CompletionKey, DWORD NumberOfConcurrentThreads);
+typedef FunctionCreateIoCompletionPort* PFunctionCreateIoCompletionPort;
+typedef void (FunctionCreateIoCompletionPortNoCC)(HANDLE FileHandle, HANDLE ExistingCompletionPort, ULONG_PTR CompletionKey, DWORD NumberOfConcurrentThreads);
+typedef FunctionCreateIoCompletionPortNoCC* PFunctionCreateIoCompletionPortNoCC;
+
 namespace dargon { namespace Subsystems {
    struct FileIdentifier {
       DWORD targetVolumeSerialNumber;
@@ -3,10 +3,16 @@
 
 using namespace dargon::Subsystems;
 
+// ntstatus.h isn't includable alongside Windows.h without ceremony.
+const ULONG_PTR kStatusEndOfFile = 0xC0000011L;
+const ULONG_PTR kStatusUnexpectedIoError = 0xC00000E9L;
+
 RemappedFileOperationProxy::RemappedFileOperationProxy(
    std::shared_ptr<dargon::IO::IoProxy> io_proxy,
-   std::shared_ptr<dargon::vfm_file> virtual_file_map
-) : io_proxy(io_proxy), virtual_file_map(virtual_file_map), name(""), handle(INVALID_HANDLE_VALUE) {
+   std::shared_ptr<dargon::vfm_file> virtual_file_map,
+   std::shared_ptr<dargon::vfm_read_ahead> read_ahead,
+   std::shared_ptr<dargon::thread_pool> io_thread_pool
+) : io_proxy(io_proxy), virtual_file_map(virtual_file_map), read_ahead(read_ahead), io_thread_pool(io_thread_pool), name(""), handle(INVALID_HANDLE_VALUE), completion_port(NULL), completion_key(0) {
    static bool first = true;
    if (first) {
 //      __debugbreak();
@@ -33,45 +39,51 @@ HANDLE RemappedFileOperationProxy::Create(LPCWSTR lpFilePath, DWORD dwDesiredAcc
 //std::mutex g_readLock;
 BOOL RemappedFileOperationProxy::Read(void* buffer, uint32_t byte_count, OUT uint32_t* bytes_read, LPOVERLAPPED lpOverlapped) {
    if (lpOverlapped != nullptr) {
-      // Synchronous method: This seems to not be supported by League of Legends?
-//      LARGE_INTEGER li;
-//      li.LowPart = lpOverlapped->Offset;
-//      li.HighPart = lpOverlapped->OffsetHigh;
-//      std::cout << "Overlapped read at " << li.QuadPart << " with length " << byte_count << std::endl;
-//      auto actual_bytes_read = virtual_file_map->read(li.QuadPart, byte_count, (uint8_t*)buffer, 0);
-//      if (bytes_read != nullptr) {
-//         *bytes_read = actual_bytes_read;
-//      }
-//      return TRUE;
-
-      // Asynchronous method: Leaks a bit of memory.
       LARGE_INTEGER li;
       li.LowPart = lpOverlapped->Offset;
       li.HighPart = lpOverlapped->OffsetHigh;
-      auto actual_bytes_read = virtual_file_map->read(li.QuadPart, byte_count, (uint8_t*)buffer, 0);
-      if (bytes_read != nullptr) {
-         *bytes_read = actual_bytes_read;
-      }
-      
-      auto hDummy = io_proxy->CreateFileW(dargon::wide(name).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-      auto file_length = SetFilePointer(hDummy, 0, nullptr, FILE_END);
-      io_proxy->CloseHandle(hDummy);
 
-      if (file_length < actual_bytes_read) {
-         __debugbreak();
+      // As with a real file, reads starting at or past the end fail immediately.
+      if (li.QuadPart >= virtual_file_map->size()) {
+         lpOverlapped->InternalHigh = 0;
+         lpOverlapped->Internal = kStatusEndOfFile;
+         if (bytes_read != nullptr) {
+            *bytes_read = 0;
+         }
+         SetLastError(ERROR_HANDLE_EOF);
+         return FALSE;
       }
 
-      LARGE_INTEGER offset_to_start_from;
-      offset_to_start_from.QuadPart = 0; 
+      // The low bit of hEvent only suppresses the completion packet.
+      auto event_value = reinterpret_cast<uintptr_t>(lpOverlapped->hEvent);
+      auto hEvent = reinterpret_cast<HANDLE>(event_value & ~static_cast<uintptr_t>(1));
+      auto port = (event_value & 1) == 0 ? completion_port : NULL;
+
+      // With neither an event nor a completion port, GetOverlappedResult waits on the file handle
+      // itself, which we never signal; complete those in place, as overlapped callers must allow.
+      if (!io_thread_pool || (hEvent == NULL && port == NULL)) {
+         auto actual_bytes_read = virtual_file_map->read(li.QuadPart, byte_count, (uint8_t*)buffer, 0);
+         if (bytes_read != nullptr) {
+            *bytes_read = static_cast<uint32_t>(actual_bytes_read);
+         }
+         CompleteOverlappedRead(lpOverlapped, actual_bytes_read, 0, hEvent, port, completion_key);
+         return TRUE;
+      }
 
-      uint8_t* memory_leak = new uint8_t[actual_bytes_read];
-      BOOL isDummyOperationSynchronous = TRUE;
-      while (isDummyOperationSynchronous) {
-         lpOverlapped->Offset = offset_to_start_from.LowPart;
-         lpOverlapped->OffsetHigh = offset_to_start_from.HighPart;
-         DWORD dummy_bytes_read = 0;
-         isDummyOperationSynchronous = io_proxy->ReadFile(handle, memory_leak, actual_bytes_read, &dummy_bytes_read, lpOverlapped);
+      lpOverlapped->Internal = STATUS_PENDING;
+      lpOverlapped->InternalHigh = 0;
+      if (hEvent != NULL) {
+         ResetEvent(hEvent);
       }
+      auto key = completion_key;
+      virtual_file_map->read_async(*io_thread_pool, li.QuadPart, byte_count, (uint8_t*)buffer, [lpOverlapped, hEvent, port, key](int64_t actual_bytes_read, std::exception_ptr error) {
+         // A failed read still completes, or the caller would wait on it forever.
+         if (error) {
+            CompleteOverlappedRead(lpOverlapped, 0, kStatusUnexpectedIoError, hEvent, port, key);
+         } else {
+            CompleteOverlappedRead(lpOverlapped, actual_bytes_read, 0, hEvent, port, key);
+         }
+      });
       SetLastError(ERROR_IO_PENDING);
       return FALSE;
    } else {
@@ -88,7 +100,7 @@ BOOL RemappedFileOperationProxy::Read(void* buffer, uint32_t byte_count, OUT uin
          __debugbreak();
       }
       
-      auto actual_bytes_read = virtual_file_map->read(initial_file_pointer.QuadPart, byte_count, (uint8_t*)buffer, 0);
+      auto actual_bytes_read = ReadVirtualFileMap(initial_file_pointer.QuadPart, byte_count, (uint8_t*)buffer);
 
       LARGE_INTEGER move;
       move.QuadPart = actual_bytes_read;
@@ -159,4 +171,37 @@ BOOL RemappedFileOperationProxy::Close() {
    return true;
 }
 
-std::string RemappedFileOperationProxy::ToString() { return name; }
\ No newline at end of file
+std::string RemappedFileOperationProxy::ToString() { return name; }
+
+void RemappedFileOperationProxy::AssociateCompletionPort(HANDLE port, ULONG_PTR key) {
+   completion_port = port;
+   completion_key = key;
+}
+
+dargon::vfm_read_ahead_stats RemappedFileOperationProxy::GetReadAheadStats() {
+   if (read_ahead) {
+      return read_ahead->stats();
+   }
+   return dargon::vfm_read_ahead_stats();
+}
+
+int64_t RemappedFileOperationProxy::ReadVirtualFileMap(int64_t offset, int64_t length, uint8_t* buffer) {
+   if (read_ahead) {
+      return read_ahead->read(offset, length, buffer);
+   }
+   return virtual_file_map->read(offset, length, buffer, 0);
+}
+
+void RemappedFileOperationProxy::CompleteOverlappedRead(LPOVERLAPPED lpOverlapped, int64_t bytes_read, ULONG_PTR status, HANDLE hEvent, HANDLE port, ULONG_PTR key) {
+   // Once Internal leaves STATUS_PENDING the caller may reuse or free the OVERLAPPED, so it is the
+   // last field written, and only values captured beforehand are used after it.
+   lpOverlapped->InternalHigh = static_cast<ULONG_PTR>(bytes_read);
+   MemoryBarrier();
+   lpOverlapped->Internal = status;
+   if (hEvent != NULL) {
+      SetEvent(hEvent);
+   }
+   if (port != NULL) {
+      PostQueuedCompletionStatus(port, static_cast<DWORD>(bytes_read), key, lpOverlapped);
+   }
+}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <memory>
 #include "noncopyable.hpp"
 #include "vfm/vfm_file.hpp"
+#include "vfm/vfm_read_ahead.hpp"
 #include "IO/IoProxy.hpp"
 #include "FileOperationProxy.hpp"
 
@@ -12,15 +13,28 @@ namespace dargon { namespace Subsystems {
       std::string name;
       std::shared_ptr<dargon::IO::IoProxy> io_proxy;
       std::shared_ptr<dargon::vfm_file> virtual_file_map;
+      std::shared_ptr<dargon::vfm_read_ahead> read_ahead;
+      std::shared_ptr<dargon::thread_pool> io_thread_pool;
       HANDLE handle;
+      HANDLE completion_port;
+      ULONG_PTR completion_key;
 
    public:
-      RemappedFileOperationProxy(std::shared_ptr<dargon::IO::IoProxy> io_proxy, std::shared_ptr<dargon::vfm_file> virtual_file_map);
+      // read_ahead may be null, in which case reads go straight to the virtual file map. Overlapped
+      // reads complete asynchronously on io_thread_pool, or in place if it is null.
+      RemappedFileOperationProxy(std::shared_ptr<dargon::IO::IoProxy> io_proxy, std::shared_ptr<dargon::vfm_file> virtual_file_map, std::shared_ptr<dargon::vfm_read_ahead> read_ahead, std::shared_ptr<dargon::thread_pool> io_thread_pool);
       HANDLE Create(LPCWSTR lpFilePath, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile) override;
       BOOL Read(void* buffer, uint32_t byte_count, OUT uint32_t* bytes_read, LPOVERLAPPED lpOverlapped) override;
       BOOL Write(const void* lpBuffer, uint32_t byte_count, OUT uint32_t* bytes_written, LPOVERLAPPED lpOverlapped) override;
       DWORD Seek(int64_t distance_to_move, int64_t* new_file_pointer, DWORD dwMoveMethod) override;
       BOOL Close() override;
       std::string ToString() override;
+      void AssociateCompletionPort(HANDLE completion_port, ULONG_PTR completion_key) override;
+
+      dargon::vfm_read_ahead_stats GetReadAheadStats();
+
+   private:
+      int64_t ReadVirtualFileMap(int64_t offset, int64_t length, uint8_t* buffer);
+      static void CompleteOverlappedRead(LPOVERLAPPED lpOverlapped, int64_t bytes_read, ULONG_PTR status, HANDLE hEvent, HANDLE port, ULONG_PTR key);
    };
 } }
\ No newline at end of file
@@ -1,15 +1,51 @@
 #include "stdafx.h"
+#include <algorithm>
 #include "RemappedFileOperationProxyFactory.hpp"
 #include "RemappedFileOperationProxy.hpp"
+#include "DefaultFileOperationProxy.hpp"
 
 using namespace dargon::Subsystems;
 
 RemappedFileOperationProxyFactory::RemappedFileOperationProxyFactory(
    std::shared_ptr<dargon::IO::IoProxy> io_proxy, 
-   std::shared_ptr<dargon::vfm_file> virtual_file_map
-) : io_proxy(io_proxy), virtual_file_map(virtual_file_map) {
+   vfm_loader load_virtual_file_map,
+   vfm_invalidator invalidate_virtual_file_map,
+   std::shared_ptr<dargon::thread_pool> io_thread_pool,
+   int64_t read_ahead_max_window
+) : io_proxy(io_proxy), load_virtual_file_map(load_virtual_file_map), invalidate_virtual_file_map(invalidate_virtual_file_map), io_thread_pool(io_thread_pool), read_ahead_max_window(read_ahead_max_window) {
+}
+
+void RemappedFileOperationProxyFactory::prepare() {
+   ensure_loaded();
+}
+
+void RemappedFileOperationProxyFactory::invalidate() {
+   if (invalidate_virtual_file_map) {
+      invalidate_virtual_file_map();
+   }
 }
 
 std::shared_ptr<FileOperationProxy> RemappedFileOperationProxyFactory::create() {
-   return std::make_shared<RemappedFileOperationProxy>(io_proxy, virtual_file_map);
+   ensure_loaded();
+   if (!virtual_file_map) {
+      return std::make_shared<DefaultFileOperationProxy>(io_proxy);
+   }
+
+   std::shared_ptr<dargon::vfm_read_ahead> read_ahead;
+   if (io_thread_pool && read_ahead_max_window > 0) {
+      auto min_window = std::min(dargon::vfm_read_ahead::kDefaultMinWindow, read_ahead_max_window);
+      read_ahead = std::make_shared<dargon::vfm_read_ahead>(virtual_file_map, io_thread_pool, min_window, read_ahead_max_window);
+   }
+   return std::make_shared<RemappedFileOperationProxy>(io_proxy, virtual_file_map, read_ahead, io_thread_pool);
+}
+
+void RemappedFileOperationProxyFactory::ensure_loaded() {
+   std::call_once(virtual_file_map_loaded, [this] {
+      try {
+         virtual_file_map = load_virtual_file_map();
+      } catch (std::exception& e) {
+         std::cout << "Failed to load vfm: " << e.what() << std::endl;
+      }
+      load_virtual_file_map = nullptr;
+   });
 }
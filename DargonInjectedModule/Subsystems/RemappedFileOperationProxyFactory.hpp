@@ -1,21 +1,42 @@
 #pragma once
 
 #include "stdafx.h"
+#include <functional>
 #include <memory>
+#include <mutex>
 #include "IO/IoProxy.hpp"
+#include "thread_pool.hpp"
 #include "vfm/vfm_file.hpp"
 #include "FileOperationProxy.hpp"
 #include "FileOperationProxyFactory.hpp"
 
 namespace dargon {
    namespace Subsystems {
+      typedef std::function<std::shared_ptr<dargon::vfm_file>()> vfm_loader;
+      typedef std::function<void()> vfm_invalidator;
+
       class RemappedFileOperationProxyFactory : public FileOperationProxyFactory, dargon::noncopyable {
          std::shared_ptr<dargon::IO::IoProxy> io_proxy;
+         vfm_loader load_virtual_file_map;
+         vfm_invalidator invalidate_virtual_file_map;
+         std::once_flag virtual_file_map_loaded;
          std::shared_ptr<dargon::vfm_file> virtual_file_map;
+         std::shared_ptr<dargon::thread_pool> io_thread_pool;
+         int64_t read_ahead_max_window;
 
       public:
-         RemappedFileOperationProxyFactory(std::shared_ptr<dargon::IO::IoProxy> io_proxy, std::shared_ptr<dargon::vfm_file> virtual_file_map);
+         // The vfm is loaded by load_virtual_file_map on the first create(), so maps for files the
+         // game never opens are never parsed. If loading fails, the file is passed through unremapped.
+         // Proxies complete overlapped reads and prefetch on io_thread_pool. Read-ahead is off if
+         // the pool is null or read_ahead_max_window is zero. invalidate_virtual_file_map drops
+         // what is cached of the files the vfm reads from.
+         RemappedFileOperationProxyFactory(std::shared_ptr<dargon::IO::IoProxy> io_proxy, vfm_loader load_virtual_file_map, vfm_invalidator invalidate_virtual_file_map, std::shared_ptr<dargon::thread_pool> io_thread_pool, int64_t read_ahead_max_window);
+         void prepare() override;
+         void invalidate() override;
          std::shared_ptr<FileOperationProxy> create() override;
+
+      private:
+         void ensure_loaded();
       };
    }
 }
\ No newline at end of file
@@ -1,25 +1,44 @@
 #include "stdafx.h"
-#include <fstream>
 #include "RemappedFileOperationProxyFactoryFactory.hpp"
 
 using namespace dargon::Subsystems;
 
 RemappedFileOperationProxyFactoryFactory::RemappedFileOperationProxyFactoryFactory(
    std::shared_ptr<dargon::IO::IoProxy> io_proxy,
-   std::shared_ptr<dargon::vfm_reader> virtual_file_map_reader
-) : io_proxy(io_proxy), virtual_file_map_reader(virtual_file_map_reader) { 
+   std::shared_ptr<dargon::vfm_reader> virtual_file_map_reader,
+   std::shared_ptr<dargon::thread_pool> io_thread_pool,
+   int64_t read_ahead_max_window
+) : io_proxy(io_proxy), virtual_file_map_reader(virtual_file_map_reader), io_thread_pool(io_thread_pool), read_ahead_max_window(read_ahead_max_window) { 
 }
 
 std::shared_ptr<RemappedFileOperationProxyFactory> RemappedFileOperationProxyFactoryFactory::create(std::string vfm_path) {
-   std::cout << "RFOPFF for vfm " << vfm_path << std::endl;
-   auto fs = std::make_shared<std::fstream>();
-   fs->open(vfm_path.c_str(), std::fstream::in | std::fstream::binary);
-   if (!fs->is_open()) {
-      std::cout << "Failed to open " << vfm_path << std::endl;
+   return create(vfm_path, std::vector<std::string>());
+}
+
+std::shared_ptr<RemappedFileOperationProxyFactory> RemappedFileOperationProxyFactoryFactory::create(std::string base_path, std::vector<std::string> layer_paths) {
+   std::cout << "RFOPFF for vfm " << base_path << " with " << layer_paths.size() << " layers" << std::endl;
+   auto paths = layer_paths;
+   paths.insert(paths.begin(), base_path);
+   for (auto& path : paths) {
+      if (!virtual_file_map_reader->validate(path)) {
+         return nullptr;
+      }
    }
 
-   binary_reader reader(fs);
-   auto vfm = virtual_file_map_reader->load(reader);
-   fs->close();
-   return std::make_shared<RemappedFileOperationProxyFactory>(io_proxy, vfm);
+   auto reader = virtual_file_map_reader;
+   dargon::Subsystems::vfm_loader loader;
+   if (layer_paths.empty()) {
+      loader = [reader, base_path] { return reader->load(base_path); };
+   } else {
+      loader = [reader, paths] {
+         auto overlay = reader->load_overlay(paths);
+         return reader->compose(*overlay);
+      };
+   }
+   auto invalidator = [reader, paths] {
+      for (auto& path : paths) {
+         reader->invalidate(path);
+      }
+   };
+   return std::make_shared<RemappedFileOperationProxyFactory>(io_proxy, loader, invalidator, io_thread_pool, read_ahead_max_window);
 }
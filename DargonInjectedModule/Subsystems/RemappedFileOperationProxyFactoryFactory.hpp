@@ -1,6 +1,8 @@
 #pragma once
 #include "stdafx.h"
+#include <vector>
 #include "IO/IoProxy.hpp"
+#include "thread_pool.hpp"
 #include "vfm/vfm_reader.hpp"
 #include "RemappedFileOperationProxyFactory.hpp"
 
@@ -9,10 +11,17 @@ namespace dargon {
       class RemappedFileOperationProxyFactoryFactory {
          std::shared_ptr<dargon::IO::IoProxy> io_proxy;
          std::shared_ptr<dargon::vfm_reader> virtual_file_map_reader;
+         std::shared_ptr<dargon::thread_pool> io_thread_pool;
+         int64_t read_ahead_max_window;
 
       public:
-         RemappedFileOperationProxyFactoryFactory(std::shared_ptr<dargon::IO::IoProxy> io_proxy, std::shared_ptr<dargon::vfm_reader> virtual_file_map_reader);
+         RemappedFileOperationProxyFactoryFactory(std::shared_ptr<dargon::IO::IoProxy> io_proxy, std::shared_ptr<dargon::vfm_reader> virtual_file_map_reader, std::shared_ptr<dargon::thread_pool> io_thread_pool, int64_t read_ahead_max_window);
+         // Only checks the vfm's header; its sectors are read on the first open of the remapped file.
+         // Returns nullptr if the vfm is missing or malformed.
          std::shared_ptr<RemappedFileOperationProxyFactory> create(std::string path);
+
+         // As above for a base vfm overlaid by per-mod layers, later layers taking precedence.
+         std::shared_ptr<RemappedFileOperationProxyFactory> create(std::string base_path, std::vector<std::string> layer_paths);
       };
    }
 }
\ No newline at end of file
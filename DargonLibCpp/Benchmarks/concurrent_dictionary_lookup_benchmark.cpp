@@ -0,0 +1,99 @@
+// Measures FileSubsystem's hot lookup, a handle mapped to a shared_ptr proxy, from many threads
+// at once: concurrent_dictionary, whose lookups lock a bucket mutex, against
+// lock_free_dictionary, whose lookups take an epoch guard, both copying the shared_ptr out; and
+// lock_free_dictionary::visit, which uses it in place and touches no reference count. Threads
+// either spread over many open handles or all read the same one, as a game streaming one
+// archive does, where every copy bounces that one proxy's count between cores.
+//
+// Portable; built by DargonLibCpp/CMakeLists.txt.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "concurrent_dictionary.hpp"
+#include "lock_free_dictionary.hpp"
+
+using namespace dargon;
+
+namespace {
+   const int kHandleCount = 512;
+   const int kLookupsPerThread = 1000000;
+
+   struct proxy {
+      int id;
+   };
+
+   typedef void* handle_t;
+
+   handle_t handle_of(int i) {
+      // Handles are multiples of four.
+      return reinterpret_cast<handle_t>(static_cast<intptr_t>(0x100 + i * 4));
+   }
+
+   // lookup(handle) returns the id of handle's proxy.
+   template <typename TLookup>
+   double run(TLookup lookup, int thread_count, bool same_handle) {
+      std::atomic<int> ready(0);
+      std::atomic<bool> go(false);
+      std::atomic<int64_t> checksum(0);
+      std::vector<std::thread> threads;
+      for (int t = 0; t < thread_count; t++) {
+         threads.emplace_back([&, t] {
+            ready++;
+            while (!go) {
+               std::this_thread::yield();
+            }
+            int64_t sum = 0;
+            for (int i = 0; i < kLookupsPerThread; i++) {
+               auto key = handle_of(same_handle ? 0 : (i * 7 + t * 131) % kHandleCount);
+               sum += lookup(key);
+            }
+            checksum += sum;
+         });
+      }
+      while (ready != thread_count) {
+         std::this_thread::yield();
+      }
+      auto start = std::chrono::steady_clock::now();
+      go = true;
+      for (auto& thread : threads) {
+         thread.join();
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return static_cast<double>(thread_count) * kLookupsPerThread / elapsed / 1e6;
+   }
+}
+
+int main() {
+   concurrent_dictionary<handle_t, std::shared_ptr<proxy>> locked;
+   lock_free_dictionary<handle_t, std::shared_ptr<proxy>> lock_free;
+   for (int i = 0; i < kHandleCount; i++) {
+      auto value = std::make_shared<proxy>(proxy{ i });
+      locked.insert(handle_of(i), value);
+      lock_free.insert(handle_of(i), value);
+   }
+
+   printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+   auto copy_locked = [&](handle_t key) { return locked.get_value_or_default(key)->id; };
+   auto copy_lock_free = [&](handle_t key) { return lock_free.get_value_or_default(key)->id; };
+   auto visit_lock_free = [&](handle_t key) {
+      int id = 0;
+      lock_free.visit(key, [&](const std::shared_ptr<proxy>& value) { id = value->id; });
+      return id;
+   };
+
+   printf("%-8s %7s %22s %22s %22s\n", "handles", "threads", "concurrent_dictionary", "lock_free_dictionary", "lock_free visit");
+   for (auto same_handle : { false, true }) {
+      for (int thread_count : { 1, 2, 4, 8, 16, 32 }) {
+         auto locked_rate = run(copy_locked, thread_count, same_handle);
+         auto lock_free_rate = run(copy_lock_free, thread_count, same_handle);
+         auto visit_rate = run(visit_lock_free, thread_count, same_handle);
+         printf("%-8s %7d %17.1f M/s %17.1f M/s %17.1f M/s\n", same_handle ? "one" : "many", thread_count, locked_rate, lock_free_rate, visit_rate);
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,68 @@
+// Measures vfm_overlay_merge composing a large base vfm with a stack of per-mod delta layers,
+// i.e. the work done each time a mod is toggled.
+//
+// Portable; build and run on Linux with:
+//    g++ -O2 -std=c++14 -I../src vfm_overlay_benchmark.cpp -o vfm_overlay_benchmark
+//    ./vfm_overlay_benchmark
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "vfm/vfm_overlay.hpp"
+
+using namespace dargon;
+
+namespace {
+   const int kRuns = 20;
+   const int kBaseSectors = 50000;
+   const int64_t kBaseSectorSize = 64 * 1024;
+
+   vfm_sector* fake_sector(intptr_t id) {
+      return reinterpret_cast<vfm_sector*>(id * 16);
+   }
+
+   std::vector<vfm_sector_index::entry_collection> make_layers(int delta_count, int ranges_per_delta, int64_t max_range_length, std::mt19937_64& rng) {
+      std::vector<vfm_sector_index::entry_collection> layers(delta_count + 1);
+      for (int i = 0; i < kBaseSectors; i++) {
+         layers[0].emplace_back(vfm_sector_range(i * kBaseSectorSize, (i + 1) * kBaseSectorSize), fake_sector(1));
+      }
+
+      auto extent = kBaseSectors * kBaseSectorSize;
+      auto mean_gap = extent / ranges_per_delta;
+      for (int layer = 1; layer <= delta_count; layer++) {
+         int64_t position = static_cast<int64_t>(rng() % mean_gap);
+         for (int i = 0; i < ranges_per_delta && position < extent; i++) {
+            auto length = 1 + static_cast<int64_t>(rng() % max_range_length);
+            layers[layer].emplace_back(vfm_sector_range(position, position + length), fake_sector(layer + 1));
+            position += length + static_cast<int64_t>(rng() % (2 * mean_gap));
+         }
+      }
+      return layers;
+   }
+
+   void run(const char* name, int delta_count, int ranges_per_delta, int64_t max_range_length) {
+      std::mt19937_64 rng(42);
+      auto layers = make_layers(delta_count, ranges_per_delta, max_range_length, rng);
+      size_t range_count = 0;
+      for (auto& layer : layers) {
+         range_count += layer.size();
+      }
+
+      size_t merged_count = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int run = 0; run < kRuns; run++) {
+         merged_count = vfm_overlay_merge(layers).size();
+      }
+      auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kRuns;
+      printf("%-8s %3d layers %7zu ranges -> %7zu merged   %8.2f ms\n", name, delta_count + 1, range_count, merged_count, elapsed);
+   }
+}
+
+int main() {
+   run("sparse", 10, 1000, 256 * 1024);
+   run("sparse", 50, 1000, 256 * 1024);
+   run("dense", 20, 5000, 4 * 1024 * 1024);
+   return 0;
+}
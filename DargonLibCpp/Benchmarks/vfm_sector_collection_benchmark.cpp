@@ -0,0 +1,75 @@
+// Measures a full mod relink through vfm_sector_collection: map a base archive, then for each
+// replaced entry unmap its old bytes and append the replacement at the end, as the linker does,
+// and finally serialize the result.
+//
+// Portable; built by DargonLibCpp/CMakeLists.txt.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "vfm/vfm_sector_collection.hpp"
+
+using namespace dargon;
+
+namespace {
+   const int kRuns = 5;
+   const int kArchiveEntries = 50000;
+   const int64_t kMaxEntrySize = 64 * 1024;
+
+   struct archive_entry {
+      int64_t offset;
+      int64_t length;
+   };
+
+   void run(int replaced_count) {
+      std::mt19937_64 rng(42);
+      std::vector<archive_entry> entries;
+      int64_t archive_size = 0;
+      for (int i = 0; i < kArchiveEntries; i++) {
+         auto length = 1 + static_cast<int64_t>(rng() % kMaxEntrySize);
+         entries.push_back(archive_entry{ archive_size, length });
+         archive_size += length;
+      }
+      std::shuffle(entries.begin(), entries.end(), rng);
+      entries.resize(replaced_count);
+
+      std::vector<std::string> replacement_paths;
+      for (int i = 0; i < replaced_count; i++) {
+         replacement_paths.push_back("objects/entry" + std::to_string(i) + ".bin");
+      }
+
+      size_t sector_count = 0;
+      size_t serialized_size = 0;
+      double relink_ms = 0;
+      double serialize_ms = 0;
+      for (int run = 0; run < kRuns; run++) {
+         auto start = std::chrono::steady_clock::now();
+         vfm_sector_collection sectors;
+         sectors.assign_sector(vfm_sector_range(0, archive_size), vfm_sector_source::file("archive.dat", 0));
+         for (int i = 0; i < replaced_count; i++) {
+            auto end = sectors.size();
+            sectors.delete_range(vfm_sector_range(entries[i].offset, entries[i].offset + entries[i].length));
+            sectors.assign_sector(vfm_sector_range(end, end + entries[i].length), vfm_sector_source::file(replacement_paths[i], 0));
+         }
+         auto relinked = std::chrono::steady_clock::now();
+         serialized_size = sectors.serialize().size();
+         auto serialized = std::chrono::steady_clock::now();
+
+         sector_count = sectors.sector_count();
+         relink_ms += std::chrono::duration<double, std::milli>(relinked - start).count() / kRuns;
+         serialize_ms += std::chrono::duration<double, std::milli>(serialized - relinked).count() / kRuns;
+      }
+      printf("%6d entries relinked -> %6zu sectors, %8zu bytes   relink %7.2f ms   serialize %7.2f ms\n", replaced_count, sector_count, serialized_size, relink_ms, serialize_ms);
+   }
+}
+
+int main() {
+   run(1000);
+   run(10000);
+   run(50000);
+   return 0;
+}
@@ -0,0 +1,96 @@
+// Measures the cost of resolving the sectors touched by a small read, comparing the sorted
+// vfm_sector_index against the linear scan + shared_ptr copy vfm_file::read used to perform.
+//
+// Portable; build and run on Linux with:
+//    g++ -O2 -std=c++14 -I../src vfm_sector_index_benchmark.cpp -o vfm_sector_index_benchmark
+//    ./vfm_sector_index_benchmark
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "vfm/vfm_sector_index.hpp"
+
+using namespace dargon;
+
+namespace {
+   typedef std::vector<std::pair<vfm_sector_range, std::shared_ptr<vfm_sector>>> linear_collection;
+
+   const int kLookupsPerRun = 200000;
+   const int64_t kReadLength = 4096;
+
+   int64_t linear_lookup(const linear_collection& sectors, const vfm_sector_range& test_range) {
+      auto collection = std::make_unique<linear_collection>();
+      for (auto it = sectors.begin(); it != sectors.end(); it++) {
+         if (test_range.intersects(it->first)) {
+            collection->emplace_back(*it);
+         }
+      }
+      return collection->size();
+   }
+
+   int64_t indexed_lookup(const vfm_sector_index& index, const vfm_sector_range& test_range) {
+      int64_t count = 0;
+      for (auto it = index.find_first(test_range.start_inclusive); it != index.end() && it->range.start_inclusive < test_range.end_exclusive; ++it) {
+         count++;
+      }
+      return count;
+   }
+
+   template <typename TLookup>
+   double time_lookups(const std::vector<int64_t>& offsets, TLookup lookup, int64_t* checksum) {
+      auto start = std::chrono::high_resolution_clock::now();
+      for (auto offset : offsets) {
+         *checksum += lookup(vfm_sector_range(offset, offset + kReadLength));
+      }
+      auto elapsed = std::chrono::high_resolution_clock::now() - start;
+      return std::chrono::duration<double, std::nano>(elapsed).count() / offsets.size();
+   }
+}
+
+int main() {
+   // A shared, never-freed owner gives the linear baseline real refcount traffic on copies.
+   static char dummy_sector;
+   std::shared_ptr<vfm_sector> shared_sector(reinterpret_cast<vfm_sector*>(&dummy_sector), [](vfm_sector*) {});
+
+   std::printf("%10s %16s %16s %10s\n", "sectors", "linear ns/read", "index ns/read", "speedup");
+   for (int sector_count = 1; sector_count <= 100000; sector_count *= 10) {
+      std::mt19937 random(sector_count);
+      std::uniform_int_distribution<int64_t> sector_length_distribution(512, 65536);
+
+      linear_collection linear;
+      vfm_sector_index::entry_collection entries;
+      int64_t position = 0;
+      for (int i = 0; i < sector_count; i++) {
+         vfm_sector_range range(position, position + sector_length_distribution(random));
+         linear.emplace_back(range, shared_sector);
+         entries.emplace_back(range, shared_sector.get());
+         position = range.end_exclusive;
+      }
+      vfm_sector_index index(std::move(entries));
+
+      std::uniform_int_distribution<int64_t> offset_distribution(0, position - 1);
+      std::vector<int64_t> offsets(kLookupsPerRun);
+      for (auto& offset : offsets) {
+         offset = offset_distribution(random);
+      }
+
+      // The linear scan is O(n) per read; trim its sample so large maps finish promptly.
+      std::vector<int64_t> linear_offsets(offsets.begin(), offsets.begin() + std::max(100, kLookupsPerRun / sector_count));
+
+      int64_t linear_checksum = 0, index_checksum = 0;
+      auto linear_ns = time_lookups(linear_offsets, [&](const vfm_sector_range& r) { return linear_lookup(linear, r); }, &linear_checksum);
+      auto index_ns = time_lookups(offsets, [&](const vfm_sector_range& r) { return indexed_lookup(index, r); }, &index_checksum);
+
+      std::printf("%10d %16.1f %16.1f %9.1fx\n", sector_count, linear_ns, index_ns, linear_ns / index_ns);
+      if (linear_checksum == 0 || index_checksum == 0) {
+         std::printf("unexpected empty lookups\n");
+         return 1;
+      }
+   }
+   return 0;
+}
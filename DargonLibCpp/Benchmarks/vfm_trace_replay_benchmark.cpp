@@ -0,0 +1,438 @@
+// Replays read patterns against vfm_files the way a game reads a remapped archive, one row per
+// sector backend and cache configuration, so regressions in the remapped read path show up as
+// a changed row. The patterns are those ghetto-rads-dummy drove by hand: sequential chunks of
+// 1 to 32K, the same chunks with a forward seek between each, and the chunks shuffled. Recorded
+// traces (one "offset length" pair per line) are replayed as further patterns.
+//
+// Each row reports throughput, p50/p99 per-read latency, backing syscalls per read (opens,
+// positional reads, maps, ...; counted by wrapping the io_backend) and bytes copied out of the
+// backing files per byte returned, which exceeds 1 where caches or read-ahead fetch more than
+// asked. Mapped sectors copy from their views instead and show 0. Every row of a pattern must
+// return the same bytes; a row that doesn't is marked MISMATCH.
+//
+// Without arguments, reads a synthetic vfm of 64MB scattered across four backing files, built
+// in a temporary directory. Captured maps are given with --vfm and are run positional, mapped
+// and cached. Backing files are warm in the page cache, so rows measure the engine rather than
+// the disk.
+//
+// Linux only; built by DargonLibCpp/CMakeLists.txt.
+//    vfm_trace_replay_benchmark [--vfm path.vfm]... [--trace path.txt]...
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "io/posix_io_backend.hpp"
+#include "vfm/vfm_compressed_format.hpp"
+#include "vfm/vfm_read_ahead.hpp"
+#include "vfm/vfm_reader.hpp"
+#include "vfm/vfm_sector_factory.hpp"
+
+using namespace dargon;
+
+namespace {
+   const int kBackingFileCount = 4;
+   const int64_t kBackingFileSize = 16 * 1024 * 1024;
+   const int64_t kSyntheticFileSize = 64 * 1024 * 1024;
+   const int64_t kMinSectorSize = 4 * 1024;
+   const int64_t kMaxSectorSize = 256 * 1024;
+   const int32_t kMaxChunkSize = 32 * 1024;
+
+   /// <summary>
+   /// Forwards to another io_backend, counting each call and the bytes read through it.
+   /// </summary>
+   class counting_io_backend : public io_backend {
+      std::shared_ptr<io_backend> inner;
+
+   public:
+      std::atomic<uint64_t> calls;
+      std::atomic<int64_t> bytes_read;
+
+      counting_io_backend(std::shared_ptr<io_backend> inner) : inner(inner), calls(0), bytes_read(0) { }
+
+      void reset() {
+         calls = 0;
+         bytes_read = 0;
+      }
+
+      file_handle open_read(const std::string& path) override {
+         calls++;
+         return inner->open_read(path);
+      }
+
+      int64_t read_at(file_handle file, int64_t offset, int64_t length, uint8_t* buffer) override {
+         calls++;
+         auto result = inner->read_at(file, offset, length, buffer);
+         bytes_read += result;
+         return result;
+      }
+
+      int64_t size(file_handle file) override {
+         calls++;
+         return inner->size(file);
+      }
+
+      void close(file_handle file) override {
+         calls++;
+         inner->close(file);
+      }
+
+      bool map(file_handle file, int64_t offset, int64_t length, mapped_range& result) override {
+         calls++;
+         return inner->map(file, offset, length, result);
+      }
+
+      void unmap(const mapped_range& range) override {
+         calls++;
+         inner->unmap(range);
+      }
+   };
+
+   enum class sector_kind { file, mapped, compressed };
+
+   struct configuration {
+      const char* name;
+      sector_kind kind;
+      bool block_cache;
+      bool read_ahead;
+   };
+
+   const configuration kConfigurations[] = {
+      { "file", sector_kind::file, false, false },
+      { "file+cache", sector_kind::file, true, false },
+      { "file+cache+ahead", sector_kind::file, true, true },
+      { "mapped", sector_kind::mapped, false, false },
+      { "lz4+cache", sector_kind::compressed, true, false },
+   };
+
+   struct read_op {
+      int64_t offset;
+      int64_t length;
+   };
+
+   struct pattern {
+      std::string name;
+      std::vector<read_op> reads;
+   };
+
+   // Where one synthetic sector's bytes live, both raw and as a compressed object.
+   struct synthetic_sector {
+      vfm_sector_range range;
+      std::string path;
+      int64_t offset;
+      int64_t packed_offset;
+   };
+
+   struct synthetic_vfm {
+      std::string directory;
+      std::string packed_path;
+      std::vector<std::string> paths;
+      std::vector<synthetic_sector> sectors;
+   };
+
+   // Fills buffer with bytes that compress about as well as game assets: runs of repeated
+   // short patterns broken up by noise.
+   void fill_backing_bytes(std::vector<uint8_t>& buffer, std::mt19937_64& rng) {
+      size_t i = 0;
+      while (i < buffer.size()) {
+         auto run = std::min<size_t>(buffer.size() - i, 16 + rng() % 512);
+         if (rng() % 4 == 0) {
+            for (size_t j = 0; j < run; j++) {
+               buffer[i + j] = static_cast<uint8_t>(rng());
+            }
+         } else {
+            auto period = 1 + rng() % 16;
+            auto seed = rng();
+            for (size_t j = 0; j < run; j++) {
+               buffer[i + j] = static_cast<uint8_t>(seed >> ((j % period) * 4));
+            }
+         }
+         i += run;
+      }
+   }
+
+   void write_file(const std::string& path, const std::vector<uint8_t>& contents) {
+      std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+      stream.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+      if (!stream) {
+         fprintf(stderr, "failed to write %s\n", path.c_str());
+         exit(1);
+      }
+   }
+
+   synthetic_vfm create_synthetic_vfm() {
+      char directory_template[] = "/tmp/vfm_trace_replay_XXXXXX";
+      if (!mkdtemp(directory_template)) {
+         perror("mkdtemp");
+         exit(1);
+      }
+
+      synthetic_vfm result;
+      result.directory = directory_template;
+      result.packed_path = result.directory + "/packed.bin";
+
+      std::mt19937_64 rng(42);
+      std::vector<std::vector<uint8_t>> contents(kBackingFileCount, std::vector<uint8_t>(kBackingFileSize));
+      for (int i = 0; i < kBackingFileCount; i++) {
+         fill_backing_bytes(contents[i], rng);
+         result.paths.push_back(result.directory + "/archive" + std::to_string(i) + ".bin");
+         write_file(result.paths.back(), contents[i]);
+      }
+
+      std::vector<uint8_t> packed;
+      for (int64_t position = 0; position < kSyntheticFileSize; ) {
+         auto length = std::min<int64_t>(kSyntheticFileSize - position, kMinSectorSize + rng() % (kMaxSectorSize - kMinSectorSize));
+         auto file_index = rng() % kBackingFileCount;
+         auto offset = static_cast<int64_t>(rng() % (kBackingFileSize - length));
+         auto encoded = vfm_compressed_encode(contents[file_index].data() + offset, static_cast<size_t>(length));
+         result.sectors.push_back(synthetic_sector{ vfm_sector_range(position, position + length), result.paths[file_index], offset, static_cast<int64_t>(packed.size()) });
+         packed.insert(packed.end(), encoded.begin(), encoded.end());
+         position += length;
+      }
+      write_file(result.packed_path, packed);
+      return result;
+   }
+
+   void remove_synthetic_vfm(const synthetic_vfm& vfm) {
+      for (auto& path : vfm.paths) {
+         unlink(path.c_str());
+      }
+      unlink(vfm.packed_path.c_str());
+      rmdir(vfm.directory.c_str());
+   }
+
+   std::shared_ptr<vfm_file> build_synthetic_file(const synthetic_vfm& vfm, vfm_sector_factory& factory, sector_kind kind) {
+      auto file = std::make_shared<vfm_file>();
+      for (auto& sector : vfm.sectors) {
+         auto length = sector.range.size();
+         switch (kind) {
+            case sector_kind::file:
+               file->assign_sector(sector.range, factory.create_file(sector.path, sector.offset, length));
+               break;
+            case sector_kind::mapped:
+               file->assign_sector(sector.range, factory.create_mapped(sector.path, sector.offset, length));
+               break;
+            case sector_kind::compressed:
+               file->assign_sector(sector.range, factory.create_compressed(vfm.packed_path, sector.packed_offset, length));
+               break;
+         }
+      }
+      file->build_index();
+      return file;
+   }
+
+   // ghetto-rads-dummy's chunking: consecutive chunks of 1 to 32K covering the whole file.
+   std::vector<read_op> generate_chunks(int64_t length) {
+      std::mt19937 rng(0);
+      std::uniform_int_distribution<int32_t> chunk_size_distribution(1, kMaxChunkSize);
+      std::vector<read_op> chunks;
+      for (int64_t start = 0; start < length; ) {
+         auto chunk_size = std::min<int64_t>(length - start, chunk_size_distribution(rng));
+         chunks.push_back(read_op{ start, chunk_size });
+         start += chunk_size;
+      }
+      return chunks;
+   }
+
+   std::vector<pattern> generate_patterns(int64_t length) {
+      std::vector<pattern> patterns;
+      auto chunks = generate_chunks(length);
+      patterns.push_back(pattern{ "sequential", chunks });
+
+      pattern seeking{ "seeking", {} };
+      for (size_t i = 0; i < chunks.size(); i += 2) {
+         seeking.reads.push_back(chunks[i]);
+      }
+      patterns.push_back(seeking);
+
+      std::mt19937 rng(0);
+      std::shuffle(chunks.begin(), chunks.end(), rng);
+      patterns.push_back(pattern{ "shuffled", chunks });
+      return patterns;
+   }
+
+   bool load_trace(const std::string& path, pattern& result) {
+      std::ifstream stream(path);
+      if (!stream) {
+         return false;
+      }
+      result.name = path.substr(path.find_last_of('/') + 1);
+      read_op op;
+      while (stream >> op.offset >> op.length) {
+         result.reads.push_back(op);
+      }
+      return true;
+   }
+
+   struct row_result {
+      double seconds;
+      int64_t bytes;
+      std::vector<double> latencies;
+      uint64_t checksum;
+   };
+
+   template <typename TRead>
+   row_result replay(const pattern& pattern, TRead&& read) {
+      int64_t max_length = 0;
+      for (auto& op : pattern.reads) {
+         max_length = std::max(max_length, op.length);
+      }
+      std::vector<uint8_t> buffer(static_cast<size_t>(max_length));
+
+      row_result result = { 0, 0, {}, 14695981039346656037ULL };
+      result.latencies.reserve(pattern.reads.size());
+      auto start = std::chrono::steady_clock::now();
+      for (auto& op : pattern.reads) {
+         auto read_start = std::chrono::steady_clock::now();
+         auto bytes_read = read(op.offset, op.length, buffer.data());
+         result.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - read_start).count());
+         result.bytes += bytes_read;
+
+         // FNV-1a over a sample of each read; enough to catch a row returning different bytes.
+         for (int64_t i = 0; i < bytes_read; i += 61) {
+            result.checksum = (result.checksum ^ buffer[static_cast<size_t>(i)]) * 1099511628211ULL;
+         }
+      }
+      result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return result;
+   }
+
+   double percentile(std::vector<double>& values, double p) {
+      if (values.empty()) {
+         return 0;
+      }
+      auto index = static_cast<size_t>(p * (values.size() - 1));
+      std::nth_element(values.begin(), values.begin() + index, values.end());
+      return values[index];
+   }
+
+   void print_header() {
+      printf("%-12s %-18s %7s %9s %9s %9s %10s %8s\n", "pattern", "configuration", "reads", "MB/s", "p50 us", "p99 us", "calls/read", "copy x");
+   }
+
+   void print_row(const pattern& pattern, const char* name, row_result& row, counting_io_backend& io, bool mismatch) {
+      auto reads = static_cast<double>(std::max<size_t>(1, pattern.reads.size()));
+      auto p50 = percentile(row.latencies, 0.50);
+      auto p99 = percentile(row.latencies, 0.99);
+      auto copies = row.bytes > 0 ? static_cast<double>(io.bytes_read) / row.bytes : 0;
+      printf("%-12s %-18s %7zu %9.1f %9.2f %9.2f %10.2f %8.2f%s\n",
+         pattern.name.c_str(), name, pattern.reads.size(), row.bytes / row.seconds / (1024 * 1024), p50, p99,
+         io.calls / reads, copies, mismatch ? "  MISMATCH" : "");
+   }
+
+   // Runs pattern against a fresh file per configuration, so each row starts with cold caches.
+   template <typename TCreateFile>
+   void run_configurations(const pattern& pattern, counting_io_backend& io, TCreateFile&& create_file) {
+      auto pool = std::make_shared<thread_pool>();
+      bool have_checksum = false;
+      uint64_t expected_checksum = 0;
+      for (auto& configuration : kConfigurations) {
+         auto file = create_file(configuration);
+         if (!file) {
+            continue;
+         }
+         io.reset();
+
+         row_result row;
+         if (configuration.read_ahead) {
+            auto read_ahead = std::make_shared<vfm_read_ahead>(file, pool);
+            row = replay(pattern, [&read_ahead](int64_t offset, int64_t length, uint8_t* buffer) { return read_ahead->read(offset, length, buffer); });
+
+            // A prefetch still in flight holds the read-ahead, and with it the pool; let it finish
+            // so the pool is never released from one of its own workers.
+            while (read_ahead.use_count() > 1) {
+               std::this_thread::yield();
+            }
+         } else {
+            row = replay(pattern, [&file](int64_t offset, int64_t length, uint8_t* buffer) { return file->read(offset, length, buffer, 0); });
+         }
+
+         bool mismatch = have_checksum && row.checksum != expected_checksum;
+         if (!have_checksum) {
+            have_checksum = true;
+            expected_checksum = row.checksum;
+         }
+         print_row(pattern, configuration.name, row, io, mismatch);
+      }
+   }
+}
+
+int main(int argc, char** argv) {
+   std::vector<std::string> vfm_paths;
+   std::vector<pattern> traces;
+   for (int i = 1; i < argc; i++) {
+      std::string argument = argv[i];
+      if (argument == "--vfm" && i + 1 < argc) {
+         vfm_paths.push_back(argv[++i]);
+      } else if (argument == "--trace" && i + 1 < argc) {
+         pattern trace;
+         if (!load_trace(argv[++i], trace)) {
+            fprintf(stderr, "failed to read trace %s\n", argv[i]);
+            return 1;
+         }
+         traces.push_back(trace);
+      } else {
+         fprintf(stderr, "usage: %s [--vfm path.vfm]... [--trace path.txt]...\n", argv[0]);
+         return 1;
+      }
+   }
+
+   auto io = std::make_shared<counting_io_backend>(std::make_shared<posix_io_backend>());
+
+   if (vfm_paths.empty()) {
+      auto vfm = create_synthetic_vfm();
+      printf("synthetic vfm: %zu sectors over %d files, %lld bytes\n", vfm.sectors.size(), kBackingFileCount, static_cast<long long>(kSyntheticFileSize));
+      print_header();
+
+      auto patterns = generate_patterns(kSyntheticFileSize);
+      patterns.insert(patterns.end(), traces.begin(), traces.end());
+      for (auto& pattern : patterns) {
+         run_configurations(pattern, *io, [&vfm, &io](const configuration& configuration) {
+            auto handle_cache = std::make_shared<vfm_handle_cache>(io);
+            auto block_cache = configuration.block_cache ? std::make_shared<vfm_block_cache>() : nullptr;
+            vfm_sector_factory factory(io, handle_cache, block_cache);
+            return build_synthetic_file(vfm, factory, configuration.kind);
+         });
+      }
+      remove_synthetic_vfm(vfm);
+   }
+
+   for (auto& vfm_path : vfm_paths) {
+      // A captured map's sector types are fixed, so only what vfm_reader chooses is varied:
+      // positional or mapped reads for its file sectors, and the caches.
+      int64_t file_size = 0;
+      {
+         auto header_reader = std::make_shared<vfm_reader>(io, std::make_shared<vfm_sector_factory>(io));
+         file_size = header_reader->load(vfm_path)->size();
+      }
+      printf("%s: %lld bytes\n", vfm_path.c_str(), static_cast<long long>(file_size));
+      print_header();
+
+      auto patterns = generate_patterns(file_size);
+      patterns.insert(patterns.end(), traces.begin(), traces.end());
+      for (auto& pattern : patterns) {
+         run_configurations(pattern, *io, [&vfm_path, &io](const configuration& configuration) -> std::shared_ptr<vfm_file> {
+            if (configuration.kind == sector_kind::compressed) {
+               return nullptr;
+            }
+            auto handle_cache = std::make_shared<vfm_handle_cache>(io);
+            auto block_cache = configuration.block_cache ? std::make_shared<vfm_block_cache>() : nullptr;
+            auto factory = std::make_shared<vfm_sector_factory>(io, handle_cache, block_cache);
+            auto max_mapped_sector_size = configuration.kind == sector_kind::mapped ? std::numeric_limits<int64_t>::max() : 0;
+            return vfm_reader(io, factory, max_mapped_sector_size).load(vfm_path);
+         });
+      }
+   }
+   return 0;
+}
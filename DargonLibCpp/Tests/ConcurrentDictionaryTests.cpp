@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
+#include <atomic>
 #include <random>
 #include <string>
 #include <thread>
@@ -17,6 +18,19 @@ namespace dargon {
       typedef concurrent_map<unsigned int, std::string> TDictionary;
       typedef std::numeric_limits<TKey> KeyLimits;
 
+      // Counts the copies made of it; moves are free.
+      struct CountedValue {
+         int* copies;
+         int value;
+
+         CountedValue() : copies(nullptr), value(0) { }
+         CountedValue(int* copies, int value) : copies(copies), value(value) { }
+         CountedValue(const CountedValue& other) : copies(other.copies), value(other.value) { ++*copies; }
+         CountedValue(CountedValue&& other) = default;
+         CountedValue& operator=(const CountedValue& other) { copies = other.copies; value = other.value; ++*copies; return *this; }
+         CountedValue& operator=(CountedValue&& other) = default;
+      };
+
    public:
       TDictionary dict;
 
@@ -57,6 +71,82 @@ namespace dargon {
          }
       }
 
+      TEST_METHOD(InPlacePrimitivesTest) {
+         concurrent_map<unsigned int, CountedValue> counted;
+         int copies = 0;
+         Assert::IsTrue(counted.try_emplace(10, &copies, 1));
+         Assert::IsFalse(counted.try_emplace(10, &copies, 2));
+         Assert::IsTrue(counted.compute_if_present(10, [](unsigned int key, const CountedValue& existing) { return CountedValue(existing.copies, existing.value + 1); }));
+         Assert::IsFalse(counted.compute_if_present(11, [](unsigned int key, const CountedValue& existing) { return existing; }));
+         Assert::AreEqual(0, copies);
+
+         // Only the returned value is copied out.
+         Assert::AreEqual(2, counted.get_or_add(10, [&](unsigned int key) { return CountedValue(&copies, 3); }).value);
+         Assert::AreEqual(4, counted.get_or_add(11, [&](unsigned int key) { return CountedValue(&copies, 4); }).value);
+         Assert::AreEqual(2, copies);
+         Assert::AreEqual((size_t)2, counted.size());
+      }
+
+      TEST_METHOD(StripeCountTest) {
+         Assert::AreEqual((size_t)0, dict.stripe_count() & (dict.stripe_count() - 1));
+         Assert::AreEqual((size_t)32, TDictionary(25).stripe_count());
+
+         const unsigned int entryCount = 10000;
+         for (auto i = 0U; i < entryCount; i++) {
+            dict.insert(i, std::to_string(i));
+         }
+         dict.resize_stripes(512);
+         Assert::AreEqual((size_t)512, dict.stripe_count());
+         Assert::AreEqual((size_t)entryCount, dict.size());
+         Assert::AreEqual((ptrdiff_t)entryCount, std::distance(dict.begin(), dict.end()));
+         for (auto i = 0U; i < entryCount; i++) {
+            Assert::AreEqual(std::to_string(i), dict.get_value_or_default(i));
+         }
+      }
+
+      TEST_METHOD(StripesStartOnCacheLinesTest) {
+         concurrent_dictionary_table<unsigned int, std::string> table(16);
+         for (size_t i = 0; i < table.bucket_count(); i++) {
+            Assert::AreEqual((uintptr_t)0, reinterpret_cast<uintptr_t>(&table.buckets[i]) % kCacheLineSize);
+         }
+      }
+
+      TEST_METHOD(ResizeWhileInUseTest) {
+         // Writers add and remove their own keys while the stripes are resized underneath them;
+         // nothing they add may be lost and nothing they remove may come back.
+         const unsigned int threadCount = 4;
+         const unsigned int keysPerThread = 5000;
+         std::atomic<unsigned int> failures(0);
+         std::vector<std::thread> threads;
+         for (auto t = 0U; t < threadCount; t++) {
+            threads.emplace_back([&, t] {
+               auto base = t * keysPerThread;
+               for (auto i = 0U; i < keysPerThread; i++) {
+                  dict.insert(base + i, std::to_string(base + i));
+               }
+               for (auto i = 0U; i < keysPerThread; i += 2) {
+                  if (!dict.remove(base + i)) {
+                     failures++;
+                  }
+               }
+               for (auto i = 0U; i < keysPerThread; i++) {
+                  if (dict.contains(base + i) != (i % 2 == 1)) {
+                     failures++;
+                  }
+               }
+            });
+         }
+         for (auto stripes = 8U; stripes <= 1024; stripes *= 2) {
+            dict.resize_stripes(stripes);
+         }
+         for (auto& thread : threads) {
+            thread.join();
+         }
+
+         Assert::AreEqual(0U, failures.load());
+         Assert::AreEqual((size_t)(threadCount * keysPerThread / 2), dict.size());
+      }
+
       TEST_METHOD(MultiThreadedTest)
       {
          const unsigned int threadCount = 16;
@@ -0,0 +1,163 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <lock_free_dictionary.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(LockFreeDictionaryTests) {
+      typedef lock_free_dictionary<unsigned int, std::string> TDictionary;
+
+      // Counts the copies made of it; moves are free.
+      struct CountedValue {
+         int* copies;
+         int value;
+
+         CountedValue() : copies(nullptr), value(0) { }
+         CountedValue(int* copies, int value) : copies(copies), value(value) { }
+         CountedValue(const CountedValue& other) : copies(other.copies), value(other.value) { ++*copies; }
+         CountedValue(CountedValue&& other) = default;
+         CountedValue& operator=(const CountedValue& other) { copies = other.copies; value = other.value; ++*copies; return *this; }
+         CountedValue& operator=(CountedValue&& other) = default;
+      };
+
+   public:
+      TEST_METHOD(InsertAndRemoveTest) {
+         TDictionary dict;
+         Assert::IsTrue(dict.insert(10, "asdf"));
+         Assert::IsFalse(dict.insert(10, "qwerty"));
+         Assert::AreEqual(std::string("asdf"), dict.get_value_or_default(10));
+         Assert::AreEqual(std::string(), dict.get_value_or_default(11));
+         Assert::IsTrue(dict.remove(10));
+         Assert::IsFalse(dict.remove(10));
+         Assert::IsFalse(dict.contains(10));
+         Assert::AreEqual((size_t)0, dict.size());
+      }
+
+      TEST_METHOD(AddOrUpdateTest) {
+         TDictionary dict;
+         auto add = [](unsigned int key) { return std::string("added"); };
+         auto update = [](unsigned int key, const std::string& existing) { return existing + "+"; };
+         dict.add_or_update(10, add, update);
+         dict.add_or_update(10, add, update);
+         Assert::AreEqual(std::string("added+"), dict.get_value_or_default(10));
+         Assert::AreEqual((size_t)1, dict.size());
+      }
+
+      TEST_METHOD(ConditionalRemoveTest) {
+         TDictionary dict;
+         dict.insert(10, "asdf");
+         Assert::IsFalse(dict.conditional_remove(10, [](unsigned int key, const std::string& value) { return value == "qwerty"; }));
+         Assert::AreEqual((size_t)1, dict.size());
+         Assert::IsTrue(dict.conditional_remove(10, [](unsigned int key, const std::string& value) { return value == "asdf"; }));
+         Assert::AreEqual((size_t)0, dict.size());
+      }
+
+      TEST_METHOD(InPlacePrimitivesTest) {
+         lock_free_dictionary<unsigned int, CountedValue> counted;
+         int copies = 0;
+         Assert::IsTrue(counted.try_emplace(10, &copies, 1));
+         Assert::IsFalse(counted.try_emplace(10, &copies, 2));
+         Assert::IsTrue(counted.compute_if_present(10, [](unsigned int key, const CountedValue& existing) { return CountedValue(existing.copies, existing.value + 1); }));
+         Assert::IsFalse(counted.compute_if_present(11, [](unsigned int key, const CountedValue& existing) { return existing; }));
+         Assert::AreEqual(0, copies);
+
+         // Only the returned value is copied out.
+         Assert::AreEqual(2, counted.get_or_add(10, [&](unsigned int key) { return CountedValue(&copies, 3); }).value);
+         Assert::AreEqual(4, counted.get_or_add(11, [&](unsigned int key) { return CountedValue(&copies, 4); }).value);
+         Assert::AreEqual(2, copies);
+         Assert::AreEqual((size_t)2, counted.size());
+      }
+
+      TEST_METHOD(VisitTest) {
+         lock_free_dictionary<unsigned int, std::shared_ptr<std::string>> dict;
+         auto value = std::make_shared<std::string>("asdf");
+         dict.insert(10, value);
+         Assert::IsFalse(dict.visit(11, [](const std::shared_ptr<std::string>&) { Assert::Fail(); }));
+
+         // The visited value stays put even when removed and collected mid-visit.
+         auto visited = dict.visit(10, [&](const std::shared_ptr<std::string>& existing) {
+            Assert::AreEqual(2L, value.use_count());
+            Assert::IsTrue(dict.remove(10));
+            epoch_reclaimer::instance().collect();
+            Assert::AreEqual(std::string("asdf"), *existing);
+         });
+         Assert::IsTrue(visited);
+         epoch_reclaimer::instance().collect();
+         Assert::AreEqual(1L, value.use_count());
+      }
+
+      TEST_METHOD(GrowsKeepingEntriesTest) {
+         TDictionary dict;
+         const unsigned int entryCount = 10000;
+         for (auto i = 0U; i < entryCount; i++) {
+            Assert::IsTrue(dict.insert(i * 4, std::to_string(i)));
+         }
+         Assert::AreEqual((size_t)entryCount, dict.size());
+         for (auto i = 0U; i < entryCount; i++) {
+            Assert::AreEqual(std::to_string(i), dict.get_value_or_default(i * 4));
+         }
+         for (auto i = 0U; i < entryCount; i++) {
+            Assert::IsTrue(dict.remove(i * 4));
+         }
+         Assert::AreEqual((size_t)0, dict.size());
+      }
+
+      TEST_METHOD(ReadersDuringWritesTest) {
+         // Stable keys must stay visible with their values while writers churn other keys in
+         // the same buckets and grow the table underneath the readers.
+         const unsigned int stableCount = 256;
+         const unsigned int readerCount = 4;
+         const unsigned int writerCount = 2;
+         lock_free_dictionary<unsigned int, std::shared_ptr<unsigned int>> dict;
+         for (auto i = 0U; i < stableCount; i++) {
+            dict.insert(i, std::make_shared<unsigned int>(i));
+         }
+
+         std::atomic<bool> done(false);
+         std::atomic<unsigned int> failures(0);
+         std::vector<std::thread> threads;
+         for (auto t = 0U; t < readerCount; t++) {
+            threads.emplace_back([&, t] {
+               for (auto i = t; !done; i = (i + 1) % stableCount) {
+                  auto value = dict.get_value_or_default(i);
+                  if (!value || *value != i) {
+                     failures++;
+                  }
+               }
+            });
+         }
+         for (auto t = 0U; t < writerCount; t++) {
+            threads.emplace_back([&, t] {
+               auto base = stableCount + t * 100000;
+               for (auto round = 0; round < 5; round++) {
+                  for (auto i = 0U; i < 5000; i++) {
+                     dict.insert(base + i, std::make_shared<unsigned int>(base + i));
+                  }
+                  for (auto i = 0U; i < stableCount; i++) {
+                     dict.add_or_update(i, [](unsigned int key) { return std::make_shared<unsigned int>(key); }, [](unsigned int key, std::shared_ptr<unsigned int>) { return std::make_shared<unsigned int>(key); });
+                  }
+                  for (auto i = 0U; i < 5000; i++) {
+                     dict.remove(base + i);
+                  }
+               }
+            });
+         }
+         for (auto t = readerCount; t < threads.size(); t++) {
+            threads[t].join();
+         }
+         done = true;
+         for (auto t = 0U; t < readerCount; t++) {
+            threads[t].join();
+         }
+
+         Assert::AreEqual(0U, failures.load());
+         Assert::AreEqual((size_t)stableCount, dict.size());
+      }
+   };
+}
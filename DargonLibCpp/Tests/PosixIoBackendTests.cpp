@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <io/posix_io_backend.hpp>
+#include <vfm/vfm_reader.hpp>
+#include <vfm/vfm_sector_collection.hpp>
+#include <vfm/vfm_sector_factory.hpp>
+#include <vfm/vfm_writer.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(PosixIoBackendTests) {
+      std::shared_ptr<posix_io_backend> io;
+      std::string path;
+      std::vector<uint8_t> contents;
+
+   public:
+      TEST_METHOD_INITIALIZE(Setup) {
+         io = std::make_shared<posix_io_backend>();
+         char path_template[] = "/tmp/dargon_posix_io_XXXXXX";
+         int fd = mkstemp(path_template);
+         Assert::IsTrue(fd >= 0);
+         path = path_template;
+
+         // A few pages, so mapped ranges start off a page boundary.
+         contents.resize(3 * 4096 + 123);
+         for (size_t i = 0; i < contents.size(); i++) {
+            contents[i] = static_cast<uint8_t>(i * 7 + 3);
+         }
+         Assert::AreEqual(static_cast<ssize_t>(contents.size()), write(fd, contents.data(), contents.size()));
+         close(fd);
+      }
+
+      ~PosixIoBackendTests() {
+         if (!path.empty()) {
+            unlink(path.c_str());
+         }
+      }
+
+      TEST_METHOD(ReadAtAndSizeTest) {
+         auto file = io->open_read(path);
+         Assert::IsTrue(file != io_backend::kInvalidFile);
+         Assert::AreEqual(static_cast<int64_t>(contents.size()), io->size(file));
+
+         std::vector<uint8_t> buffer(100);
+         Assert::AreEqual(100LL, io->read_at(file, 5000, 100, buffer.data()));
+         Assert::IsTrue(std::equal(buffer.begin(), buffer.end(), contents.begin() + 5000));
+
+         // Reads stop short at end of file.
+         Assert::AreEqual(23LL, io->read_at(file, contents.size() - 23, 100, buffer.data()));
+         io->close(file);
+      }
+
+      TEST_METHOD(OpenMissingFileTest) {
+         Assert::IsTrue(io->open_read(path + ".missing") == io_backend::kInvalidFile);
+      }
+
+      TEST_METHOD(MapUnalignedRangeTest) {
+         auto file = io->open_read(path);
+         io_backend::mapped_range range;
+         Assert::IsTrue(io->map(file, 4097, 5000, range));
+         io->close(file);
+
+         Assert::IsTrue(std::equal(range.data, range.data + 5000, contents.begin() + 4097));
+         io->unmap(range);
+      }
+
+      TEST_METHOD(HandleCacheInvalidateTest) {
+         vfm_handle_cache cache(io);
+         auto first = cache.get(path);
+         Assert::IsTrue(first == cache.get(path));
+
+         // Dropping the path reopens it on the next get; handles already taken keep working.
+         cache.invalidate(path);
+         Assert::AreEqual((size_t)0, cache.size());
+         auto second = cache.get(path);
+         Assert::IsTrue(first != second);
+         uint8_t value = 0;
+         Assert::AreEqual(1LL, first->read(100, 1, &value));
+         Assert::AreEqual(contents[100], value);
+         cache.invalidate(path + ".missing");
+         Assert::AreEqual((size_t)1, cache.size());
+      }
+
+      TEST_METHOD(FileAndMappedSectorsTest) {
+         vfm_sector_factory factory(io);
+         auto file_sector = factory.create_file(path, 1000, 9000);
+         auto mapped_sector = factory.create_mapped(path, 1000, 9000);
+         Assert::AreEqual(9000LL, file_sector->size());
+         Assert::AreEqual(9000LL, mapped_sector->size());
+
+         std::vector<uint8_t> file_buffer(300), mapped_buffer(300);
+         file_sector->read(4000, 300, file_buffer.data(), 0);
+         mapped_sector->read(4000, 300, mapped_buffer.data(), 0);
+         Assert::IsTrue(std::equal(file_buffer.begin(), file_buffer.end(), contents.begin() + 5000));
+         Assert::IsTrue(file_buffer == mapped_buffer);
+      }
+
+      TEST_METHOD(MappingCacheTest) {
+         auto file_size = static_cast<int64_t>(contents.size());
+         auto files = std::make_shared<vfm_handle_cache>(io);
+         auto cache = std::make_shared<vfm_mapping_cache>(io, file_size);
+         auto view = cache->get(path, files->get(path));
+         Assert::IsTrue(view != nullptr);
+         Assert::IsTrue(view == cache->get(path, files->get(path)));
+         Assert::AreEqual(file_size, cache->size());
+
+         // The same file by another name would go over budget.
+         auto alias = "/tmp/." + path.substr(4);
+         Assert::IsTrue(cache->get(alias, files->get(alias)) == nullptr);
+
+         // Sectors share the file's one view; a sector past its end falls back to reads.
+         vfm_sector_factory factory(io, files, nullptr, cache);
+         auto first = factory.create_mapped(path, 0, 100);
+         auto second = factory.create_mapped(path, 5000, 100);
+         auto past_end = factory.create_mapped(path, file_size - 100, 300);
+         Assert::IsTrue(first->borrow(0, 100) == view->data());
+         Assert::IsTrue(second->borrow(0, 100) == view->data() + 5000);
+         Assert::IsTrue(past_end->borrow(0, 100) == nullptr);
+         std::vector<uint8_t> buffer(300, 0xCC);
+         past_end->read(0, 300, buffer.data(), 0);
+         Assert::IsTrue(std::equal(buffer.begin(), buffer.begin() + 100, contents.end() - 100));
+         Assert::IsTrue(std::all_of(buffer.begin() + 100, buffer.end(), [](uint8_t b) { return b == 0; }));
+         Assert::AreEqual(file_size, cache->size());
+
+         // Invalidated views stay mapped, and counted, until the sectors holding them go.
+         factory.invalidate(path);
+         view.reset();
+         Assert::AreEqual(file_size, cache->size());
+         first.reset();
+         second.reset();
+         Assert::AreEqual(0LL, cache->size());
+         Assert::IsTrue(cache->get(path, files->get(path)) != nullptr);
+         Assert::AreEqual(file_size, cache->size());
+      }
+
+      TEST_METHOD(ReloadKeepsOpenFilesOnTheirBackingFileTest) {
+         // [0, 6000) stays positional and [6000, 6300) is mapped, in a v1 and a v2 vfm.
+         vfm_sector_collection sectors;
+         sectors.assign_sector(vfm_sector_range(0, 6000), vfm_sector_source::file(path, 0));
+         sectors.assign_sector(vfm_sector_range(6000, 6300), vfm_sector_source::file(path, 7000));
+         auto expected = [](const std::vector<uint8_t>& backing) {
+            std::vector<uint8_t> result(backing.begin(), backing.begin() + 6000);
+            result.insert(result.end(), backing.begin() + 7000, backing.begin() + 7300);
+            return result;
+         };
+         std::string vfm_paths[] = { path + ".v1", path + ".v2" };
+         vfm_writer::save(vfm_paths[0], vfm_writer::write_v1(sectors));
+         vfm_writer::save(vfm_paths[1], vfm_writer::write_v2(sectors));
+
+         vfm_reader reader(io, std::make_shared<vfm_sector_factory>(io), 500);
+         std::vector<std::shared_ptr<vfm_file>> before;
+         for (auto& vfm_path : vfm_paths) {
+            before.push_back(reader.load(vfm_path));
+         }
+
+         // Warm the v1 file's block cache; its mapped sector and the whole v2 file stay unread.
+         std::vector<uint8_t> buffer(6300);
+         Assert::AreEqual(100LL, before[0]->read(0, 100, buffer.data(), 0));
+
+         // A reload replaces the backing file, then drops the caches and loads the vfms afresh.
+         std::vector<uint8_t> new_contents(contents.size());
+         for (size_t i = 0; i < new_contents.size(); i++) {
+            new_contents[i] = static_cast<uint8_t>(i * 11 + 5);
+         }
+         vfm_writer::save(path + ".new", new_contents);
+         Assert::AreEqual(0, rename((path + ".new").c_str(), path.c_str()));
+         std::vector<std::shared_ptr<vfm_file>> after;
+         for (auto& vfm_path : vfm_paths) {
+            reader.invalidate(vfm_path);
+            after.push_back(reader.load(vfm_path));
+         }
+
+         for (auto& file : before) {
+            Assert::AreEqual(6300LL, file->read(0, 6300, buffer.data(), 0));
+            Assert::IsTrue(buffer == expected(contents));
+         }
+         for (auto& file : after) {
+            Assert::AreEqual(6300LL, file->read(0, 6300, buffer.data(), 0));
+            Assert::IsTrue(buffer == expected(new_contents));
+         }
+         for (auto& vfm_path : vfm_paths) {
+            unlink(vfm_path.c_str());
+         }
+      }
+   };
+}
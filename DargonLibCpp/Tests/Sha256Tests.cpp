@@ -0,0 +1,44 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <algorithm>
+#include <string>
+#include <sha256.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(Sha256Tests) {
+      static std::string ToHex(const sha256_digest& digest) {
+         static const char kDigits[] = "0123456789abcdef";
+         std::string result;
+         for (auto b : digest) {
+            result += kDigits[b >> 4];
+            result += kDigits[b & 0x0F];
+         }
+         return result;
+      }
+
+      static std::string Hash(const std::string& message) {
+         return ToHex(sha256::compute(reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+      }
+
+   public:
+      TEST_METHOD(KnownVectorsTest) {
+         Assert::AreEqual(std::string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"), Hash(""));
+         Assert::AreEqual(std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"), Hash("abc"));
+         Assert::AreEqual(std::string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"), Hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+      }
+
+      TEST_METHOD(IncrementalMatchesOneShotTest) {
+         std::string message;
+         for (int i = 0; i < 1000; i++) {
+            message += static_cast<char>(i * 7);
+         }
+         sha256 hash;
+         for (size_t position = 0, step = 1; position < message.size(); position += step, step = step % 70 + 3) {
+            hash.update(reinterpret_cast<const uint8_t*>(message.data()) + position, std::min(step, message.size() - position));
+         }
+         Assert::AreEqual(Hash(message), ToHex(hash.finish()));
+      }
+   };
+}
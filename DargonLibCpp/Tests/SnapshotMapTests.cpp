@@ -0,0 +1,104 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <snapshot_map.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(SnapshotMapTests) {
+      typedef snapshot_map<unsigned int, std::string> TMap;
+
+   public:
+      TEST_METHOD(AssignAndEraseTest) {
+         TMap map;
+         Assert::AreEqual(std::string(), map.get_value_or_default(10));
+         map.assign(10, "asdf");
+         map.assign(10, "qwerty");
+         Assert::AreEqual(std::string("qwerty"), map.get_value_or_default(10));
+         Assert::IsFalse(map.contains(11));
+         map.erase(10);
+         Assert::IsFalse(map.contains(10));
+         Assert::AreEqual((size_t)0, map.size());
+      }
+
+      TEST_METHOD(PublishBatchTest) {
+         TMap map;
+         TMap::batch first;
+         for (auto i = 0U; i < 1000; i++) {
+            first.assign(i * 16, std::to_string(i));
+         }
+         first.erase(0);
+         map.publish(first);
+         Assert::AreEqual((size_t)999, map.size());
+         Assert::IsFalse(map.contains(0));
+         for (auto i = 1U; i < 1000; i++) {
+            Assert::AreEqual(std::to_string(i), map.get_value_or_default(i * 16));
+         }
+
+         // A batch that clears replaces everything published before it.
+         TMap::batch second;
+         second.assign(1, "stale");
+         second.clear();
+         second.assign(2, "fresh");
+         map.publish(second);
+         Assert::AreEqual((size_t)1, map.size());
+         Assert::IsFalse(map.contains(1));
+         Assert::IsFalse(map.contains(16));
+         Assert::AreEqual(std::string("fresh"), map.get_value_or_default(2));
+
+         size_t assignments = 0;
+         second.for_each_assignment([&](unsigned int key, const std::string& value) { assignments++; });
+         Assert::AreEqual((size_t)1, assignments);
+      }
+
+      TEST_METHOD(ReadersDuringPublishTest) {
+         // Stable keys must stay visible while batches of other keys come and go.
+         const unsigned int stableCount = 64;
+         snapshot_map<unsigned int, std::shared_ptr<unsigned int>> map;
+         snapshot_map<unsigned int, std::shared_ptr<unsigned int>>::batch stable;
+         for (auto i = 0U; i < stableCount; i++) {
+            stable.assign(i, std::make_shared<unsigned int>(i));
+         }
+         map.publish(stable);
+
+         std::atomic<bool> done(false);
+         std::atomic<unsigned int> failures(0);
+         std::vector<std::thread> readers;
+         for (auto t = 0U; t < 4; t++) {
+            readers.emplace_back([&, t] {
+               for (auto i = t; !done; i = (i + 1) % stableCount) {
+                  auto found = map.visit(i, [&](const std::shared_ptr<unsigned int>& value) {
+                     if (*value != i) {
+                        failures++;
+                     }
+                  });
+                  if (!found) {
+                     failures++;
+                  }
+               }
+            });
+         }
+         for (auto round = 0U; round < 200; round++) {
+            snapshot_map<unsigned int, std::shared_ptr<unsigned int>>::batch churn;
+            for (auto i = 0U; i < 100; i++) {
+               auto key = stableCount + (round % 2) * 100 + i;
+               churn.assign(key, std::make_shared<unsigned int>(key));
+               churn.erase(stableCount + ((round + 1) % 2) * 100 + i);
+            }
+            map.publish(churn);
+         }
+         done = true;
+         for (auto& reader : readers) {
+            reader.join();
+         }
+
+         Assert::AreEqual(0U, failures.load());
+         Assert::AreEqual((size_t)(stableCount + 100), map.size());
+      }
+   };
+}
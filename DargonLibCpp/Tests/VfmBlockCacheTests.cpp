@@ -0,0 +1,156 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <vfm/vfm_block_cache.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmBlockCacheTests) {
+      static constexpr int64_t kBlockSize = 1024;
+
+      // Stands in for a backing file; counts the fills made of it.
+      struct backing_file {
+         std::vector<uint8_t> contents;
+         int fills = 0;
+
+         backing_file(size_t length, uint8_t seed) : contents(length) {
+            for (size_t i = 0; i < length; i++) {
+               contents[i] = static_cast<uint8_t>(i * 13 + seed);
+            }
+         }
+
+         int64_t fill(int64_t offset, int64_t length, uint8_t* buffer) {
+            fills++;
+            auto available = std::max<int64_t>(0, static_cast<int64_t>(contents.size()) - offset);
+            auto count = std::min(length, available);
+            memcpy(buffer, contents.data() + offset, static_cast<size_t>(count));
+            return count;
+         }
+      };
+
+      int64_t Read(vfm_block_cache& cache, uint64_t file_key, backing_file& file, int64_t offset, int64_t length, std::vector<uint8_t>& buffer) {
+         buffer.assign(static_cast<size_t>(length), 0xCC);
+         return cache.read(file_key, offset, length, buffer.data(), [&](int64_t fill_offset, int64_t fill_length, uint8_t* fill_buffer) {
+            return file.fill(fill_offset, fill_length, fill_buffer);
+         });
+      }
+
+   public:
+      TEST_METHOD(EvictsLeastRecentlyUsedUnderBudgetTest) {
+         // One shard, so the whole budget is one LRU list.
+         vfm_block_cache cache(4 * kBlockSize, kBlockSize, 1);
+         backing_file file(8 * kBlockSize, 1);
+         auto key = cache.get_file_key("pack", 1);
+         std::vector<uint8_t> buffer;
+         for (int64_t block = 0; block < 4; block++) {
+            Read(cache, key, file, block * kBlockSize, 10, buffer);
+         }
+         Assert::AreEqual(4, file.fills);
+         Assert::AreEqual(4 * kBlockSize, cache.stats().bytes_cached);
+
+         // Touching block 0 leaves block 1 least recently used; block 4 pushes it out.
+         Read(cache, key, file, 0, 10, buffer);
+         Read(cache, key, file, 4 * kBlockSize, 10, buffer);
+         auto stats = cache.stats();
+         Assert::AreEqual(5, file.fills);
+         Assert::AreEqual(1ULL, stats.evictions);
+         Assert::AreEqual(4 * kBlockSize, stats.bytes_cached);
+         Read(cache, key, file, 0, 10, buffer);
+         Assert::AreEqual(5, file.fills);
+         Read(cache, key, file, kBlockSize, 10, buffer);
+         Assert::AreEqual(6, file.fills);
+         Assert::AreEqual(0, memcmp(buffer.data(), file.contents.data() + kBlockSize, 10));
+      }
+
+      TEST_METHOD(LargeReadsBypassCacheTest) {
+         vfm_block_cache cache(64 * kBlockSize, kBlockSize, 4);
+         backing_file file(32 * kBlockSize, 1);
+         auto key = cache.get_file_key("pack", 1);
+         std::vector<uint8_t> buffer;
+
+         // At the threshold, one fill straight into the caller's buffer and nothing cached.
+         Assert::AreEqual(16 * kBlockSize, Read(cache, key, file, 100, 16 * kBlockSize, buffer));
+         Assert::AreEqual(1, file.fills);
+         Assert::AreEqual(1ULL, cache.stats().bypasses);
+         Assert::AreEqual(0LL, cache.stats().bytes_cached);
+         Assert::AreEqual(0, memcmp(buffer.data(), file.contents.data() + 100, buffer.size()));
+
+         // Just under it, the read goes through blocks.
+         Assert::AreEqual(16 * kBlockSize - 1, Read(cache, key, file, 0, 16 * kBlockSize - 1, buffer));
+         Assert::AreEqual(17, file.fills);
+         Assert::AreEqual(1ULL, cache.stats().bypasses);
+         Assert::AreEqual(16 * kBlockSize, cache.stats().bytes_cached);
+         Assert::AreEqual(0, memcmp(buffer.data(), file.contents.data(), buffer.size()));
+      }
+
+      TEST_METHOD(ConcurrentFillOfSameBlockTest) {
+         vfm_block_cache cache(64 * kBlockSize, kBlockSize, 4);
+         backing_file file(4 * kBlockSize, 1);
+         auto key = cache.get_file_key("pack", 1);
+         std::atomic<int> fills(0);
+         std::atomic<int> mismatches(0);
+         std::vector<std::thread> readers;
+         for (int t = 0; t < 8; t++) {
+            readers.emplace_back([&, t] {
+               std::vector<uint8_t> buffer(100);
+               auto offset = kBlockSize + t * 100;
+               cache.read(key, offset, 100, buffer.data(), [&](int64_t fill_offset, int64_t fill_length, uint8_t* fill_buffer) -> int64_t {
+                  fills++;
+                  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                  memcpy(fill_buffer, file.contents.data() + fill_offset, static_cast<size_t>(fill_length));
+                  return fill_length;
+               });
+               if (memcmp(buffer.data(), file.contents.data() + offset, buffer.size()) != 0) {
+                  mismatches++;
+               }
+            });
+         }
+         for (auto& reader : readers) {
+            reader.join();
+         }
+
+         // Racing fills may each read the block, but only one copy is kept and later reads hit it.
+         Assert::AreEqual(0, mismatches.load());
+         Assert::IsTrue(fills >= 1);
+         Assert::AreEqual(kBlockSize, cache.stats().bytes_cached);
+         std::vector<uint8_t> buffer;
+         Read(cache, key, file, kBlockSize + 500, 100, buffer);
+         Assert::AreEqual(0, file.fills);
+         Assert::AreEqual(0, memcmp(buffer.data(), file.contents.data() + kBlockSize + 500, 100));
+      }
+
+      TEST_METHOD(InvalidateDropsStaleBlocksTest) {
+         vfm_block_cache cache(64 * kBlockSize, kBlockSize, 4);
+         backing_file file(8 * kBlockSize, 1);
+         auto key = cache.get_file_key("pack", 1);
+         auto view_key = cache.get_file_key("pack", 1, "lz4@0");
+         Assert::IsTrue(key != view_key);
+         Assert::AreEqual(key, cache.get_file_key("pack", 1));
+         Assert::IsTrue(key != cache.get_file_key("pack", 2));
+
+         std::vector<uint8_t> buffer;
+         Read(cache, key, file, 100, 50, buffer);
+         Read(cache, view_key, file, 100, 50, buffer);
+         Assert::AreEqual(2, file.fills);
+
+         // The file changes on disk; cached blocks still serve the old bytes until invalidated.
+         file = backing_file(8 * kBlockSize, 2);
+         Read(cache, key, file, 100, 50, buffer);
+         Assert::AreEqual(0, file.fills);
+         Assert::AreNotEqual(0, memcmp(buffer.data(), file.contents.data() + 100, 50));
+
+         cache.invalidate("pack");
+         Assert::AreEqual(0LL, cache.stats().bytes_cached);
+         auto fresh_key = cache.get_file_key("pack", 1);
+         Assert::IsTrue(fresh_key != key && fresh_key != view_key);
+         Assert::AreEqual(50LL, Read(cache, fresh_key, file, 100, 50, buffer));
+         Assert::AreEqual(1, file.fills);
+         Assert::AreEqual(0, memcmp(buffer.data(), file.contents.data() + 100, 50));
+      }
+   };
+}
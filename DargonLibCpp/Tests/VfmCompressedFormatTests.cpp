@@ -0,0 +1,79 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <cstring>
+#include <vector>
+#include <lz4_block.hpp>
+#include <vfm/vfm_compressed_format.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmCompressedFormatTests) {
+      static std::vector<uint8_t> MakeData(size_t length) {
+         // Repetitive with some noise, roughly like game assets.
+         std::vector<uint8_t> data(length);
+         uint32_t state = 12345;
+         for (size_t i = 0; i < length; i++) {
+            state = state * 1103515245 + 12345;
+            data[i] = (state >> 24) % 8 == 0 ? static_cast<uint8_t>(state >> 16) : static_cast<uint8_t>(i % 61);
+         }
+         return data;
+      }
+
+   public:
+      TEST_METHOD(Lz4RoundTripTest) {
+         auto data = MakeData(200000);
+         std::vector<uint8_t> compressed;
+         lz4_compress_block(data.data(), data.size(), compressed);
+         Assert::IsTrue(compressed.size() < data.size());
+
+         std::vector<uint8_t> decompressed(data.size());
+         Assert::AreEqual((int64_t)data.size(), lz4_decompress_block(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+         Assert::IsTrue(memcmp(data.data(), decompressed.data(), data.size()) == 0);
+      }
+
+      TEST_METHOD(Lz4RejectsOverflowTest) {
+         auto data = MakeData(4096);
+         std::vector<uint8_t> compressed;
+         lz4_compress_block(data.data(), data.size(), compressed);
+
+         std::vector<uint8_t> decompressed(data.size() - 1);
+         Assert::AreEqual(-1LL, lz4_decompress_block(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+      }
+
+      TEST_METHOD(EncodeFramesTest) {
+         auto data = MakeData(10000);
+         auto object = vfm_compressed_encode(data.data(), data.size(), 4096);
+
+         vfm_compressed_header header;
+         memcpy(&header, object.data(), sizeof(header));
+         Assert::AreEqual(vfm_compressed_magic, header.magic);
+         Assert::AreEqual(3U, header.frame_count);
+         Assert::AreEqual(10000LL, header.uncompressed_length);
+         Assert::AreEqual(1808LL, vfm_compressed_frame_length(header, 2));
+
+         auto offsets = reinterpret_cast<const uint64_t*>(object.data() + sizeof(header));
+         Assert::AreEqual((uint64_t)object.size(), offsets[3]);
+         for (uint32_t i = 0; i < header.frame_count; i++) {
+            auto frame_length = static_cast<size_t>(vfm_compressed_frame_length(header, i));
+            std::vector<uint8_t> frame(frame_length);
+            Assert::IsTrue(vfm_compressed_decode_frame(object.data() + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]), frame.data(), frame_length));
+            Assert::IsTrue(memcmp(data.data() + i * 4096, frame.data(), frame_length) == 0);
+         }
+      }
+
+      TEST_METHOD(IncompressibleFramesStoredRawTest) {
+         std::vector<uint8_t> data(1000);
+         uint32_t state = 1;
+         for (auto& b : data) {
+            state = state * 1103515245 + 12345;
+            b = static_cast<uint8_t>(state >> 16);
+         }
+         auto object = vfm_compressed_encode(data.data(), data.size(), 4096);
+
+         auto offsets = reinterpret_cast<const uint64_t*>(object.data() + sizeof(vfm_compressed_header));
+         Assert::AreEqual((uint64_t)data.size(), offsets[1] - offsets[0]);
+         Assert::IsTrue(memcmp(data.data(), object.data() + offsets[0], data.size()) == 0);
+      }
+   };
+}
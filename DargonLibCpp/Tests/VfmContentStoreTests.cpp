@@ -0,0 +1,130 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vfm/vfm_content_store.hpp>
+#include <vfm/vfm_zero_sector.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmContentStoreTests) {
+      // Backing files by path.
+      std::map<std::string, std::vector<uint8_t>> files;
+      int created = 0;
+
+      std::shared_ptr<vfm_content_store> CreateStore(int64_t max_hashed_length = vfm_content_store::kDefaultMaxHashedLength, std::shared_ptr<thread_pool> hash_pool = nullptr) {
+         return std::make_shared<vfm_content_store>([this](const std::string& path, int64_t offset, int64_t length, uint8_t* buffer) -> int64_t {
+            auto& contents = files[path];
+            auto count = std::min(length, std::max<int64_t>(0, static_cast<int64_t>(contents.size()) - offset));
+            memcpy(buffer, contents.data() + offset, static_cast<size_t>(count));
+            return count;
+         }, max_hashed_length, hash_pool);
+      }
+
+      std::shared_ptr<vfm_sector> Intern(vfm_content_store& store, const std::string& path, int64_t offset, int64_t length) {
+         return store.intern(path, offset, length, [this, length] {
+            created++;
+            return std::make_shared<vfm_zero_sector>(length);
+         });
+      }
+
+      void WriteFile(const std::string& path, uint8_t seed) {
+         auto& contents = files[path];
+         contents.resize(4096);
+         for (size_t i = 0; i < contents.size(); i++) {
+            contents[i] = static_cast<uint8_t>(i * 7 + seed);
+         }
+      }
+
+   public:
+      TEST_METHOD(SharesContentOnLaterInternTest) {
+         WriteFile("a", 1);
+         WriteFile("b", 1);
+         WriteFile("c", 2);
+         auto store = CreateStore();
+         auto a = Intern(*store, "a", 0, 1000);
+         Assert::AreEqual(0ULL, store->stats().regions_hashed);
+
+         // b's first intern gets a sector of its own; hashing finds its bytes match a's, so
+         // later interns of b get a's.
+         auto b = Intern(*store, "b", 0, 1000);
+         Assert::IsTrue(a != b);
+         Assert::IsTrue(Intern(*store, "b", 0, 1000) == a);
+         Assert::IsTrue(Intern(*store, "a", 0, 1000) == a);
+         auto c = Intern(*store, "c", 0, 1000);
+         Assert::IsTrue(Intern(*store, "c", 0, 1000) == c);
+         Assert::AreEqual(3, created);
+         Assert::AreEqual(1ULL, store->stats().contents_shared);
+
+         // Regions longer than the limit are never hashed.
+         auto small_store = CreateStore(100);
+         Intern(*small_store, "a", 0, 1000);
+         Intern(*small_store, "b", 0, 1000);
+         Assert::AreEqual(0ULL, small_store->stats().regions_hashed);
+      }
+
+      TEST_METHOD(HashesOnPoolTest) {
+         WriteFile("a", 1);
+         WriteFile("b", 1);
+         auto pool = std::make_shared<thread_pool>(2);
+         auto store = CreateStore(vfm_content_store::kDefaultMaxHashedLength, pool);
+         auto a = Intern(*store, "a", 0, 1000);
+         auto b = Intern(*store, "b", 0, 1000);
+         Assert::IsTrue(a != b);
+         // The hashing task holds the store until it's done.
+         for (int i = 0; i < 2000 && store.use_count() > 1; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+         Assert::AreEqual(2ULL, store->stats().regions_hashed);
+         Assert::IsTrue(Intern(*store, "b", 0, 1000) == a);
+      }
+
+      TEST_METHOD(PrunesExpiredRegionsTest) {
+         WriteFile("a", 1);
+         WriteFile("b", 1);
+         WriteFile("c", 1);
+         auto store = CreateStore();
+         {
+            auto a = Intern(*store, "a", 0, 1000);
+            auto b = Intern(*store, "b", 0, 1000);
+            Assert::AreEqual(2ULL, store->stats().regions_hashed);
+         }
+
+         // a and b's sectors have expired, so c is alone in its length and isn't hashed.
+         auto c = Intern(*store, "c", 0, 1000);
+         Assert::AreEqual(2ULL, store->stats().regions_hashed);
+
+         // a's expired digest doesn't shadow c's sector.
+         Intern(*store, "a", 0, 1000);
+         Assert::IsTrue(Intern(*store, "a", 0, 1000) == c);
+         Assert::AreEqual(4, created);
+      }
+
+      TEST_METHOD(InvalidateForgetsPathAndSharersTest) {
+         WriteFile("a", 1);
+         WriteFile("b", 1);
+         auto store = CreateStore();
+         auto a = Intern(*store, "a", 0, 1000);
+         Intern(*store, "b", 0, 1000);
+         Assert::IsTrue(Intern(*store, "b", 0, 1000) == a);
+         Assert::AreEqual(2, created);
+
+         // a's bytes change; b no longer holds what a's sector reads, so neither region may
+         // hand out the old sector.
+         WriteFile("a", 2);
+         store->invalidate("a");
+         auto fresh_a = Intern(*store, "a", 0, 1000);
+         auto fresh_b = Intern(*store, "b", 0, 1000);
+         Assert::IsTrue(fresh_a != a);
+         Assert::IsTrue(fresh_b != a);
+         Assert::IsTrue(Intern(*store, "b", 0, 1000) == fresh_b);
+         Assert::AreEqual(4, created);
+      }
+   };
+}
@@ -0,0 +1,121 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vfm/vfm_format_v2.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmFormatV2Tests) {
+      static vfm_v2_builder::sector_description MakeSector(int64_t start, int64_t end, const char* path, int64_t source_offset) {
+         vfm_v2_builder::sector_description sector = {};
+         memset(sector.type, 0xAB, sizeof(sector.type));
+         sector.start_inclusive = start;
+         sector.end_exclusive = end;
+         sector.path = path;
+         sector.source_offset = source_offset;
+         return sector;
+      }
+
+   public:
+      TEST_METHOD(RoundTripTest) {
+         vfm_v2_builder builder;
+         builder.add_sector(MakeSector(100, 250, "b.dat", 7));
+         builder.add_sector(MakeSector(0, 100, "a.dat", 0));
+         builder.add_sector(MakeSector(250, 300, "a.dat", 100));
+         auto image = builder.build();
+
+         vfm_v2_view view(image.data(), image.size());
+         Assert::AreEqual(3U, view.sector_count());
+         Assert::AreEqual(300LL, view.extent());
+         Assert::AreEqual(0LL, view.sector(0).start_inclusive);
+         Assert::AreEqual(7LL, view.sector(1).source_offset);
+         Assert::AreEqual(view.sector(0).path_index, view.sector(2).path_index);
+         Assert::AreEqual(std::string("b.dat"), view.path(view.sector(1).path_index));
+         Assert::AreEqual((uint8_t)0xAB, view.sector(2).type[15]);
+      }
+
+      TEST_METHOD(FindFirstMatchesWithAndWithoutLookupIndexTest) {
+         vfm_v2_builder builder;
+         int64_t position = 0;
+         for (int i = 0; i < 500; i++) {
+            auto length = 1 + (i * 7919) % 20000;
+            builder.add_sector(MakeSector(position, position + length, "x", 0));
+            position += length + (i % 3 == 0 ? 1000 : 0);
+         }
+         auto indexed = builder.build(true);
+         auto unindexed = builder.build(false);
+         vfm_v2_view indexed_view(indexed.data(), indexed.size());
+         vfm_v2_view unindexed_view(unindexed.data(), unindexed.size());
+
+         for (int64_t offset = 0; offset < position + 5000; offset += 997) {
+            Assert::AreEqual(unindexed_view.find_first(offset), indexed_view.find_first(offset));
+         }
+         Assert::AreEqual(indexed_view.sector_count(), indexed_view.find_first(position + 1));
+      }
+
+      TEST_METHOD(OverlappingSectorsRejectedTest) {
+         vfm_v2_builder builder;
+         builder.add_sector(MakeSector(0, 150, "a", 0));
+         builder.add_sector(MakeSector(100, 200, "b", 0));
+         Assert::ExpectException<std::runtime_error>([&]() { builder.build(); });
+      }
+
+      TEST_METHOD(TruncatedImageRejectedTest) {
+         vfm_v2_builder builder;
+         builder.add_sector(MakeSector(0, 100, "a", 0));
+         auto image = builder.build();
+         image.resize(image.size() - 4);
+         Assert::ExpectException<std::runtime_error>([&]() { vfm_v2_view view(image.data(), image.size()); });
+      }
+
+      TEST_METHOD(CorruptLookupIndexRejectedTest) {
+         vfm_v2_builder builder;
+         for (int i = 0; i < 10; i++) {
+            builder.add_sector(MakeSector(i * 5000, (i + 1) * 5000, "a", 0));
+         }
+         auto image = builder.build();
+         auto header = reinterpret_cast<vfm_v2_header*>(image.data());
+         auto fences = reinterpret_cast<uint32_t*>(image.data() + header->fence_table_offset);
+         Assert::IsTrue(header->fence_count > 2 && fences[1] < fences[2]);
+         auto expect_rejected = [&]() {
+            Assert::ExpectException<std::runtime_error>([&]() { vfm_v2_view view(image.data(), image.size()); });
+         };
+
+         auto original = *header;
+         header->fence_shift = 64;
+         expect_rejected();
+         *header = original;
+         header->fence_count--;
+         expect_rejected();
+         *header = original;
+         std::swap(fences[1], fences[2]);
+         expect_rejected();
+         std::swap(fences[1], fences[2]);
+         fences[header->fence_count - 1] = 0xFFFFFFFFU;
+         expect_rejected();
+      }
+
+      TEST_METHOD(OutOfRangePathAndPayloadRejectedTest) {
+         vfm_v2_builder builder;
+         builder.add_sector(MakeSector(0, 100, "a.dat", 0));
+         uint8_t bytes[8] = {};
+         builder.add_payload(bytes, sizeof(bytes));
+         auto image = builder.build();
+         auto header = reinterpret_cast<vfm_v2_header*>(image.data());
+         auto path_entry = reinterpret_cast<vfm_v2_path_entry*>(image.data() + header->path_table_offset);
+         vfm_v2_view view(image.data(), image.size());
+
+         Assert::IsTrue(view.payload(0, 8) != nullptr);
+         Assert::IsTrue(view.payload(4, 5) == nullptr);
+         Assert::IsTrue(view.payload(INT64_MAX, 2) == nullptr);
+         Assert::IsTrue(view.payload(1, INT64_MAX) == nullptr);
+
+         // offset + length would wrap back into the string data.
+         path_entry->offset = UINT64_MAX - 1;
+         Assert::ExpectException<std::runtime_error>([&]() { view.path(0); });
+      }
+   };
+}
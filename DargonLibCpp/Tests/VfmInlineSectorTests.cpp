@@ -0,0 +1,77 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <binary_reader.hpp>
+#include <vfm/vfm_inline_sector.hpp>
+#include <vfm/vfm_sector_factory.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmInlineSectorTests) {
+      // An int64 length followed by the bytes, as vfm_inline_sector is serialized.
+      static std::vector<uint8_t> Serialize(int64_t length, const std::vector<uint8_t>& bytes) {
+         std::vector<uint8_t> serialized(sizeof(length));
+         memcpy(serialized.data(), &length, sizeof(length));
+         serialized.insert(serialized.end(), bytes.begin(), bytes.end());
+         return serialized;
+      }
+
+   public:
+      TEST_METHOD(ReadAndBorrowTest) {
+         vfm_inline_sector sector(std::vector<uint8_t>{ 1, 2, 3, 4, 5 });
+         Assert::AreEqual(5LL, sector.size());
+
+         uint8_t buffer[6] = { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC };
+         sector.read(1, 3, buffer, 1);
+         Assert::AreEqual(0, memcmp("\xCC\x02\x03\x04\xCC", buffer, 5));
+
+         // Reads past the end come back zeroed.
+         sector.read(3, 4, buffer, 0);
+         Assert::AreEqual(0, memcmp("\x04\x05\0\0", buffer, 4));
+
+         Assert::AreEqual((uint8_t)3, *sector.borrow(2, 3));
+         Assert::IsTrue(sector.borrow(2, 4) == nullptr);
+         Assert::IsTrue(sector.borrow(-1, 1) == nullptr);
+      }
+
+      TEST_METHOD(DeserializeThroughFactoryTest) {
+         vfm_sector_factory factory(nullptr);
+         auto sector = factory.create(vfm_inline_sector::kGuid);
+         auto serialized = Serialize(4, { 9, 8, 7, 6 });
+         binary_reader reader(serialized.data(), serialized.size());
+         sector->deserialize(reader);
+
+         Assert::AreEqual(4LL, sector->size());
+         uint8_t buffer[4];
+         sector->read(0, 4, buffer, 0);
+         Assert::AreEqual(0, memcmp("\x09\x08\x07\x06", buffer, 4));
+         Assert::AreEqual(std::string("[vfm_inline_sector len = 4 ]"), sector->to_string());
+      }
+
+      TEST_METHOD(DeserializeRejectsBadLengthTest) {
+         vfm_inline_sector sector;
+         auto serialized = Serialize(-1, {});
+         binary_reader reader(serialized.data(), serialized.size());
+         Assert::ExpectException<std::runtime_error>([&] { sector.deserialize(reader); });
+      }
+
+      TEST_METHOD(BorrowedBytesKeepOwnerAliveTest) {
+         auto owner = std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>{ 10, 20, 30, 40 });
+         std::weak_ptr<std::vector<uint8_t>> watcher = owner;
+         auto sector = std::make_shared<vfm_inline_sector>(owner, owner->data() + 1, 2);
+         owner.reset();
+         Assert::IsFalse(watcher.expired());
+
+         uint8_t buffer[2];
+         sector->read(0, 2, buffer, 0);
+         Assert::AreEqual((uint8_t)20, buffer[0]);
+         Assert::AreEqual((uint8_t)30, buffer[1]);
+         sector.reset();
+         Assert::IsTrue(watcher.expired());
+      }
+   };
+}
@@ -0,0 +1,61 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <vfm/vfm_optimizer.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmOptimizerTests) {
+   public:
+      TEST_METHOD(MergesContiguousFragmentsTest) {
+         std::vector<vfm_sector_layout> layout;
+         layout.emplace_back(vfm_sector_range(100, 150), "a.dat", 1100);
+         layout.emplace_back(vfm_sector_range(0, 100), "a.dat", 1000);
+         layout.emplace_back(vfm_sector_range(150, 400), "a.dat", 1150);
+         auto stats = vfm_optimizer::optimize(layout);
+
+         Assert::AreEqual((size_t)3, stats.sectors_before);
+         Assert::AreEqual((size_t)1, stats.sectors_after);
+         Assert::AreEqual((size_t)2, stats.merged);
+         Assert::AreEqual(0LL, layout[0].range.start_inclusive);
+         Assert::AreEqual(400LL, layout[0].range.end_exclusive);
+         Assert::AreEqual(1000LL, layout[0].backing_offset);
+      }
+
+      TEST_METHOD(KeepsDiscontiguousFragmentsTest) {
+         std::vector<vfm_sector_layout> layout;
+         layout.emplace_back(vfm_sector_range(0, 100), "a.dat", 0);
+         layout.emplace_back(vfm_sector_range(100, 200), "b.dat", 100);    // other file
+         layout.emplace_back(vfm_sector_range(200, 300), "b.dat", 500);    // gap in backing file
+         layout.emplace_back(vfm_sector_range(310, 400), "b.dat", 610);    // gap in virtual file
+         auto stats = vfm_optimizer::optimize(layout);
+
+         Assert::AreEqual((size_t)4, stats.sectors_after);
+         Assert::AreEqual((size_t)0, stats.merged);
+      }
+
+      TEST_METHOD(DropsEmptySectorsTest) {
+         std::vector<vfm_sector_layout> layout;
+         layout.emplace_back(vfm_sector_range(0, 100), "a.dat", 0);
+         layout.emplace_back(vfm_sector_range(100, 100), "z.dat", 0);
+         layout.emplace_back(vfm_sector_range(100, 200), "a.dat", 100);
+         auto stats = vfm_optimizer::optimize(layout);
+
+         Assert::AreEqual((size_t)1, stats.empty_dropped);
+         Assert::AreEqual((size_t)1, stats.sectors_after);
+         Assert::AreEqual(200LL, layout[0].range.end_exclusive);
+      }
+
+      TEST_METHOD(LeavesOtherSectorTypesAloneTest) {
+         auto other = std::shared_ptr<vfm_sector>(reinterpret_cast<vfm_sector*>(0x10), [](vfm_sector*) { });
+         std::vector<vfm_sector_layout> layout;
+         layout.emplace_back(vfm_sector_range(0, 100), "a.dat", 0);
+         layout.emplace_back(vfm_sector_range(100, 200), other);
+         layout.emplace_back(vfm_sector_range(200, 300), "a.dat", 200);
+         auto stats = vfm_optimizer::optimize(layout);
+
+         Assert::AreEqual((size_t)3, stats.sectors_after);
+         Assert::IsTrue(layout[1].sector == other);
+      }
+   };
+}
@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <vfm/vfm_overlay.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmOverlayTests) {
+      vfm_sector* const kSectorA = reinterpret_cast<vfm_sector*>(0x10);
+      vfm_sector* const kSectorB = reinterpret_cast<vfm_sector*>(0x20);
+      vfm_sector* const kSectorC = reinterpret_cast<vfm_sector*>(0x30);
+
+      void AssertEntry(const vfm_sector_index_entry& entry, int64_t start, int64_t end, vfm_sector* sector, int64_t sector_offset) {
+         Assert::AreEqual(start, entry.range.start_inclusive);
+         Assert::AreEqual(end, entry.range.end_exclusive);
+         Assert::IsTrue(entry.sector == sector);
+         Assert::AreEqual(sector_offset, entry.sector_offset);
+      }
+
+   public:
+      TEST_METHOD(SingleLayerTest) {
+         std::vector<vfm_sector_index::entry_collection> layers(1);
+         layers[0].emplace_back(vfm_sector_range(100, 200), kSectorB);
+         layers[0].emplace_back(vfm_sector_range(0, 100), kSectorA);
+
+         auto merged = vfm_overlay_merge(layers);
+         Assert::AreEqual((size_t)2, merged.size());
+         AssertEntry(merged[0], 0, 100, kSectorA, 0);
+         AssertEntry(merged[1], 100, 200, kSectorB, 0);
+      }
+
+      TEST_METHOD(SplitsOverriddenEntryTest) {
+         std::vector<vfm_sector_index::entry_collection> layers(2);
+         layers[0].emplace_back(vfm_sector_range(0, 300), kSectorA);
+         layers[1].emplace_back(vfm_sector_range(100, 150), kSectorB);
+
+         auto merged = vfm_overlay_merge(layers);
+         Assert::AreEqual((size_t)3, merged.size());
+         AssertEntry(merged[0], 0, 100, kSectorA, 0);
+         AssertEntry(merged[1], 100, 150, kSectorB, 0);
+         AssertEntry(merged[2], 150, 300, kSectorA, 150);
+      }
+
+      TEST_METHOD(LaterLayerWinsTest) {
+         std::vector<vfm_sector_index::entry_collection> layers(3);
+         layers[0].emplace_back(vfm_sector_range(0, 100), kSectorA);
+         layers[1].emplace_back(vfm_sector_range(50, 150), kSectorB);
+         layers[2].emplace_back(vfm_sector_range(80, 120), kSectorC);
+
+         auto merged = vfm_overlay_merge(layers);
+         Assert::AreEqual((size_t)4, merged.size());
+         AssertEntry(merged[0], 0, 50, kSectorA, 0);
+         AssertEntry(merged[1], 50, 80, kSectorB, 0);
+         AssertEntry(merged[2], 80, 120, kSectorC, 0);
+         AssertEntry(merged[3], 120, 150, kSectorB, 70);
+      }
+
+      TEST_METHOD(ClipKeepsSectorOffsetTest) {
+         std::vector<vfm_sector_index::entry_collection> layers(2);
+         layers[0].emplace_back(vfm_sector_range(1000, 2000), kSectorA, 500);
+         layers[1].emplace_back(vfm_sector_range(900, 1200), kSectorB);
+         layers[1].emplace_back(vfm_sector_range(1500, 1600), kSectorC);
+
+         auto merged = vfm_overlay_merge(layers);
+         Assert::AreEqual((size_t)4, merged.size());
+         AssertEntry(merged[0], 900, 1200, kSectorB, 0);
+         AssertEntry(merged[1], 1200, 1500, kSectorA, 700);
+         AssertEntry(merged[2], 1500, 1600, kSectorC, 0);
+         AssertEntry(merged[3], 1600, 2000, kSectorA, 1100);
+      }
+
+      TEST_METHOD(DropsEmptyEntriesTest) {
+         std::vector<vfm_sector_index::entry_collection> layers(2);
+         layers[0].emplace_back(vfm_sector_range(0, 100), kSectorA);
+         layers[1].emplace_back(vfm_sector_range(50, 50), kSectorB);
+
+         auto merged = vfm_overlay_merge(layers);
+         Assert::AreEqual((size_t)1, merged.size());
+         AssertEntry(merged[0], 0, 100, kSectorA, 0);
+      }
+   };
+}
@@ -0,0 +1,150 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <thread_pool.hpp>
+#include <vfm/vfm_file.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmParallelReadTests) {
+      static const int64_t kSectorLength = 1000;
+
+      // Serves byte (sector_id * 64 + offset) & 0xFF, optionally after a delay or by throwing.
+      class test_sector : public vfm_sector {
+         int sector_id;
+
+      public:
+         bool throws = false;
+         int delay_ms = 0;
+         std::atomic<int> reads;
+         std::atomic<bool> finished;
+
+         test_sector(int sector_id) : sector_id(sector_id), reads(0), finished(false) { }
+
+         int64_t size() override { return kSectorLength; }
+         void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override {
+            reads++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+            if (throws) {
+               finished = true;
+               throw std::runtime_error("sector read failed");
+            }
+            for (int64_t i = 0; i < read_length; i++) {
+               buffer[buffer_offset + i] = static_cast<uint8_t>(sector_id * 64 + read_offset + i);
+            }
+            finished = true;
+         }
+         void deserialize(dargon::binary_reader& reader) override { }
+         std::string to_string() override { return "test_sector"; }
+      };
+
+      std::vector<std::shared_ptr<test_sector>> sectors;
+      std::shared_ptr<vfm_file> file;
+
+      void CreateFile(std::shared_ptr<thread_pool> pool, int sector_count) {
+         file = std::make_shared<vfm_file>();
+         for (int i = 0; i < sector_count; i++) {
+            sectors.push_back(std::make_shared<test_sector>(i));
+            file->assign_sector(vfm_sector_range(i * kSectorLength, (i + 1) * kSectorLength), sectors.back());
+         }
+         file->build_index();
+         file->set_parallel_reads(pool, 1);
+      }
+
+   public:
+      TEST_METHOD(ParallelReadMatchesSerialTest) {
+         // Sectors [0, 1000), [1000, 2000), gap, [2500, 3500), [3500, 4500).
+         auto pool = std::make_shared<thread_pool>(3);
+         file = std::make_shared<vfm_file>();
+         int64_t starts[] = { 0, 1000, 2500, 3500 };
+         for (int i = 0; i < 4; i++) {
+            sectors.push_back(std::make_shared<test_sector>(i));
+            sectors.back()->delay_ms = 5 * (4 - i);
+            file->assign_sector(vfm_sector_range(starts[i], starts[i] + kSectorLength), sectors.back());
+         }
+         file->build_index();
+
+         std::vector<std::pair<int64_t, int64_t>> reads = { { 0, 4500 }, { 999, 2 }, { 500, 3700 }, { 1900, 700 }, { 1500, 5000 } };
+         for (auto& read : reads) {
+            std::vector<uint8_t> serial(static_cast<size_t>(read.second), 0xCC);
+            std::vector<uint8_t> parallel(static_cast<size_t>(read.second), 0xCC);
+            file->set_parallel_reads(nullptr);
+            auto serial_read = file->read(read.first, read.second, serial.data(), 0);
+            file->set_parallel_reads(pool, 1);
+            auto parallel_read = file->read(read.first, read.second, parallel.data(), 0);
+            Assert::AreEqual(serial_read, parallel_read);
+            Assert::IsTrue(serial == parallel);
+         }
+
+         // Gap bytes are zeroed, sector bytes come from their sectors.
+         std::vector<uint8_t> buffer(static_cast<size_t>(4500), 0xCC);
+         Assert::AreEqual(4500LL, file->read(0, 4500, buffer.data(), 0));
+         Assert::AreEqual(static_cast<uint8_t>(1 * 64 + 999), buffer[1999]);
+         Assert::AreEqual((uint8_t)0, buffer[2000]);
+         Assert::AreEqual((uint8_t)0, buffer[2499]);
+         Assert::AreEqual(static_cast<uint8_t>(2 * 64), buffer[2500]);
+         Assert::AreEqual(static_cast<uint8_t>(3 * 64 + 999), buffer[4499]);
+      }
+
+      TEST_METHOD(PoolExceptionRethrownAfterAllReadsTest) {
+         auto pool = std::make_shared<thread_pool>(2);
+         CreateFile(pool, 4);
+         sectors[1]->throws = true;
+         sectors[3]->delay_ms = 50;
+
+         std::vector<uint8_t> buffer(static_cast<size_t>(4 * kSectorLength));
+         Assert::ExpectException<std::runtime_error>([&] { file->read(0, 4 * kSectorLength, buffer.data(), 0); });
+         for (auto& sector : sectors) {
+            Assert::IsTrue(sector->finished);
+         }
+      }
+
+      TEST_METHOD(InlineExceptionWaitsForPoolTest) {
+         // The first sector is read on the calling thread; its exception must not unwind the
+         // read while pool tasks still write into the caller's frame and buffer.
+         auto pool = std::make_shared<thread_pool>(2);
+         CreateFile(pool, 3);
+         sectors[0]->throws = true;
+         sectors[1]->delay_ms = 50;
+         sectors[2]->delay_ms = 50;
+
+         std::vector<uint8_t> buffer(static_cast<size_t>(3 * kSectorLength));
+         Assert::ExpectException<std::runtime_error>([&] { file->read(0, 3 * kSectorLength, buffer.data(), 0); });
+         Assert::IsTrue(sectors[1]->finished);
+         Assert::IsTrue(sectors[2]->finished);
+
+         // The file stays usable afterwards.
+         sectors[0]->throws = false;
+         Assert::AreEqual(3 * kSectorLength, file->read(0, 3 * kSectorLength, buffer.data(), 0));
+         Assert::AreEqual(static_cast<uint8_t>(2 * 64 + 5), buffer[static_cast<size_t>(2 * kSectorLength + 5)]);
+      }
+
+      TEST_METHOD(AsyncReadFailureReachesCallerTest) {
+         thread_pool pool(2);
+         CreateFile(nullptr, 2);
+         sectors[1]->throws = true;
+
+         std::vector<uint8_t> buffer(static_cast<size_t>(2 * kSectorLength));
+         auto failed = file->read_async(pool, 0, 2 * kSectorLength, buffer.data());
+         Assert::ExpectException<std::runtime_error>([&] { failed.get(); });
+
+         std::promise<std::pair<int64_t, bool>> completion;
+         file->read_async(pool, 500, 1000, buffer.data(), [&](int64_t bytes_read, std::exception_ptr error) {
+            completion.set_value(std::make_pair(bytes_read, error != nullptr));
+         });
+         auto outcome = completion.get_future().get();
+         Assert::AreEqual(0LL, outcome.first);
+         Assert::IsTrue(outcome.second);
+
+         sectors[1]->throws = false;
+         Assert::AreEqual(2 * kSectorLength, file->read_async(pool, 0, 2 * kSectorLength, buffer.data()).get());
+      }
+   };
+}
@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <thread_pool.hpp>
+#include <vfm/vfm_read_ahead.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmReadAheadTests) {
+      static constexpr int64_t kFileLength = 1024 * 1024;
+      static constexpr int64_t kMinWindow = 4096;
+      static constexpr int64_t kMaxWindow = 64 * 1024;
+
+      // Serves byte (offset * 7) & 0xFF, optionally after a delay.
+      class pattern_sector : public vfm_sector {
+      public:
+         std::atomic<int> delay_ms;
+         std::atomic<int> reads;
+
+         pattern_sector() : delay_ms(0), reads(0) { }
+
+         int64_t size() override { return kFileLength; }
+         void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override {
+            reads++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms.load()));
+            for (int64_t i = 0; i < read_length; i++) {
+               buffer[buffer_offset + i] = static_cast<uint8_t>((read_offset + i) * 7);
+            }
+         }
+         void deserialize(dargon::binary_reader& reader) override { }
+         std::string to_string() override { return "pattern_sector"; }
+      };
+
+      std::shared_ptr<thread_pool> pool;
+      std::shared_ptr<pattern_sector> sector;
+      std::shared_ptr<vfm_read_ahead> read_ahead;
+
+      void CreateReadAhead() {
+         pool = std::make_shared<thread_pool>(2);
+         sector = std::make_shared<pattern_sector>();
+         auto file = std::make_shared<vfm_file>();
+         file->assign_sector(vfm_sector_range(0, kFileLength), sector);
+         file->build_index();
+         read_ahead = std::make_shared<vfm_read_ahead>(file, pool, kMinWindow, kMaxWindow);
+      }
+
+      ~VfmReadAheadTests() {
+         // Prefetches in flight hold the read-ahead, which holds the pool; let them finish so the
+         // pool isn't released on one of its own workers.
+         while (read_ahead && read_ahead.use_count() > 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+      }
+
+      static bool MatchesPattern(const std::vector<uint8_t>& buffer, int64_t offset, int64_t length) {
+         for (int64_t i = 0; i < length; i++) {
+            if (buffer[static_cast<size_t>(i)] != static_cast<uint8_t>((offset + i) * 7)) {
+               return false;
+            }
+         }
+         return true;
+      }
+
+   public:
+      TEST_METHOD(SequentialReadsServedFromPrefetchTest) {
+         CreateReadAhead();
+         std::vector<uint8_t> buffer(1000);
+         for (int64_t offset = 0; offset < kFileLength; offset += 1000) {
+            auto bytes_read = read_ahead->read(offset, 1000, buffer.data());
+            Assert::AreEqual(std::min<int64_t>(1000, kFileLength - offset), bytes_read);
+            Assert::IsTrue(MatchesPattern(buffer, offset, bytes_read));
+         }
+
+         auto stats = read_ahead->stats();
+         Assert::IsTrue(stats.hits > stats.misses);
+         Assert::IsTrue(stats.bytes_prefetched > kFileLength / 2);
+         Assert::AreEqual(kMaxWindow, stats.window_size);
+         Assert::AreEqual(0LL, read_ahead->read(kFileLength, 10, buffer.data()));
+      }
+
+      TEST_METHOD(RandomReadsShrinkWindowTest) {
+         CreateReadAhead();
+         std::vector<uint8_t> buffer(512);
+         srand(17);
+         for (int i = 0; i < 200; i++) {
+            auto offset = static_cast<int64_t>(rand() % (kFileLength / 512)) * 512;
+            Assert::AreEqual(512LL, read_ahead->read(offset, 512, buffer.data()));
+            Assert::IsTrue(MatchesPattern(buffer, offset, 512));
+         }
+         Assert::AreEqual(kMinWindow, read_ahead->stats().window_size);
+      }
+
+      TEST_METHOD(MissDiscardsStalePrefetchTest) {
+         CreateReadAhead();
+         sector->delay_ms = 100;
+         std::vector<uint8_t> buffer(4096);
+
+         // The first read starts a stream and queues a prefetch of what follows it; jumping away
+         // before it lands outdates it.
+         read_ahead->read(0, 4096, buffer.data());
+         Assert::AreEqual(1ULL, read_ahead->stats().prefetches);
+         read_ahead->read(kFileLength / 2, 4096, buffer.data());
+         std::this_thread::sleep_for(std::chrono::milliseconds(300));
+         Assert::AreEqual(0LL, read_ahead->stats().bytes_prefetched);
+
+         sector->delay_ms = 0;
+         Assert::AreEqual(4096LL, read_ahead->read(4096, 4096, buffer.data()));
+         Assert::IsTrue(MatchesPattern(buffer, 4096, 4096));
+      }
+   };
+}
@@ -0,0 +1,169 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <vfm/vfm_file.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmReadRangesTests) {
+      // Serves byte (sector_id * 64 + offset) & 0xFF and counts the reads made of it.
+      class counting_sector : public vfm_sector {
+         int64_t length;
+         int sector_id;
+
+      public:
+         int reads = 0;
+
+         counting_sector(int64_t length, int sector_id) : length(length), sector_id(sector_id) { }
+
+         int64_t size() override { return length; }
+         void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override {
+            reads++;
+            for (int64_t i = 0; i < read_length; i++) {
+               buffer[buffer_offset + i] = static_cast<uint8_t>(sector_id * 64 + read_offset + i);
+            }
+         }
+         void deserialize(dargon::binary_reader& reader) override { }
+         std::string to_string() override { return "counting_sector"; }
+      };
+
+      std::shared_ptr<counting_sector> sector_a;
+      std::shared_ptr<counting_sector> sector_b;
+      std::shared_ptr<vfm_file> file;
+
+      void CreateFile() {
+         // [0, 1000) from a, [1000, 1100) unmapped, [1100, 2000) from b
+         sector_a = std::make_shared<counting_sector>(1000, 1);
+         sector_b = std::make_shared<counting_sector>(900, 2);
+         file = std::make_shared<vfm_file>();
+         file->assign_sector(vfm_sector_range(0, 1000), sector_a);
+         file->assign_sector(vfm_sector_range(1100, 2000), sector_b);
+         file->build_index();
+      }
+
+      void AssertMatchesRead(const vfm_read_request& request) {
+         std::vector<uint8_t> expected(static_cast<size_t>(request.length), 0xCC);
+         auto expected_read = file->read(request.offset, request.length, expected.data(), 0);
+         Assert::AreEqual(expected_read, request.bytes_read);
+         Assert::AreEqual(0, memcmp(expected.data(), request.buffer, static_cast<size_t>(request.bytes_read)));
+      }
+
+   public:
+      TEST_METHOD(ReadZeroesOnlyGapsTest) {
+         CreateFile();
+         std::vector<uint8_t> buffer(300, 0xCC);
+         Assert::AreEqual(300LL, file->read(900, 300, buffer.data(), 0));
+         for (int i = 0; i < 300; i++) {
+            uint8_t expected = i < 100 ? static_cast<uint8_t>(64 + 900 + i) : i < 200 ? 0 : static_cast<uint8_t>(128 + i - 200);
+            Assert::AreEqual(expected, buffer[i]);
+         }
+
+         // Reads starting or ending inside the gap.
+         buffer.assign(300, 0xCC);
+         Assert::AreEqual(50LL, file->read(1050, 50, buffer.data(), 0));
+         Assert::IsTrue(std::all_of(buffer.begin(), buffer.begin() + 50, [](uint8_t b) { return b == 0; }));
+         Assert::AreEqual((uint8_t)0xCC, buffer[50]);
+         buffer.assign(300, 0xCC);
+         Assert::AreEqual(100LL, file->read(1050, 100, buffer.data(), 0));
+         Assert::AreEqual((uint8_t)0, buffer[49]);
+         Assert::AreEqual((uint8_t)128, buffer[50]);
+
+         // A file whose first sector starts late reads zeroes before it.
+         auto late = std::make_shared<vfm_file>();
+         late->assign_sector(vfm_sector_range(100, 200), sector_a);
+         late->build_index();
+         buffer.assign(300, 0xCC);
+         Assert::AreEqual(200LL, late->read(0, 300, buffer.data(), 0));
+         Assert::AreEqual((uint8_t)0, buffer[99]);
+         Assert::AreEqual((uint8_t)64, buffer[100]);
+      }
+
+      TEST_METHOD(UnindexedFileReadsEmptyTest) {
+         // Sectors assigned since the last build_index aren't read until it's called again.
+         CreateFile();
+         file->assign_sector(vfm_sector_range(2000, 2100), std::make_shared<counting_sector>(100, 3));
+         std::vector<uint8_t> buffer(10, 0xCC);
+         Assert::AreEqual(0LL, file->size());
+         Assert::AreEqual(0LL, file->read(0, 10, buffer.data(), 0));
+         std::vector<vfm_read_request> requests = { { 0, 10, buffer.data(), 0 } };
+         Assert::AreEqual(0LL, file->read_ranges(requests));
+         Assert::IsTrue(file->borrow(0, 10) == nullptr);
+         Assert::AreEqual(0, sector_a->reads);
+
+         file->build_index();
+         Assert::AreEqual(2100LL, file->size());
+         Assert::AreEqual(10LL, file->read(0, 10, buffer.data(), 0));
+      }
+
+      TEST_METHOD(NearbyRequestsShareSectorReadTest) {
+         CreateFile();
+         std::vector<uint8_t> buffers[3] = { std::vector<uint8_t>(10, 0xCC), std::vector<uint8_t>(10, 0xCC), std::vector<uint8_t>(10, 0xCC) };
+         std::vector<vfm_read_request> requests = {
+            { 300, 10, buffers[0].data(), 0 },
+            { 100, 10, buffers[1].data(), 0 },
+            { 200, 10, buffers[2].data(), 0 }
+         };
+
+         Assert::AreEqual(30LL, file->read_ranges(requests));
+         Assert::AreEqual(1, sector_a->reads);
+
+         sector_a->reads = 0;
+         for (auto& request : requests) {
+            AssertMatchesRead(request);
+         }
+      }
+
+      TEST_METHOD(DistantRequestsReadSeparatelyTest) {
+         CreateFile();
+         std::vector<uint8_t> buffers[2] = { std::vector<uint8_t>(10, 0xCC), std::vector<uint8_t>(10, 0xCC) };
+         std::vector<vfm_read_request> requests = {
+            { 0, 10, buffers[0].data(), 0 },
+            { 900, 10, buffers[1].data(), 0 }
+         };
+
+         file->read_ranges(requests, 100);
+         Assert::AreEqual(2, sector_a->reads);
+      }
+
+      TEST_METHOD(SpansGapAndSectorsTest) {
+         CreateFile();
+         std::vector<uint8_t> buffers[3] = { std::vector<uint8_t>(200, 0xCC), std::vector<uint8_t>(50, 0xCC), std::vector<uint8_t>(50, 0xCC) };
+         std::vector<vfm_read_request> requests = {
+            { 950, 200, buffers[0].data(), 0 },
+            { 1020, 50, buffers[1].data(), 0 },
+            { 1120, 50, buffers[2].data(), 0 }
+         };
+
+         file->read_ranges(requests);
+         Assert::AreEqual(1, sector_a->reads);
+         Assert::AreEqual(1, sector_b->reads);
+
+         for (auto& request : requests) {
+            AssertMatchesRead(request);
+         }
+      }
+
+      TEST_METHOD(OverlappingAndPastEndRequestsTest) {
+         CreateFile();
+         std::vector<uint8_t> buffers[3] = { std::vector<uint8_t>(100, 0xCC), std::vector<uint8_t>(20, 0xCC), std::vector<uint8_t>(10, 0xCC) };
+         std::vector<vfm_read_request> requests = {
+            { 1950, 100, buffers[0].data(), 0 },
+            { 1960, 20, buffers[1].data(), 0 },
+            { 2500, 10, buffers[2].data(), 0 }
+         };
+
+         Assert::AreEqual(70LL, file->read_ranges(requests));
+         Assert::AreEqual(50LL, requests[0].bytes_read);
+         Assert::AreEqual(0LL, requests[2].bytes_read);
+         Assert::AreEqual(1, sector_b->reads);
+
+         for (auto& request : requests) {
+            AssertMatchesRead(request);
+         }
+      }
+   };
+}
@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vfm/vfm_reader.hpp>
+#include <vfm/vfm_sector_collection.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmSectorCollectionTests) {
+      // Sectors open their backing files when loaded; none of these tests' files exist.
+      class missing_files_io : public io_backend {
+      public:
+         file_handle open_read(const std::string& path) override { return kInvalidFile; }
+         int64_t read_at(file_handle file, int64_t offset, int64_t length, uint8_t* buffer) override { return 0; }
+         int64_t size(file_handle file) override { return -1; }
+         void close(file_handle file) override { }
+         bool map(file_handle file, int64_t offset, int64_t length, mapped_range& result) override { return false; }
+         void unmap(const mapped_range& range) override { }
+      };
+
+      void AssertSector(const vfm_sector_collection::sector& sector, int64_t start, int64_t end, const std::string& path, int64_t offset) {
+         Assert::AreEqual(start, sector.range.start_inclusive);
+         Assert::AreEqual(end, sector.range.end_exclusive);
+         Assert::AreEqual(path, sector.source.path);
+         Assert::AreEqual(offset, sector.source.offset);
+      }
+
+      std::vector<vfm_sector_collection::sector> SectorsOf(const vfm_sector_collection& collection) {
+         std::vector<vfm_sector_collection::sector> result;
+         for (auto& pair : collection) {
+            result.push_back(pair.second);
+         }
+         return result;
+      }
+
+      // Reads serialized back through vfm_reader. File sectors stay positional so they can be
+      // told apart by to_string without their backing files existing.
+      std::shared_ptr<vfm_file> Load(const std::vector<uint8_t>& serialized) {
+         auto io = std::make_shared<missing_files_io>();
+         vfm_reader reader(io, std::make_shared<vfm_sector_factory>(io), 0);
+         if (vfm_v2_view::is_v2(serialized.data(), serialized.size())) {
+            auto owner = std::make_shared<std::vector<uint8_t>>(serialized);
+            return reader.load_v2(owner, owner->data(), owner->size());
+         }
+         binary_reader input(serialized.data(), serialized.size());
+         return reader.load(input);
+      }
+
+      void AssertLoadsLinkedCollection(const std::vector<uint8_t>& serialized) {
+         auto file = Load(serialized);
+         auto entries = file->entries();
+         Assert::AreEqual((size_t)4, entries.size());
+         Assert::AreEqual(std::string("[vfm_file_sector base.dat off = 0, len = 100 ]"), entries[0].sector->to_string());
+         Assert::AreEqual(120LL, entries[1].range.start_inclusive);
+         Assert::AreEqual(std::string("[vfm_file_sector base.dat off = 120, len = 80 ]"), entries[1].sector->to_string());
+         Assert::AreEqual(200LL, entries[2].range.start_inclusive);
+
+         uint8_t buffer[5] = { 0xCC, 0xCC, 0xCC, 0xCC, 0xCC };
+         Assert::AreEqual(5LL, file->read(200, 5, buffer, 0));
+         Assert::AreEqual(0, memcmp("\0\0\x02\x03\x04", buffer, 5));
+         Assert::AreEqual(205LL, file->size());
+      }
+
+   public:
+      TEST_METHOD(AssignReplacesOverlappedRangeTest) {
+         vfm_sector_collection collection;
+         collection.assign_sector(vfm_sector_range(0, 1000), vfm_sector_source::file("base.dat", 0));
+         collection.assign_sector(vfm_sector_range(100, 200), vfm_sector_source::file("mod.dat", 50));
+
+         auto sectors = SectorsOf(collection);
+         Assert::AreEqual((size_t)3, sectors.size());
+         AssertSector(sectors[0], 0, 100, "base.dat", 0);
+         AssertSector(sectors[1], 100, 200, "mod.dat", 50);
+         AssertSector(sectors[2], 200, 1000, "base.dat", 200);
+      }
+
+      TEST_METHOD(DeleteRangeSpanningSectorsTest) {
+         vfm_sector_collection collection;
+         collection.assign_sector(vfm_sector_range(0, 100), vfm_sector_source::file("a", 1000));
+         collection.assign_sector(vfm_sector_range(100, 200), vfm_sector_source::file("b", 0));
+         collection.assign_sector(vfm_sector_range(200, 300), vfm_sector_source::file("c", 0));
+         collection.delete_range(vfm_sector_range(50, 250));
+
+         auto sectors = SectorsOf(collection);
+         Assert::AreEqual((size_t)2, sectors.size());
+         AssertSector(sectors[0], 0, 50, "a", 1000);
+         AssertSector(sectors[1], 250, 300, "c", 50);
+         Assert::AreEqual(300LL, collection.size());
+      }
+
+      TEST_METHOD(CompressedSectorsAreNotSplitTest) {
+         vfm_sector_collection collection;
+         collection.assign_sector(vfm_sector_range(0, 100), vfm_sector_source::file("a", 0));
+         collection.assign_sector(vfm_sector_range(100, 200), vfm_sector_source::compressed("pack", 0));
+
+         Assert::ExpectException<std::runtime_error>([&]() { collection.delete_range(vfm_sector_range(50, 150)); });
+         Assert::AreEqual((size_t)2, collection.sector_count());
+         AssertSector(SectorsOf(collection)[0], 0, 100, "a", 0);
+
+         collection.delete_range(vfm_sector_range(50, 200));
+         Assert::AreEqual((size_t)1, collection.sector_count());
+      }
+
+      TEST_METHOD(SerializeRoundTripTest) {
+         // What the linker does: map an archive, unmap an entry, append its replacement.
+         vfm_sector_collection collection;
+         collection.assign_sector(vfm_sector_range(0, 200), vfm_sector_source::file("base.dat", 0));
+         collection.delete_range(vfm_sector_range(100, 120));
+         collection.assign_sector(vfm_sector_range(201, 207), vfm_sector_source::inline_bytes({ 1, 2, 3, 4, 5, 6 }));
+         collection.assign_sector(vfm_sector_range(200, 202), vfm_sector_source::zero());
+         collection.delete_range(vfm_sector_range(205, 207));
+
+         AssertLoadsLinkedCollection(collection.serialize());
+         AssertLoadsLinkedCollection(collection.serialize_v2());
+      }
+   };
+}
@@ -0,0 +1,71 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <stdexcept>
+#include <vfm/vfm_sector_index.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace dargon {
+   TEST_CLASS(VfmSectorIndexTests) {
+      vfm_sector* const kSectorA = reinterpret_cast<vfm_sector*>(0x10);
+      vfm_sector* const kSectorB = reinterpret_cast<vfm_sector*>(0x20);
+      vfm_sector* const kSectorC = reinterpret_cast<vfm_sector*>(0x30);
+
+   public:
+      TEST_METHOD(EmptyIndexTest) {
+         vfm_sector_index index;
+         Assert::IsTrue(index.find_first(0) == index.end());
+         Assert::AreEqual(0LL, index.extent());
+      }
+
+      TEST_METHOD(SortsEntriesTest) {
+         vfm_sector_index::entry_collection entries;
+         entries.emplace_back(vfm_sector_range(200, 300), kSectorC);
+         entries.emplace_back(vfm_sector_range(0, 100), kSectorA);
+         entries.emplace_back(vfm_sector_range(100, 200), kSectorB);
+         vfm_sector_index index(std::move(entries));
+
+         Assert::AreEqual((size_t)3, index.size());
+         Assert::AreEqual(300LL, index.extent());
+         Assert::IsTrue(index.begin()->sector == kSectorA);
+      }
+
+      TEST_METHOD(FindFirstTest) {
+         vfm_sector_index::entry_collection entries;
+         entries.emplace_back(vfm_sector_range(0, 100), kSectorA);
+         entries.emplace_back(vfm_sector_range(100, 200), kSectorB);
+         entries.emplace_back(vfm_sector_range(250, 300), kSectorC);
+         vfm_sector_index index(std::move(entries));
+
+         Assert::IsTrue(index.find_first(0)->sector == kSectorA);
+         Assert::IsTrue(index.find_first(99)->sector == kSectorA);
+         Assert::IsTrue(index.find_first(100)->sector == kSectorB);
+         Assert::IsTrue(index.find_first(220)->sector == kSectorC);
+         Assert::IsTrue(index.find_first(299)->sector == kSectorC);
+         Assert::IsTrue(index.find_first(300) == index.end());
+      }
+
+      TEST_METHOD(WalkSpanningReadTest) {
+         vfm_sector_index::entry_collection entries;
+         entries.emplace_back(vfm_sector_range(0, 100), kSectorA);
+         entries.emplace_back(vfm_sector_range(100, 200), kSectorB);
+         entries.emplace_back(vfm_sector_range(200, 300), kSectorC);
+         vfm_sector_index index(std::move(entries));
+
+         vfm_sector_range read(50, 250);
+         int count = 0;
+         for (auto it = index.find_first(read.start_inclusive); it != index.end() && it->range.start_inclusive < read.end_exclusive; ++it) {
+            Assert::IsTrue(it->range.intersects(read));
+            count++;
+         }
+         Assert::AreEqual(3, count);
+      }
+
+      TEST_METHOD(OverlappingSectorsRejectedTest) {
+         vfm_sector_index::entry_collection entries;
+         entries.emplace_back(vfm_sector_range(0, 150), kSectorA);
+         entries.emplace_back(vfm_sector_range(100, 200), kSectorB);
+         Assert::ExpectException<std::runtime_error>([&]() { vfm_sector_index index(std::move(entries)); });
+      }
+   };
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+// Just enough of Microsoft's CppUnitTest.h to build and run DargonLibCpp.Tests off Windows.
+// TEST_CLASS, TEST_METHOD and TEST_METHOD_INITIALIZE register into a process-wide list that
+// posix_test_main.cpp runs; Assert failures throw and are reported per test.  Needs C++17 for
+// inline static data members.
+
+#include <cstring>
+#include <cwchar>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace VisualStudio { namespace CppUnitTestFramework {
+   class assert_failed : public std::runtime_error {
+   public:
+      assert_failed(const std::string& message) : std::runtime_error(message) { }
+   };
+
+   struct test_case {
+      std::string class_name;
+      std::string method_name;
+      std::function<void()> run;
+   };
+
+   inline std::vector<test_case>& registered_tests() {
+      static std::vector<test_case> tests;
+      return tests;
+   }
+
+   struct test_registration {
+      test_registration(const char* class_name, const char* method_name, void(*run)()) {
+         registered_tests().push_back(test_case{ class_name, method_name, run });
+      }
+   };
+
+   template <typename TClass>
+   class test_class {
+   public:
+      typedef TClass self_type;
+
+      void test_method_initialize() { }
+   };
+
+   class Assert {
+      template <typename T>
+      static std::string to_string(const T& value) {
+         std::ostringstream stream;
+         stream << value;
+         return stream.str();
+      }
+
+      static std::string to_string(const wchar_t* value) {
+         return std::string(value, value + std::char_traits<wchar_t>::length(value));
+      }
+
+      static std::string to_string(const std::wstring& value) {
+         return std::string(value.begin(), value.end());
+      }
+
+      template <typename TExpected, typename TActual>
+      static bool equals(const TExpected& expected, const TActual& actual) {
+         return expected == actual;
+      }
+
+      // As in the real framework, C strings compare by contents.
+      static bool equals(const char* expected, const char* actual) {
+         return std::strcmp(expected, actual) == 0;
+      }
+
+      static bool equals(const wchar_t* expected, const wchar_t* actual) {
+         return std::wcscmp(expected, actual) == 0;
+      }
+
+      static void fail(const std::string& what, const wchar_t* message) {
+         throw assert_failed(message ? what + " - " + to_string(message) : what);
+      }
+
+   public:
+      // Unlike the real framework, expected and actual may differ in type; int64_t is long on
+      // LP64 but long long on Windows, and the tests compare it against LL literals.
+      template <typename TExpected, typename TActual>
+      static void AreEqual(const TExpected& expected, const TActual& actual, const wchar_t* message = nullptr) {
+         if (!equals(expected, actual)) {
+            fail("AreEqual failed. Expected <" + to_string(expected) + "> Actual <" + to_string(actual) + ">", message);
+         }
+      }
+
+      template <typename TExpected, typename TActual>
+      static void AreNotEqual(const TExpected& expected, const TActual& actual, const wchar_t* message = nullptr) {
+         if (equals(expected, actual)) {
+            fail("AreNotEqual failed. Both <" + to_string(actual) + ">", message);
+         }
+      }
+
+      static void IsTrue(bool condition, const wchar_t* message = nullptr) {
+         if (!condition) {
+            fail("IsTrue failed", message);
+         }
+      }
+
+      static void IsFalse(bool condition, const wchar_t* message = nullptr) {
+         if (condition) {
+            fail("IsFalse failed", message);
+         }
+      }
+
+      static void Fail(const wchar_t* message = nullptr) {
+         fail("Fail", message);
+      }
+
+      template <typename TException, typename TFunctor>
+      static void ExpectException(TFunctor functor, const wchar_t* message = nullptr) {
+         try {
+            functor();
+         } catch (const TException&) {
+            return;
+         }
+         fail("ExpectException failed. No exception thrown", message);
+      }
+   };
+}}}
+
+#define TEST_CLASS(class_name) \
+   class class_name; \
+   inline const char* dargon_test_class_name(class_name*) { return #class_name; } \
+   class class_name : public ::Microsoft::VisualStudio::CppUnitTestFramework::test_class<class_name>
+
+#define TEST_METHOD(method_name) \
+   static void method_name##_run() { self_type instance; instance.test_method_initialize(); instance.method_name(); } \
+   inline static const ::Microsoft::VisualStudio::CppUnitTestFramework::test_registration method_name##_registration{ dargon_test_class_name(static_cast<self_type*>(nullptr)), #method_name, &method_name##_run }; \
+   void method_name()
+
+#define TEST_METHOD_INITIALIZE(method_name) \
+   void test_method_initialize() { method_name(); } \
+   void method_name()
@@ -0,0 +1,30 @@
+// Runs the tests registered through posix/CppUnitTest.h.  With arguments, runs only the test
+// classes named; exits non-zero if any test failed.
+#include <cstdio>
+#include <exception>
+#include <set>
+#include <string>
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+int main(int argc, char** argv) {
+   std::set<std::string> class_filter(argv + 1, argv + argc);
+   int run_count = 0;
+   int failure_count = 0;
+   for (auto& test : registered_tests()) {
+      if (!class_filter.empty() && !class_filter.count(test.class_name)) {
+         continue;
+      }
+      run_count++;
+      try {
+         test.run();
+         printf("PASS %s::%s\n", test.class_name.c_str(), test.method_name.c_str());
+      } catch (const std::exception& e) {
+         failure_count++;
+         printf("FAIL %s::%s: %s\n", test.class_name.c_str(), test.method_name.c_str(), e.what());
+      }
+   }
+   printf("%d tests, %d failed\n", run_count, failure_count);
+   return run_count == 0 || failure_count != 0 ? 1 : 0;
+}
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 #include <iostream> // cout for debugging
 #include "base.hpp"
@@ -25,7 +26,7 @@ namespace dargon {
 
    private:
       inline void throw_read_past_eof() {
-         throw std::exception("attempted to read past end of stream");
+         throw std::runtime_error("attempted to read past end of stream");
       }
 
    public:
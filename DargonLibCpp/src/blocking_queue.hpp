@@ -1,6 +1,7 @@
 #pragma once 
 
 #include <queue>
+#include <mutex>
 #include <condition_variable>
 
 namespace dargon {  
@@ -38,7 +39,7 @@ namespace dargon {
       /// </summary>
       T pop()
       {
-         lock_type lock(m_mutex);
+         std::unique_lock<mutex_type> lock(m_mutex);
          m_condition.wait(lock, [this]{ return !m_queue.empty(); });
          T returnedValue = std::move(m_queue.front()); //via http://stackoverflow.com/questions/2142965/c0x-move-from-container#comment2084416_2143009
          m_queue.pop_front();
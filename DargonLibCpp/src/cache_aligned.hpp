@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace dargon {
+   const size_t kCacheLineSize = 64;
+
+   // Allocates size bytes starting on a cache line. Global operator new only guarantees
+   // alignof(std::max_align_t) before C++17, so this over-allocates, aligns by hand and keeps
+   // the raw pointer just below the block. Release with free_cache_aligned.
+   inline void* allocate_cache_aligned(size_t size) {
+      auto raw = ::operator new(size + kCacheLineSize + sizeof(void*));
+      auto address = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+      address = (address + kCacheLineSize - 1) & ~static_cast<uintptr_t>(kCacheLineSize - 1);
+      reinterpret_cast<void**>(address)[-1] = raw;
+      return reinterpret_cast<void*>(address);
+   }
+
+   inline void free_cache_aligned(void* p) {
+      if (p) {
+         ::operator delete(static_cast<void**>(p)[-1]);
+      }
+   }
+}
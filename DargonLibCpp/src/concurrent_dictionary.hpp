@@ -1,43 +1,49 @@
 #pragma once
 
-#include <array>
 #include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <numeric>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
-// determined by a dice roll between 13 17 19 23 29 and 31
-#define CONCURRENT_DICTIONARY_BUCKET_COUNT ((int)25)
+#include "cache_aligned.hpp"
+#include "epoch_reclaimer.hpp"
+#include "hash_mix.hpp"
+#include "noncopyable.hpp"
 
-namespace dargon { 
+namespace dargon {
 
+   // One stripe of a concurrent_dictionary: a map and the mutex guarding it. Callers hold mutex
+   // around everything but copy_pairs. Aligned to a cache line so that one stripe's mutex and map
+   // never share a line with the next stripe's.
    template <typename TKey,
              typename TValue,
              class KeyHash = std::hash<TKey>,
              class KeyEqualityComparer = std::equal_to<TKey>,
              class PairAllocator = std::allocator<std::pair<const TKey, TValue>>>
-   class concurrent_dictionary_bucket
+   class alignas(kCacheLineSize) concurrent_dictionary_bucket
    {
    public:
-      typedef concurrent_dictionary_bucket<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> my_t;
       typedef std::mutex MutexType;
       typedef std::lock_guard<MutexType> LockType;
       typedef std::pair<const TKey, TValue> PairType;
 
+      mutable std::mutex mutex;
+
    private:
-      const my_t* next;
       std::atomic<std::size_t> count;
-      mutable std::mutex mutex;
       std::unordered_map<const TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> dict;
 
    public:
-      concurrent_dictionary_bucket(const my_t* next) : count(0), next(next) { }
+      concurrent_dictionary_bucket() : count(0) { }
       ~concurrent_dictionary_bucket() { }
 
       TValue get_value_or_default(const TKey key) {
-         LockType lock(mutex);
          auto it = dict.find(key);
          if (it == dict.end()) {
             TValue value = {};
@@ -47,19 +53,18 @@ namespace dargon {
          }
       }
 
-      void add_or_update(const TKey& key, std::function<TValue(const TKey&)> add, std::function<TValue(const TKey&, TValue)> update) {
-         LockType lock(mutex);
+      template <typename TAdd, typename TUpdate>
+      void add_or_update(const TKey& key, TAdd&& add, TUpdate&& update) {
          auto it = dict.find(key);
          if (it == dict.end()) {
-            dict.insert(PairType(key, add(key)));
-            count++;
+            emplace(key, add(key));
          } else {
             it->second = update(key, it->second);
          }
       }
 
-      bool conditional_remove(const TKey& key, std::function<bool(const TKey&, const TValue&)> remove_if) {
-         LockType lock(mutex);
+      template <typename TPredicate>
+      bool conditional_remove(const TKey& key, TPredicate&& remove_if) {
          auto it = dict.find(key);
          if (it == dict.end()) {
             return false;
@@ -73,17 +78,39 @@ namespace dargon {
          }
       }
 
-      bool insert(const TKey key, TValue value) {
-         LockType lock(mutex);
-         if (dict.insert(PairType(key, value)).second) {
-            count++;
-            return true;
+      template <typename... TArgs>
+      bool try_emplace(const TKey& key, TArgs&&... args) {
+         if (dict.find(key) != dict.end()) {
+            return false;
          }
-         return false;
+         emplace(key, std::forward<TArgs>(args)...);
+         return true;
+      }
+
+      template <typename TFactory>
+      TValue get_or_add(const TKey& key, TFactory&& factory) {
+         auto it = dict.find(key);
+         if (it == dict.end()) {
+            it = emplace(key, factory(key));
+         }
+         return it->second;
+      }
+
+      template <typename TCompute>
+      bool compute_if_present(const TKey& key, TCompute&& compute) {
+         auto it = dict.find(key);
+         if (it == dict.end()) {
+            return false;
+         }
+         it->second = compute(it->first, it->second);
+         return true;
+      }
+
+      bool insert(const TKey key, TValue value) {
+         return try_emplace(key, std::move(value));
       }
 
       bool remove(const TKey key) {
-         LockType lock(mutex);
          if (dict.erase(key)) {
             count--;
             return true;
@@ -92,63 +119,101 @@ namespace dargon {
       }
 
       bool contains(const TKey key) const {
-         LockType lock(mutex);
          return dict.find(key) != dict.end();
       }
 
       std::size_t size() const { return count; }
 
-      const my_t* next_bucket() const { return next; }
-
       std::vector<PairType> copy_pairs() const {
          LockType lock(mutex);
+         return copy_pairs_locked();
+      }
+
+      std::vector<PairType> copy_pairs_locked() const {
          std::vector<PairType> results(dict.begin(), dict.end());
-         //for (auto kvp : dict) {
-         //   results.emplace_back(kvp);
-         //}
          return results;
       }
+
+   private:
+      // Constructs the value in the map's node, with no temporary.
+      template <typename... TArgs>
+      typename std::unordered_map<const TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator>::iterator emplace(const TKey& key, TArgs&&... args) {
+         count++;
+         return dict.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<TArgs>(args)...)).first;
+      }
    };
 
-   template <typename TKey, 
-             typename TValue, 
-             class KeyHash = std::hash<TKey>, 
+   // A fixed set of stripes. concurrent_dictionary swaps in a larger one to resize.
+   template <typename TKey,
+             typename TValue,
+             class KeyHash = std::hash<TKey>,
+             class KeyEqualityComparer = std::equal_to<TKey>,
+             class PairAllocator = std::allocator<std::pair<const TKey, TValue>>>
+   struct concurrent_dictionary_table : dargon::noncopyable
+   {
+      typedef concurrent_dictionary_bucket<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> bucket;
+
+      const size_t mask;
+      bucket* buckets;
+
+      // new[] needn't honour the buckets' alignment before C++17, so they're built in place in a
+      // cache-aligned block.
+      explicit concurrent_dictionary_table(size_t bucket_count) : mask(bucket_count - 1), buckets(static_cast<bucket*>(allocate_cache_aligned(bucket_count * sizeof(bucket)))) {
+         size_t constructed = 0;
+         try {
+            for (; constructed < bucket_count; constructed++) {
+               new (&buckets[constructed]) bucket();
+            }
+         } catch (...) {
+            destroy(constructed);
+            throw;
+         }
+      }
+
+      ~concurrent_dictionary_table() {
+         destroy(bucket_count());
+      }
+
+      size_t bucket_count() const { return mask + 1; }
+      bucket& bucket_for(size_t hash) const { return buckets[hash & mask]; }
+
+   private:
+      void destroy(size_t constructed) {
+         for (size_t i = 0; i < constructed; i++) {
+            buckets[i].~bucket();
+         }
+         free_cache_aligned(buckets);
+      }
+   };
+
+   template <typename TKey,
+             typename TValue,
+             class KeyHash = std::hash<TKey>,
              class KeyEqualityComparer = std::equal_to<TKey>,
              class PairAllocator = std::allocator<std::pair<const TKey, TValue>>>
    class concurrent_dictionary_iterator : public std::iterator<std::forward_iterator_tag, std::pair<const TKey, TValue>>
    {
       typedef concurrent_dictionary_iterator<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> my_t;
-      typedef concurrent_dictionary_bucket<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> bucket_t;
+      typedef concurrent_dictionary_table<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> table_t;
       typedef std::pair<const TKey, TValue> value_t;
       typedef std::vector<value_t, PairAllocator> pairs_t;
 
    private:
-      const bucket_t* bucket;
+      // Keeps the table walked alive, and consistent as of the resize, if the dictionary is
+      // resized mid-walk. Null once the walk is over.
+      std::shared_ptr<const table_t> table;
+      size_t bucketIndex;
       std::shared_ptr<pairs_t> currentPairs;
       int currentProgress;
 
    public:
-      /*
-      
-         while (this->bucket != nullptr && this->bucket->size() == 0) { this->bucket = this->bucket->next_bucket(); }
-         if (this->bucket) {
-            currentPairs = this->bucket->copy_pairs();
-         }
-         */
       concurrent_dictionary_iterator() : concurrent_dictionary_iterator(nullptr, 0) { }
-      explicit concurrent_dictionary_iterator(bucket_t* bucket, int currentProgress) : bucket(bucket), currentProgress(currentProgress) { 
-         while (this->bucket != nullptr) {
-            if (this->bucket->size() > 0) {
-               currentPairs = std::make_shared<pairs_t>(this->bucket->copy_pairs());
-               if (currentPairs->size() > 0) {
-                  break;
-               }
-            } else {
-               this->bucket = this->bucket->next_bucket();
-            }
+      explicit concurrent_dictionary_iterator(std::shared_ptr<const table_t> table, int currentProgress) : table(std::move(table)), bucketIndex(0), currentProgress(currentProgress) {
+         if (this->table) {
+            advance_to_nonempty_bucket();
          }
       }
-      concurrent_dictionary_iterator(const my_t& iterator) : bucket(iterator.bucket), currentProgress(iterator.currentProgress), currentPairs(iterator.currentPairs) { }
+      concurrent_dictionary_iterator(const my_t& iterator) : table(iterator.table), bucketIndex(iterator.bucketIndex), currentPairs(iterator.currentPairs), currentProgress(iterator.currentProgress) { }
 
       my_t operator++() { increment(); return *this; }
       my_t operator++(int) { my_t copy(*this); increment(); return copy; }
@@ -156,25 +221,46 @@ namespace dargon {
       value_t& operator* () { return currentPairs->at(currentProgress); }
       value_t* operator-> () { return currentPairs ? &currentPairs->at(currentProgress) : nullptr; }
 
-      bool operator==(const my_t& other) { return bucket == other.bucket && currentProgress == other.currentProgress; }
-      bool operator!=(const my_t& other) { return bucket != other.bucket || currentProgress != other.currentProgress; }
+      bool operator==(const my_t& other) { return table == other.table && bucketIndex == other.bucketIndex && currentProgress == other.currentProgress; }
+      bool operator!=(const my_t& other) { return !(*this == other); }
 
-      void increment() { 
+      void increment() {
          if (currentProgress + 1 == currentPairs->size()) {
             currentProgress = 0;
             currentPairs.reset();
-            do {
-               bucket = bucket->next_bucket();
-               if (bucket && bucket->size() > 0) {
-                  currentPairs = std::make_shared<pairs_t>(bucket->copy_pairs());
-               }
-            } while (bucket && !currentPairs);
+            bucketIndex++;
+            advance_to_nonempty_bucket();
          } else {
             ++currentProgress;
          }
       }
+
+   private:
+      void advance_to_nonempty_bucket() {
+         for (; bucketIndex < table->bucket_count(); bucketIndex++) {
+            auto& bucket = table->buckets[bucketIndex];
+            if (bucket.size() > 0) {
+               auto pairs = bucket.copy_pairs();
+               if (pairs.size() > 0) {
+                  currentPairs = std::make_shared<pairs_t>(pairs.begin(), pairs.end());
+                  return;
+               }
+            }
+         }
+         table.reset();
+         bucketIndex = 0;
+      }
    };
 
+   /// <summary>
+   /// Hash map striped over mutex-guarded unordered_maps.  The stripe count is a power of two,
+   /// by default a few times the hardware thread count so threads rarely meet on a stripe.  It
+   /// can be changed while the map is in use with resize_stripes, and doubles by itself once a
+   /// stripe passes kMaxStripeEntries, bounding how long a stripe's rehash holds its lock.
+   /// Operations take an epoch_reclaimer guard so a resize can retire the old stripes from
+   /// under them; an operation that finds its stripe retired retries on the new ones.
+   /// Iterators walk a copy of one stripe at a time and are only weakly consistent.
+   /// </summary>
    template <typename TKey,
              typename TValue,
              class KeyHash = std::hash<TKey>,
@@ -183,52 +269,188 @@ namespace dargon {
    class concurrent_dictionary
    {
       typedef concurrent_dictionary<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> my_t;
-      typedef concurrent_dictionary_bucket<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> bucket;
+      typedef concurrent_dictionary_table<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> table;
+      typedef typename table::bucket bucket;
       typedef concurrent_dictionary_iterator<TKey, TValue, KeyHash, KeyEqualityComparer, PairAllocator> iterator;
 
-      mutable std::array<std::unique_ptr<bucket>, CONCURRENT_DICTIONARY_BUCKET_COUNT> buckets;
-      mutable KeyHash key_hash;
+      static const size_t kMinStripeCount = 8;
+      static const size_t kMaxStripeCount = 4096;
+      static const size_t kMaxStripeEntries = 4096;
 
-      bucket* GetBucket(const TKey& key) const { return buckets[(unsigned int)(key_hash(key)) % CONCURRENT_DICTIONARY_BUCKET_COUNT].get(); }
+      std::atomic<table*> current;
+      // Owns current; guarded by resize_mutex. Iterators share ownership of the table they walk.
+      std::shared_ptr<table> current_owner;
+      mutable std::mutex resize_mutex;
+      mutable KeyHash key_hash;
 
    public:
-      concurrent_dictionary() : key_hash() { 
-         for (auto i = CONCURRENT_DICTIONARY_BUCKET_COUNT - 1; i >= 0; --i) {
-            auto next = i + 1 == CONCURRENT_DICTIONARY_BUCKET_COUNT ? nullptr : buckets[i + 1].get();
-            buckets[i] = std::move(std::unique_ptr<bucket>(new bucket(next)));
-         }
+      // A stripe_count of 0 picks one from the hardware thread count; others round up to a
+      // power of two.
+      explicit concurrent_dictionary(size_t stripe_count = 0) : key_hash() {
+         current_owner = std::make_shared<table>(stripe_count_for(stripe_count ? stripe_count : default_stripe_count()));
+         current.store(current_owner.get(), std::memory_order_release);
       }
 
       TValue get_value_or_default(const TKey& key) {
-         return GetBucket(key)->get_value_or_default(key);
+         return with_bucket(key, [&](bucket& b) { return b.get_value_or_default(key); });
+      }
+
+      // add(key) supplies the value for a new key; update(key, existing) the replacement for an
+      // existing one. Both run under the key's stripe lock.
+      template <typename TAdd, typename TUpdate>
+      void add_or_update(const TKey& key, TAdd&& add, TUpdate&& update) {
+         auto loaded = with_bucket(key, [&](bucket& b) { b.add_or_update(key, add, update); return b.size() > kMaxStripeEntries; });
+         if (loaded) {
+            grow_if_loaded();
+         }
+      }
+
+      // Removes key if remove_if(key, value) returns true, which runs under the key's stripe lock.
+      template <typename TPredicate>
+      bool conditional_remove(const TKey& key, TPredicate&& remove_if) {
+         return with_bucket(key, [&](bucket& b) { return b.conditional_remove(key, remove_if); });
+      }
+
+      // Adds key with a value constructed in place from args, unless key is already present.
+      template <typename... TArgs>
+      bool try_emplace(const TKey& key, TArgs&&... args) {
+         bool loaded = false;
+         auto inserted = with_bucket(key, [&](bucket& b) { loaded = b.size() >= kMaxStripeEntries; return b.try_emplace(key, std::forward<TArgs>(args)...); });
+         if (inserted && loaded) {
+            grow_if_loaded();
+         }
+         return inserted;
       }
 
-      void add_or_update(const TKey& key, std::function<TValue(const TKey&)> add, std::function<TValue(const TKey&, TValue)> update) {
-         return GetBucket(key)->add_or_update(key, add, update);
+      // Returns key's value, first adding factory(key) if key is absent.
+      template <typename TFactory>
+      TValue get_or_add(const TKey& key, TFactory&& factory) {
+         bool loaded = false;
+         auto value = with_bucket(key, [&](bucket& b) { loaded = b.size() >= kMaxStripeEntries; return b.get_or_add(key, factory); });
+         if (loaded) {
+            grow_if_loaded();
+         }
+         return value;
       }
 
-      bool conditional_remove(const TKey& key, std::function<bool(const TKey&, const TValue&)> remove_if) {
-         return GetBucket(key)->conditional_remove(key, remove_if);
+      // Replaces key's value with compute(key, existing) if key is present.
+      template <typename TCompute>
+      bool compute_if_present(const TKey& key, TCompute&& compute) {
+         return with_bucket(key, [&](bucket& b) { return b.compute_if_present(key, compute); });
       }
 
       bool insert(const TKey key, TValue value) {
-         return GetBucket(key)->insert(key, value);
+         return try_emplace(key, std::move(value));
       }
 
       bool remove(const TKey& key) {
-         return GetBucket(key)->remove(key);
+         return with_bucket(key, [&](bucket& b) { return b.remove(key); });
       }
 
       inline bool erase(const TKey& key) { return remove(key); }
 
       bool contains(const TKey& key) const {
-         return GetBucket(key)->contains(key);
+         return with_bucket(key, [&](bucket& b) { return b.contains(key); });
       }
 
-      size_t size() const { return std::accumulate(buckets.begin(), buckets.end(), 0, [](size_t totalCount, std::unique_ptr<bucket>& bucket) { return totalCount += bucket->size(); }); }
+      size_t size() const {
+         epoch_reclaimer::guard guard;
+         auto t = current.load(std::memory_order_acquire);
+         size_t total = 0;
+         for (size_t i = 0; i < t->bucket_count(); i++) {
+            total += t->buckets[i].size();
+         }
+         return total;
+      }
+
+      size_t stripe_count() const {
+         epoch_reclaimer::guard guard;
+         return current.load(std::memory_order_acquire)->bucket_count();
+      }
 
-      iterator begin() const { return my_t::iterator(buckets[0].get(), 0); }
-      iterator end() const { return my_t::iterator(nullptr, 0); }
+      // Moves every entry onto stripe_count stripes, rounded up to a power of two, while the map
+      // stays usable; operations on the old stripes wait for the move, then retry.
+      void resize_stripes(size_t stripe_count) {
+         std::lock_guard<std::mutex> resize_lock(resize_mutex);
+         resize_stripes_locked(stripe_count_for(stripe_count));
+      }
+
+      iterator begin() const {
+         std::lock_guard<std::mutex> resize_lock(resize_mutex);
+         return iterator(current_owner, 0);
+      }
+      iterator end() const { return iterator(nullptr, 0); }
+
+   private:
+      static size_t stripe_count_for(size_t requested) {
+         size_t count = kMinStripeCount;
+         while (count < requested && count < kMaxStripeCount) {
+            count <<= 1;
+         }
+         return count;
+      }
+
+      // Four stripes a hardware thread keeps the odds of two busy threads sharing one low.
+      static size_t default_stripe_count() {
+         auto threads = std::thread::hardware_concurrency();
+         return stripe_count_for((threads ? threads : 1) * 4);
+      }
+
+      size_t hash_of(const TKey& key) const {
+         return hash_mix(key_hash(key));
+      }
+
+      // Runs action on key's stripe with its lock held. A resize holds every stripe lock of the
+      // table it replaces until it has published the new one, so a table that is still current
+      // once its stripe is locked stays current until the lock is released.
+      template <typename TAction>
+      auto with_bucket(const TKey& key, TAction&& action) const -> decltype(action(std::declval<bucket&>())) {
+         auto hash = hash_of(key);
+         epoch_reclaimer::guard guard;
+         while (true) {
+            auto t = current.load(std::memory_order_acquire);
+            auto& b = t->bucket_for(hash);
+            std::lock_guard<std::mutex> lock(b.mutex);
+            if (current.load(std::memory_order_relaxed) == t) {
+               return action(b);
+            }
+         }
+      }
+
+      void grow_if_loaded() {
+         std::lock_guard<std::mutex> resize_lock(resize_mutex);
+         auto bucket_count = current_owner->bucket_count();
+         if (bucket_count < kMaxStripeCount && size() > bucket_count * kMaxStripeEntries / 2) {
+            resize_stripes_locked(bucket_count * 2);
+         }
+      }
+
+      void resize_stripes_locked(size_t stripe_count) {
+         auto old_table = current_owner;
+         if (old_table->bucket_count() == stripe_count) {
+            return;
+         }
+
+         std::vector<std::unique_lock<std::mutex>> locks;
+         locks.reserve(old_table->bucket_count());
+         for (size_t i = 0; i < old_table->bucket_count(); i++) {
+            locks.emplace_back(old_table->buckets[i].mutex);
+         }
+
+         // Copied rather than moved, so iterators already walking the old table see it whole.
+         auto new_table = std::make_shared<table>(stripe_count);
+         for (size_t i = 0; i < old_table->bucket_count(); i++) {
+            for (auto& pair : old_table->buckets[i].copy_pairs_locked()) {
+               new_table->bucket_for(hash_of(pair.first)).insert(pair.first, pair.second);
+            }
+         }
+         current_owner = new_table;
+         current.store(new_table.get(), std::memory_order_release);
+         locks.clear();
+
+         // Operations that loaded the old table may still be waiting on its locks.
+         epoch_reclaimer::instance().retire(new std::shared_ptr<table>(std::move(old_table)));
+      }
    };
 
    template <typename TKey,
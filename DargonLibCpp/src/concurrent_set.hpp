@@ -45,6 +45,9 @@ namespace dargon {
       dict_t dict;
 
    public:
+      // See concurrent_dictionary for how stripe_count is used.
+      explicit concurrent_set(size_t stripe_count = 0) : dict(stripe_count) { }
+
       inline bool insert(const TKey key) { return dict.insert(key, true); }
 
       inline bool remove(const TKey key) { return dict.remove(key); }
@@ -23,19 +23,10 @@ void countdown_event::signal() {
 
 void countdown_event::wait() const {
    std::unique_lock<std::mutex> lock(m_mutex);
-   if (m_counter > 0) {
-      m_conditionVariable.wait(lock);
-   }
+   m_conditionVariable.wait(lock, [this] { return m_counter == 0; });
 }
 
 bool countdown_event::wait(UINT32 milliseconds) const {
    std::unique_lock<std::mutex> lock(m_mutex);
-   if (m_counter > 0) {
-      auto waitResult = m_conditionVariable.wait_for(lock, std::chrono::milliseconds(milliseconds));
-      if (waitResult == std::cv_status::timeout)
-         return false;
-      else
-         return true;
-   }
-   return true;
+   return m_conditionVariable.wait_for(lock, std::chrono::milliseconds(milliseconds), [this] { return m_counter == 0; });
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "dlc_pch.hpp"
+#include "epoch_reclaimer.hpp"
+
+using namespace dargon;
+
+namespace dargon {
+   // Hands a thread's participant back for reuse when the thread exits.
+   struct participant_holder {
+      epoch_reclaimer::participant* participant = nullptr;
+
+      ~participant_holder() {
+         if (participant) {
+            epoch_reclaimer::instance().release_participant(participant);
+         }
+      }
+   };
+}
+
+static thread_local participant_holder tls_participant;
+
+void* epoch_reclaimer::participant::operator new(size_t size) {
+   return allocate_cache_aligned(size);
+}
+
+void epoch_reclaimer::participant::operator delete(void* p) {
+   free_cache_aligned(p);
+}
+
+epoch_reclaimer::guard::guard() {
+   epoch_reclaimer::instance().enter();
+}
+
+epoch_reclaimer::guard::~guard() {
+   epoch_reclaimer::instance().exit();
+}
+
+// Epochs start at 1 so that 0 can mean "not pinned".
+epoch_reclaimer::epoch_reclaimer() : global_epoch(1), participants(nullptr) {
+}
+
+epoch_reclaimer& epoch_reclaimer::instance() {
+   // Never destroyed: guards may still be taken by threads exiting after static destruction.
+   static epoch_reclaimer* reclaimer = new epoch_reclaimer();
+   return *reclaimer;
+}
+
+void epoch_reclaimer::retire(void* object, deleter_t deleter) {
+   {
+      std::lock_guard<std::mutex> lock(retired_mutex);
+      // Orders the caller's unlink before the epoch it is tagged with.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      retired.push_back(retired_object{ object, deleter, global_epoch.load(std::memory_order_relaxed) });
+   }
+   collect();
+}
+
+void epoch_reclaimer::collect() {
+   std::vector<retired_object> ready;
+   {
+      std::lock_guard<std::mutex> lock(retired_mutex);
+      if (retired.empty()) {
+         return;
+      }
+
+      // An object retired in epoch e may still be seen by guards pinned at e, but not by any
+      // pinned at e + 1 or later, so it is safe once the epoch reaches e + 2.
+      for (int i = 0; i < 2 && try_advance(); i++) { }
+      auto epoch = global_epoch.load(std::memory_order_relaxed);
+      auto kept = retired.begin();
+      for (auto it = retired.begin(); it != retired.end(); ++it) {
+         if (it->epoch + 2 <= epoch) {
+            ready.push_back(*it);
+         } else {
+            *kept++ = *it;
+         }
+      }
+      retired.erase(kept, retired.end());
+   }
+
+   // Outside the lock, as deleters may retire further objects.
+   for (auto& object : ready) {
+      object.deleter(object.object);
+   }
+}
+
+epoch_reclaimer::participant* epoch_reclaimer::acquire_participant() {
+   for (auto p = participants.load(std::memory_order_acquire); p; p = p->next) {
+      bool expected = false;
+      if (!p->in_use.load(std::memory_order_relaxed) && p->in_use.compare_exchange_strong(expected, true)) {
+         return p;
+      }
+   }
+
+   auto p = new participant();
+   p->pinned_epoch.store(0, std::memory_order_relaxed);
+   p->in_use.store(true, std::memory_order_relaxed);
+   p->nesting = 0;
+   p->next = participants.load(std::memory_order_relaxed);
+   while (!participants.compare_exchange_weak(p->next, p, std::memory_order_release, std::memory_order_relaxed)) { }
+   return p;
+}
+
+void epoch_reclaimer::release_participant(participant* p) {
+   p->nesting = 0;
+   p->pinned_epoch.store(0, std::memory_order_release);
+   p->in_use.store(false, std::memory_order_release);
+}
+
+epoch_reclaimer::participant* epoch_reclaimer::current_participant() {
+   auto p = tls_participant.participant;
+   if (!p) {
+      p = tls_participant.participant = acquire_participant();
+   }
+   return p;
+}
+
+bool epoch_reclaimer::try_advance() {
+   auto epoch = global_epoch.load(std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   for (auto p = participants.load(std::memory_order_acquire); p; p = p->next) {
+      auto pinned = p->pinned_epoch.load(std::memory_order_acquire);
+      if (pinned != 0 && pinned != epoch) {
+         return false;
+      }
+   }
+   global_epoch.store(epoch + 1, std::memory_order_release);
+   return true;
+}
+
+void epoch_reclaimer::enter() {
+   auto p = current_participant();
+   if (p->nesting++ == 0) {
+      p->pinned_epoch.store(global_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+   }
+}
+
+void epoch_reclaimer::exit() {
+   auto p = current_participant();
+   if (--p->nesting == 0) {
+      p->pinned_epoch.store(0, std::memory_order_release);
+   }
+}
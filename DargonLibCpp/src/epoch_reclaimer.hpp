@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "cache_aligned.hpp"
+#include "noncopyable.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Process-wide epoch-based reclamation, for structures whose readers take no locks.  Readers
+   /// hold a guard while they dereference shared nodes; writers unlink a node and retire it
+   /// rather than deleting it.  A retired node is deleted once every thread that held a guard
+   /// when it was retired has let go, which the reclaimer detects by advancing a global epoch
+   /// only when no guard is pinned to an older one.  Taking a guard costs a store and a fence on
+   /// a cache line private to the thread; guards nest.  Guards must be short: a thread parked
+   /// inside one stops all reclamation.
+   /// </summary>
+   class epoch_reclaimer : dargon::noncopyable {
+   public:
+      typedef void(*deleter_t)(void*);
+
+      class guard : dargon::noncopyable {
+      public:
+         guard();
+         ~guard();
+      };
+
+   private:
+      // Aligned to a cache line so pinning doesn't false-share with other threads' records.
+      struct alignas(kCacheLineSize) participant {
+         std::atomic<uint64_t> pinned_epoch;   // 0 while the thread holds no guard
+         participant* next;
+         uint32_t nesting;                     // touched only by the owning thread
+         std::atomic<bool> in_use;
+
+         // Allocated with allocate_cache_aligned, as plain new may not honour alignas here.
+         static void* operator new(size_t size);
+         static void operator delete(void* p);
+      };
+
+      struct retired_object {
+         void* object;
+         deleter_t deleter;
+         uint64_t epoch;
+      };
+
+      std::atomic<uint64_t> global_epoch;
+      std::atomic<participant*> participants;
+      std::mutex retired_mutex;
+      std::vector<retired_object> retired;
+
+      epoch_reclaimer();
+
+   public:
+      static epoch_reclaimer& instance();
+
+      // Deletes object with deleter once no guard taken before this call is still held.
+      void retire(void* object, deleter_t deleter);
+
+      template <typename T>
+      void retire(T* object) {
+         retire(object, [](void* p) { delete static_cast<T*>(p); });
+      }
+
+      // Deletes what retired objects it can. retire does this as it goes; call it to release
+      // the last objects retired before a structure went quiet.
+      void collect();
+
+   private:
+      participant* acquire_participant();
+      void release_participant(participant* p);
+      participant* current_participant();
+      bool try_advance();
+      void enter();
+      void exit();
+
+      friend class guard;
+      friend struct participant_holder;
+   };
+}
@@ -1,4 +1,6 @@
 #include "dlc_pch.hpp"
+#include <cstring>
+#include <stdexcept>
 #include "guid.hpp"
 
 namespace dargon {
@@ -8,7 +10,7 @@ namespace dargon {
       } else if (10 <= nyble && nyble <= 15) {
          return 'a' + (nyble - 10);
       } else {
-         throw std::exception("Invalid argument; not a nyble.");
+         throw std::runtime_error("Invalid argument; not a nyble.");
       }
    }
 
@@ -20,7 +22,7 @@ namespace dargon {
       } else if ('A' <= c && c <= 'F') {
          return 10 + (c - 'A');
       } else {
-         throw std::exception("Invalid argument; not a hex digit.");
+         throw std::runtime_error("Invalid argument; not a hex digit.");
       }
    }
 
@@ -47,7 +49,7 @@ namespace dargon {
 
    guid guid::parse(const char* input_base64) {
       if (strlen(input_base64) != 2 * GUID_LENGTH) {
-         throw std::exception("Failed to parse guid; incorrect length.");
+         throw std::runtime_error("Failed to parse guid; incorrect length.");
       }
 
       uint8_t data[GUID_LENGTH];
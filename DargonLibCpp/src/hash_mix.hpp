@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dargon {
+   // Spreads a hash over all its bits before a table masks it. std::hash is the identity for
+   // integers and pointers on some standard libraries, and handles and aligned offsets share
+   // their low bits.
+   inline size_t hash_mix(uint64_t hash) {
+      auto mixed = hash * 0x9E3779B97F4A7C15ULL;
+      return static_cast<size_t>(mixed ^ (mixed >> 32));
+   }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "noncopyable.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// The read-only file operations the vfm engine performs on backing files: open, positional
+   /// read, size, and mapping ranges into memory.  kernel32_io_backend implements them over an
+   /// IoProxy inside the injected module; posix_io_backend implements them with open/pread/fstat/
+   /// mmap so the engine can be built, benchmarked and fuzzed off Windows.  All operations are
+   /// safe to call concurrently, including reads on one file.
+   /// </summary>
+   class io_backend : dargon::noncopyable {
+   public:
+      // A HANDLE or a file descriptor.
+      typedef intptr_t file_handle;
+      static const file_handle kInvalidFile = -1;
+
+      // What unmap needs to release a view; data points at the requested offset within it.
+      struct mapped_range {
+         void* view;
+         size_t view_length;
+         const uint8_t* data;
+      };
+
+      virtual ~io_backend() { }
+
+      // Returns kInvalidFile if path can't be opened for reading.
+      virtual file_handle open_read(const std::string& path) = 0;
+
+      // Reads up to length bytes at offset without moving any shared file pointer, returning the
+      // number read. Fewer bytes are returned only at end of file or on error.
+      virtual int64_t read_at(file_handle file, int64_t offset, int64_t length, uint8_t* buffer) = 0;
+
+      // Returns -1 on error.
+      virtual int64_t size(file_handle file) = 0;
+
+      virtual void close(file_handle file) = 0;
+
+      // Maps [offset, offset + length) of file read-only. The mapping stays valid after file is
+      // closed. Returns false if the range can't be mapped.
+      virtual bool map(file_handle file, int64_t offset, int64_t length, mapped_range& result) = 0;
+      virtual void unmap(const mapped_range& range) = 0;
+   };
+}
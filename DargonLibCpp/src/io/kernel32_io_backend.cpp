@@ -0,0 +1,121 @@
+#include "dlc_pch.hpp"
+#include <algorithm>
+#include <iostream>
+#include "kernel32_io_backend.hpp"
+
+using namespace dargon;
+
+namespace {
+   HANDLE to_handle(io_backend::file_handle file) {
+      return reinterpret_cast<HANDLE>(file);
+   }
+
+   // Each thread's read event, created on first use and closed through the same proxy when the
+   // thread exits.
+   struct thread_read_event {
+      std::shared_ptr<dargon::IO::IoProxy> io_proxy;
+      HANDLE event = NULL;
+
+      ~thread_read_event() {
+         if (event != NULL) {
+            io_proxy->CloseHandle(event);
+         }
+      }
+   };
+   thread_local thread_read_event read_event;
+}
+
+kernel32_io_backend::kernel32_io_backend(std::shared_ptr<dargon::IO::IoProxy> io_proxy) : io_proxy(io_proxy) {
+   SYSTEM_INFO system_info;
+   GetSystemInfo(&system_info);
+   allocation_granularity = static_cast<int64_t>(system_info.dwAllocationGranularity);
+}
+
+io_backend::file_handle kernel32_io_backend::open_read(const std::string& path) {
+   // Backing files stay open in vfm_handle_cache for as long as the game runs, so share every
+   // access; a mod tool replacing or deleting one must not fail on our handle.
+   auto handle = io_proxy->CreateFileW(dargon::wide(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+   return handle == INVALID_HANDLE_VALUE ? kInvalidFile : reinterpret_cast<file_handle>(handle);
+}
+
+int64_t kernel32_io_backend::read_at(file_handle file, int64_t offset, int64_t length, uint8_t* buffer) {
+   // Handles are opened overlapped, so reads of one file from many threads run side by side
+   // instead of queueing on the file object's lock. Each thread waits on an event of its own;
+   // the handle itself is signalled by every read on it and can't tell them apart.
+   if (read_event.event == NULL) {
+      read_event.event = io_proxy->CreateEventW(nullptr, TRUE, FALSE, nullptr);
+      if (read_event.event == NULL) {
+         std::cout << "Failed to create read event, err " << GetLastError() << std::endl;
+         return 0;
+      }
+      read_event.io_proxy = io_proxy;
+   }
+   auto event = read_event.event;
+
+   int64_t total_bytes_read = 0;
+   while (total_bytes_read < length) {
+      LARGE_INTEGER position;
+      position.QuadPart = offset + total_bytes_read;
+      OVERLAPPED overlapped = {};
+      overlapped.Offset = position.LowPart;
+      overlapped.OffsetHigh = position.HighPart;
+      overlapped.hEvent = event;
+
+      auto chunk_length = static_cast<DWORD>(std::min<int64_t>(length - total_bytes_read, MAXDWORD));
+      ResetEvent(event);
+      DWORD bytes_read = 0;
+      if (io_proxy->ReadFile(to_handle(file), buffer + total_bytes_read, chunk_length, nullptr, &overlapped)) {
+         // Completed synchronously (typically from the system cache); there is nothing to wait for.
+         bytes_read = static_cast<DWORD>(overlapped.InternalHigh);
+      } else if (GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult(to_handle(file), &overlapped, &bytes_read, TRUE)) {
+         break;
+      }
+      if (bytes_read == 0) {
+         break;
+      }
+      total_bytes_read += bytes_read;
+   }
+   return total_bytes_read;
+}
+
+int64_t kernel32_io_backend::size(file_handle file) {
+   LARGE_INTEGER file_size;
+   if (!GetFileSizeEx(to_handle(file), &file_size)) {
+      return -1;
+   }
+   return file_size.QuadPart;
+}
+
+void kernel32_io_backend::close(file_handle file) {
+   io_proxy->CloseHandle(to_handle(file));
+}
+
+bool kernel32_io_backend::map(file_handle file, int64_t offset, int64_t length, mapped_range& result) {
+   // The view keeps the section (and through it the file) alive; the mapping handle isn't needed after.
+   auto mapping = CreateFileMappingW(to_handle(file), nullptr, PAGE_READONLY, 0, 0, nullptr);
+   if (mapping == NULL) {
+      std::cout << "Failed to create file mapping, err " << GetLastError() << std::endl;
+      return false;
+   }
+
+   // View offsets must be multiples of the allocation granularity.
+   LARGE_INTEGER view_offset;
+   view_offset.QuadPart = offset - (offset % allocation_granularity);
+   auto view_prefix = offset - view_offset.QuadPart;
+   auto view_length = static_cast<SIZE_T>(view_prefix + length);
+
+   auto view = MapViewOfFile(mapping, FILE_MAP_READ, view_offset.HighPart, view_offset.LowPart, view_length);
+   io_proxy->CloseHandle(mapping);
+   if (view == nullptr) {
+      std::cout << "Failed to map view, err " << GetLastError() << std::endl;
+      return false;
+   }
+   result.view = view;
+   result.view_length = view_length;
+   result.data = static_cast<const uint8_t*>(view) + view_prefix;
+   return true;
+}
+
+void kernel32_io_backend::unmap(const mapped_range& range) {
+   UnmapViewOfFile(range.view);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <memory>
+#include "io_backend.hpp"
+#include "IoProxy.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// io_backend over Kernel32.  Opens, reads and closes go through io_proxy so that, inside the
+   /// injected module, they bypass the file subsystem's own detours.
+   /// </summary>
+   class kernel32_io_backend : public io_backend {
+      std::shared_ptr<dargon::IO::IoProxy> io_proxy;
+      int64_t allocation_granularity;
+
+   public:
+      kernel32_io_backend(std::shared_ptr<dargon::IO::IoProxy> io_proxy);
+
+      file_handle open_read(const std::string& path) override;
+      int64_t read_at(file_handle file, int64_t offset, int64_t length, uint8_t* buffer) override;
+      int64_t size(file_handle file) override;
+      void close(file_handle file) override;
+      bool map(file_handle file, int64_t offset, int64_t length, mapped_range& result) override;
+      void unmap(const mapped_range& range) override;
+   };
+}
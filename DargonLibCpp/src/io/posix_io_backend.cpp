@@ -0,0 +1,76 @@
+#include "dlc_pch.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "posix_io_backend.hpp"
+
+using namespace dargon;
+
+namespace {
+   // pread may return less than asked; a single call is capped well below SSIZE_MAX on Linux.
+   const int64_t kMaxReadChunk = 1LL << 30;
+}
+
+posix_io_backend::posix_io_backend() : page_size(sysconf(_SC_PAGESIZE)) {
+}
+
+io_backend::file_handle posix_io_backend::open_read(const std::string& path) {
+   int fd;
+   do {
+      fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+   } while (fd < 0 && errno == EINTR);
+   return fd < 0 ? kInvalidFile : static_cast<file_handle>(fd);
+}
+
+int64_t posix_io_backend::read_at(file_handle file, int64_t offset, int64_t length, uint8_t* buffer) {
+   int64_t total_bytes_read = 0;
+   while (total_bytes_read < length) {
+      auto chunk_length = static_cast<size_t>(std::min(length - total_bytes_read, kMaxReadChunk));
+      auto bytes_read = ::pread(static_cast<int>(file), buffer + total_bytes_read, chunk_length, static_cast<off_t>(offset + total_bytes_read));
+      if (bytes_read < 0 && errno == EINTR) {
+         continue;
+      }
+      if (bytes_read <= 0) {
+         break;
+      }
+      total_bytes_read += bytes_read;
+   }
+   return total_bytes_read;
+}
+
+int64_t posix_io_backend::size(file_handle file) {
+   struct stat status;
+   if (::fstat(static_cast<int>(file), &status) != 0) {
+      return -1;
+   }
+   return static_cast<int64_t>(status.st_size);
+}
+
+void posix_io_backend::close(file_handle file) {
+   ::close(static_cast<int>(file));
+}
+
+bool posix_io_backend::map(file_handle file, int64_t offset, int64_t length, mapped_range& result) {
+   // mmap offsets must be multiples of the page size.
+   auto view_offset = offset - (offset % page_size);
+   auto view_prefix = offset - view_offset;
+   auto view_length = static_cast<size_t>(view_prefix + length);
+
+   auto view = ::mmap(nullptr, view_length, PROT_READ, MAP_SHARED, static_cast<int>(file), static_cast<off_t>(view_offset));
+   if (view == MAP_FAILED) {
+      std::cout << "Failed to map view, errno " << errno << std::endl;
+      return false;
+   }
+   result.view = view;
+   result.view_length = view_length;
+   result.data = static_cast<const uint8_t*>(view) + view_prefix;
+   return true;
+}
+
+void posix_io_backend::unmap(const mapped_range& range) {
+   ::munmap(range.view, range.view_length);
+}
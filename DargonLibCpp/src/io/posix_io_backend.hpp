@@ -0,0 +1,22 @@
+#pragma once
+
+#include "io_backend.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// io_backend over POSIX open/pread/fstat/mmap, for running the vfm engine on Linux.
+   /// </summary>
+   class posix_io_backend : public io_backend {
+      int64_t page_size;
+
+   public:
+      posix_io_backend();
+
+      file_handle open_read(const std::string& path) override;
+      int64_t read_at(file_handle file, int64_t offset, int64_t length, uint8_t* buffer) override;
+      int64_t size(file_handle file) override;
+      void close(file_handle file) override;
+      bool map(file_handle file, int64_t offset, int64_t length, mapped_range& result) override;
+      void unmap(const mapped_range& range) override;
+   };
+}
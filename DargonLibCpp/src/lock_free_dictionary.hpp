@@ -0,0 +1,299 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "epoch_reclaimer.hpp"
+#include "hash_mix.hpp"
+#include "noncopyable.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Hash map whose lookups take no locks, for tables read on every hooked I/O call but written
+   /// only as handles open and close.  Buckets are chains of immutable nodes hanging off atomic
+   /// heads.  A reader holds an epoch_reclaimer guard while it walks a chain and copies out the
+   /// value, or with visit uses it in place, so it never blocks or is blocked by other readers or
+   /// writers.  Writers serialize per stripe, a fixed set of mutexes chosen by the key's hash.
+   /// An update swaps in a new node; removed and replaced nodes are retired to the reclaimer, so
+   /// a value may be destroyed a little after it leaves the map, on whichever thread next
+   /// retires something.  The table doubles, under every stripe, once it averages two entries a
+   /// bucket.
+   /// </summary>
+   template <typename TKey,
+             typename TValue,
+             class KeyHash = std::hash<TKey>,
+             class KeyEqualityComparer = std::equal_to<TKey>>
+   class lock_free_dictionary : dargon::noncopyable {
+      struct node {
+         const size_t hash;
+         const TKey key;
+         const TValue value;
+         std::atomic<node*> next;
+
+         template <typename... TArgs>
+         node(node* next, size_t hash, const TKey& key, TArgs&&... args) : hash(hash), key(key), value(std::forward<TArgs>(args)...), next(next) { }
+      };
+
+      struct table {
+         const size_t mask;
+         std::unique_ptr<std::atomic<node*>[]> buckets;
+
+         explicit table(size_t bucket_count) : mask(bucket_count - 1), buckets(new std::atomic<node*>[bucket_count]) {
+            for (size_t i = 0; i < bucket_count; i++) {
+               buckets[i].store(nullptr, std::memory_order_relaxed);
+            }
+         }
+
+         ~table() {
+            for (size_t i = 0; i <= mask; i++) {
+               for (auto n = buckets[i].load(std::memory_order_relaxed); n; ) {
+                  auto next = n->next.load(std::memory_order_relaxed);
+                  delete n;
+                  n = next;
+               }
+            }
+         }
+
+         std::atomic<node*>& bucket_for(size_t hash) const { return buckets[hash & mask]; }
+      };
+
+      // A power of two no larger than the initial bucket count, so every bucket of every table
+      // size belongs to exactly one stripe.
+      static const size_t kStripeCount = 16;
+      static const size_t kInitialBucketCount = 64;
+      static const size_t kMaxLoadFactor = 2;
+
+      std::atomic<table*> current;
+      std::array<std::mutex, kStripeCount> stripes;
+      std::atomic<size_t> count;
+      KeyHash key_hash;
+      KeyEqualityComparer key_equal;
+
+   public:
+      lock_free_dictionary() : current(new table(kInitialBucketCount)), count(0), key_hash(), key_equal() { }
+
+      // Callers must ensure no lookups are still in flight.
+      ~lock_free_dictionary() {
+         delete current.load(std::memory_order_relaxed);
+      }
+
+      TValue get_value_or_default(const TKey& key) const {
+         auto hash = hash_of(key);
+         epoch_reclaimer::guard guard;
+         auto match = find(current.load(std::memory_order_acquire), hash, key);
+         return match ? match->value : TValue();
+      }
+
+      // Runs visitor(value) on key's value where it lies, copying nothing out, and returns whether
+      // key was present. The value outlives the call even if key is removed meanwhile. visitor
+      // runs under an epoch guard, so a visitor that blocks only delays reclaiming removed
+      // entries; it never blocks other readers or writers.
+      template <typename TVisitor>
+      bool visit(const TKey& key, TVisitor&& visitor) const {
+         auto hash = hash_of(key);
+         epoch_reclaimer::guard guard;
+         auto match = find(current.load(std::memory_order_acquire), hash, key);
+         if (!match) {
+            return false;
+         }
+         visitor(match->value);
+         return true;
+      }
+
+      bool contains(const TKey& key) const {
+         auto hash = hash_of(key);
+         epoch_reclaimer::guard guard;
+         return find(current.load(std::memory_order_acquire), hash, key) != nullptr;
+      }
+
+      bool insert(const TKey& key, TValue value) {
+         return try_emplace(key, std::move(value));
+      }
+
+      // Adds key with a value constructed in place from args, unless key is already present.
+      template <typename... TArgs>
+      bool try_emplace(const TKey& key, TArgs&&... args) {
+         auto hash = hash_of(key);
+         {
+            std::lock_guard<std::mutex> lock(stripe_for(hash));
+            auto t = current.load(std::memory_order_relaxed);
+            if (find(t, hash, key)) {
+               return false;
+            }
+            push(t, hash, key, std::forward<TArgs>(args)...);
+         }
+         grow_if_loaded();
+         return true;
+      }
+
+      // Returns key's value, first adding factory(key) if key is absent. factory runs under the
+      // key's stripe lock; a present key is found without taking it.
+      template <typename TFactory>
+      TValue get_or_add(const TKey& key, TFactory&& factory) {
+         auto hash = hash_of(key);
+         {
+            epoch_reclaimer::guard guard;
+            if (auto match = find(current.load(std::memory_order_acquire), hash, key)) {
+               return match->value;
+            }
+         }
+         TValue result;
+         {
+            std::lock_guard<std::mutex> lock(stripe_for(hash));
+            auto t = current.load(std::memory_order_relaxed);
+            auto match = find(t, hash, key);
+            if (match) {
+               return match->value;
+            }
+            result = push(t, hash, key, factory(key))->value;
+         }
+         grow_if_loaded();
+         return result;
+      }
+
+      // Replaces key's value with compute(key, existing) if key is present. Published values are
+      // never modified in place, as readers copy them without a lock, so the replacement goes
+      // in a new node.
+      template <typename TCompute>
+      bool compute_if_present(const TKey& key, TCompute&& compute) {
+         auto hash = hash_of(key);
+         node* replaced = nullptr;
+         {
+            std::lock_guard<std::mutex> lock(stripe_for(hash));
+            auto link = find_link(current.load(std::memory_order_relaxed), hash, key);
+            replaced = link->load(std::memory_order_relaxed);
+            if (!replaced) {
+               return false;
+            }
+            link->store(new node(replaced->next.load(std::memory_order_relaxed), hash, key, compute(replaced->key, replaced->value)), std::memory_order_release);
+         }
+         epoch_reclaimer::instance().retire(replaced);
+         return true;
+      }
+
+      // add(key) supplies the value for a new key; update(key, existing) the replacement for an
+      // existing one. Both run under the key's stripe lock.
+      template <typename TAdd, typename TUpdate>
+      void add_or_update(const TKey& key, TAdd&& add, TUpdate&& update) {
+         auto hash = hash_of(key);
+         node* replaced = nullptr;
+         {
+            std::lock_guard<std::mutex> lock(stripe_for(hash));
+            auto t = current.load(std::memory_order_relaxed);
+            auto link = find_link(t, hash, key);
+            replaced = link->load(std::memory_order_relaxed);
+            if (!replaced) {
+               push(t, hash, key, add(key));
+            } else {
+               link->store(new node(replaced->next.load(std::memory_order_relaxed), hash, key, update(key, replaced->value)), std::memory_order_release);
+            }
+         }
+         if (replaced) {
+            epoch_reclaimer::instance().retire(replaced);
+         } else {
+            grow_if_loaded();
+         }
+      }
+
+      // Removes key if remove_if(key, value) returns true, which runs under the key's stripe lock.
+      template <typename TPredicate>
+      bool conditional_remove(const TKey& key, TPredicate&& remove_if) {
+         auto hash = hash_of(key);
+         node* removed = nullptr;
+         {
+            std::lock_guard<std::mutex> lock(stripe_for(hash));
+            auto link = find_link(current.load(std::memory_order_relaxed), hash, key);
+            auto existing = link->load(std::memory_order_relaxed);
+            if (!existing || !remove_if(existing->key, existing->value)) {
+               return false;
+            }
+            link->store(existing->next.load(std::memory_order_relaxed), std::memory_order_release);
+            count.fetch_sub(1, std::memory_order_relaxed);
+            removed = existing;
+         }
+         // Outside the lock, as retiring may run deleters of earlier nodes' values.
+         epoch_reclaimer::instance().retire(removed);
+         return true;
+      }
+
+      bool remove(const TKey& key) {
+         return conditional_remove(key, [](const TKey&, const TValue&) { return true; });
+      }
+
+      inline bool erase(const TKey& key) { return remove(key); }
+
+      size_t size() const { return count.load(std::memory_order_relaxed); }
+
+   private:
+      size_t hash_of(const TKey& key) const {
+         return hash_mix(key_hash(key));
+      }
+
+      std::mutex& stripe_for(size_t hash) { return stripes[hash & (kStripeCount - 1)]; }
+
+      node* find(const table* t, size_t hash, const TKey& key) const {
+         for (auto n = t->bucket_for(hash).load(std::memory_order_acquire); n; n = n->next.load(std::memory_order_acquire)) {
+            if (n->hash == hash && key_equal(n->key, key)) {
+               return n;
+            }
+         }
+         return nullptr;
+      }
+
+      // Returns the link pointing at key's node, or the null link ending its chain. Writers only.
+      std::atomic<node*>* find_link(const table* t, size_t hash, const TKey& key) {
+         auto link = &t->bucket_for(hash);
+         for (auto n = link->load(std::memory_order_relaxed); n; n = link->load(std::memory_order_relaxed)) {
+            if (n->hash == hash && key_equal(n->key, key)) {
+               break;
+            }
+            link = &n->next;
+         }
+         return link;
+      }
+
+      template <typename... TArgs>
+      node* push(table* t, size_t hash, const TKey& key, TArgs&&... args) {
+         auto& bucket = t->bucket_for(hash);
+         auto added = new node(bucket.load(std::memory_order_relaxed), hash, key, std::forward<TArgs>(args)...);
+         bucket.store(added, std::memory_order_release);
+         count.fetch_add(1, std::memory_order_relaxed);
+         return added;
+      }
+
+      void grow_if_loaded() {
+         if (size() <= (current.load(std::memory_order_relaxed)->mask + 1) * kMaxLoadFactor) {
+            return;
+         }
+
+         std::array<std::unique_lock<std::mutex>, kStripeCount> locks;
+         for (size_t i = 0; i < kStripeCount; i++) {
+            locks[i] = std::unique_lock<std::mutex>(stripes[i]);
+         }
+         auto old_table = current.load(std::memory_order_relaxed);
+         auto bucket_count = old_table->mask + 1;
+         if (size() <= bucket_count * kMaxLoadFactor) {
+            return;
+         }
+
+         // Readers may still be walking the old chains, so they're copied rather than relinked.
+         auto new_table = new table(bucket_count * 2);
+         for (size_t i = 0; i < bucket_count; i++) {
+            for (auto n = old_table->buckets[i].load(std::memory_order_relaxed); n; n = n->next.load(std::memory_order_relaxed)) {
+               auto& bucket = new_table->bucket_for(n->hash);
+               bucket.store(new node(bucket.load(std::memory_order_relaxed), n->hash, n->key, n->value), std::memory_order_relaxed);
+            }
+         }
+         current.store(new_table, std::memory_order_release);
+         for (auto& lock : locks) {
+            lock.unlock();
+         }
+         epoch_reclaimer::instance().retire(old_table);
+      }
+   };
+}
@@ -0,0 +1,154 @@
+#include "dlc_pch.hpp"
+#include <cstring>
+#include "lz4_block.hpp"
+
+using namespace dargon;
+
+namespace {
+   const size_t kMinMatch = 4;
+   const size_t kLastLiterals = 5;      // the last 5 bytes of a block are always literals
+   const size_t kMatchSearchLimit = 12; // and no match may start within 12 bytes of the end
+   const size_t kMaxOffset = 65535;
+   const int kHashBits = 16;
+
+   uint32_t read32(const uint8_t* p) {
+      uint32_t value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+   }
+
+   uint32_t hash_sequence(uint32_t sequence) {
+      return (sequence * 2654435761U) >> (32 - kHashBits);
+   }
+
+   // Reads the 255-continued length extension that follows a nibble of 15.
+   bool read_length(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+      uint8_t b;
+      do {
+         if (ip >= end) {
+            return false;
+         }
+         b = *ip++;
+         length += b;
+      } while (b == 255);
+      return true;
+   }
+
+   void write_length(std::vector<uint8_t>& out, size_t length) {
+      while (length >= 255) {
+         out.push_back(255);
+         length -= 255;
+      }
+      out.push_back(static_cast<uint8_t>(length));
+   }
+
+   void write_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length) {
+      auto token_index = out.size();
+      out.push_back(static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4));
+      if (literal_length >= 15) {
+         write_length(out, literal_length - 15);
+      }
+      out.insert(out.end(), literals, literals + literal_length);
+      if (match_length == 0) {
+         return;
+      }
+
+      out.push_back(static_cast<uint8_t>(offset & 0xFF));
+      out.push_back(static_cast<uint8_t>(offset >> 8));
+      auto match_code = match_length - kMinMatch;
+      out[token_index] |= static_cast<uint8_t>(match_code >= 15 ? 15 : match_code);
+      if (match_code >= 15) {
+         write_length(out, match_code - 15);
+      }
+   }
+}
+
+int64_t dargon::lz4_decompress_block(const uint8_t* source, size_t source_length, uint8_t* destination, size_t destination_capacity) {
+   auto ip = source;
+   auto ip_end = source + source_length;
+   auto op = destination;
+   auto op_end = destination + destination_capacity;
+
+   while (ip < ip_end) {
+      auto token = *ip++;
+
+      size_t literal_length = token >> 4;
+      if (literal_length == 15 && !read_length(ip, ip_end, literal_length)) {
+         return -1;
+      }
+      if (literal_length > static_cast<size_t>(ip_end - ip) || literal_length > static_cast<size_t>(op_end - op)) {
+         return -1;
+      }
+      memcpy(op, ip, literal_length);
+      ip += literal_length;
+      op += literal_length;
+
+      // The last sequence carries literals only.
+      if (ip == ip_end) {
+         break;
+      }
+
+      if (ip_end - ip < 2) {
+         return -1;
+      }
+      size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > static_cast<size_t>(op - destination)) {
+         return -1;
+      }
+
+      size_t match_length = token & 0x0F;
+      if (match_length == 15 && !read_length(ip, ip_end, match_length)) {
+         return -1;
+      }
+      match_length += kMinMatch;
+      if (match_length > static_cast<size_t>(op_end - op)) {
+         return -1;
+      }
+
+      // Matches may overlap their own output (e.g. offset 1 repeats a byte), so copy forward.
+      auto match = op - offset;
+      if (offset >= match_length) {
+         memcpy(op, match, match_length);
+         op += match_length;
+      } else {
+         for (size_t i = 0; i < match_length; i++) {
+            *op++ = *match++;
+         }
+      }
+   }
+   return op - destination;
+}
+
+void dargon::lz4_compress_block(const uint8_t* source, size_t source_length, std::vector<uint8_t>& destination) {
+   destination.clear();
+   destination.reserve(source_length + source_length / 255 + 16);
+
+   size_t anchor = 0;
+   if (source_length > kMatchSearchLimit) {
+      std::vector<uint32_t> table(static_cast<size_t>(1) << kHashBits, UINT32_MAX);
+      auto search_end = source_length - kMatchSearchLimit;
+      auto match_end_limit = source_length - kLastLiterals;
+
+      size_t ip = 0;
+      while (ip < search_end) {
+         auto sequence = read32(source + ip);
+         auto& slot = table[hash_sequence(sequence)];
+         auto candidate = slot;
+         slot = static_cast<uint32_t>(ip);
+         if (candidate == UINT32_MAX || ip - candidate > kMaxOffset || read32(source + candidate) != sequence) {
+            ip++;
+            continue;
+         }
+
+         auto match_length = kMinMatch;
+         while (ip + match_length < match_end_limit && source[candidate + match_length] == source[ip + match_length]) {
+            match_length++;
+         }
+         write_sequence(destination, source + anchor, ip - anchor, ip - candidate, match_length);
+         ip += match_length;
+         anchor = ip;
+      }
+   }
+   write_sequence(destination, source + anchor, source_length - anchor, 0, 0);
+}
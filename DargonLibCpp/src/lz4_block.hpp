@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dargon {
+   // Minimal implementation of the LZ4 block format (no frame format, no dictionaries), enough
+   // to read and write the blocks stored in compressed vfm sectors.
+
+   // Decompresses the block src[0, source_length) into destination, which must have room for
+   // destination_capacity bytes. Returns the number of bytes written, or -1 if the block is
+   // malformed or would overflow destination.
+   int64_t lz4_decompress_block(const uint8_t* source, size_t source_length, uint8_t* destination, size_t destination_capacity);
+
+   // Compresses source[0, source_length) into a single block, replacing the contents of
+   // destination. Greedy single-probe matching: fast, at some cost in ratio against the
+   // reference compressor, whose output decompresses the same way.
+   void lz4_compress_block(const uint8_t* source, size_t source_length, std::vector<uint8_t>& destination);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace dargon {
+   typedef std::array<uint8_t, 32> sha256_digest;
+
+   struct sha256_digest_hash {
+      size_t operator()(const sha256_digest& digest) const {
+         size_t result;
+         memcpy(&result, digest.data(), sizeof(result));
+         return result;
+      }
+   };
+
+   /// <summary>
+   /// Incremental SHA-256 (FIPS 180-4).  Feed data with update and take the digest with finish;
+   /// the object may not be updated again afterwards.
+   /// </summary>
+   class sha256 {
+      uint32_t state[8];
+      uint8_t block[64];
+      size_t block_length;
+      uint64_t total_length;
+
+   public:
+      sha256();
+      void update(const uint8_t* data, size_t length);
+      sha256_digest finish();
+
+      static sha256_digest compute(const uint8_t* data, size_t length);
+
+   private:
+      void transform(const uint8_t* chunk);
+   };
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "epoch_reclaimer.hpp"
+#include "hash_mix.hpp"
+#include "noncopyable.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Read-copy-update map for tables read constantly and rewritten rarely, such as file
+   /// overrides.  Readers load one pointer to an immutable snapshot, a flat open-addressed table
+   /// of hash, key and value probed linearly, and finish in one probe sequence without taking a
+   /// lock or touching a shared counter.  Writers collect changes in a batch and publish it,
+   /// which builds a whole new snapshot from the current one and swaps it in at once; readers
+   /// see all of a batch or none of it.  Replaced snapshots are retired to epoch_reclaimer, so a
+   /// reader's snapshot stays valid for the length of its lookup.
+   /// </summary>
+   template <typename TKey,
+             typename TValue,
+             class KeyHash = std::hash<TKey>,
+             class KeyEqualityComparer = std::equal_to<TKey>>
+   class snapshot_map : dargon::noncopyable {
+   public:
+      // Changes to publish together. Applied in the order they were made.
+      class batch {
+         struct change {
+            TKey key;
+            TValue value;
+            bool erases;
+         };
+
+         bool clears = false;
+         std::vector<change> changes;
+
+         friend class snapshot_map;
+
+      public:
+         // Drops every entry, published or batched so far, before the rest of the batch applies.
+         void clear() { clears = true; changes.clear(); }
+
+         void assign(const TKey& key, TValue value) { changes.push_back(change{ key, std::move(value), false }); }
+         void erase(const TKey& key) { changes.push_back(change{ key, TValue(), true }); }
+
+         bool empty() const { return !clears && changes.empty(); }
+
+         // Calls visitor(key, value) for each assignment in the batch, including ones a later
+         // change overrides.
+         template <typename TVisitor>
+         void for_each_assignment(TVisitor&& visitor) const {
+            for (auto& change : changes) {
+               if (!change.erases) {
+                  visitor(change.key, change.value);
+               }
+            }
+         }
+      };
+
+   private:
+      struct slot {
+         size_t hash;   // 0 when empty
+         TKey key;
+         TValue value;
+      };
+
+      struct snapshot {
+         size_t mask;
+         size_t count;
+         std::vector<slot> slots;
+      };
+
+      typedef std::unordered_map<TKey, TValue, KeyHash, KeyEqualityComparer> entry_map;
+
+      // Snapshots are kept at most half full so probe sequences stay short.
+      static const size_t kMinCapacity = 16;
+
+      KeyHash key_hash;
+      KeyEqualityComparer key_equal;
+      std::atomic<snapshot*> current;
+      std::mutex publish_mutex;
+
+   public:
+      snapshot_map() : key_hash(), key_equal(), current(build(entry_map())) { }
+
+      // Callers must ensure no lookups are still in flight.
+      ~snapshot_map() {
+         delete current.load(std::memory_order_relaxed);
+      }
+
+      TValue get_value_or_default(const TKey& key) const {
+         auto hash = hash_of(key);
+         epoch_reclaimer::guard guard;
+         auto match = find(current.load(std::memory_order_acquire), hash, key);
+         return match ? match->value : TValue();
+      }
+
+      // Runs visitor(value) on key's value where it lies and returns whether key was present.
+      template <typename TVisitor>
+      bool visit(const TKey& key, TVisitor&& visitor) const {
+         auto hash = hash_of(key);
+         epoch_reclaimer::guard guard;
+         auto match = find(current.load(std::memory_order_acquire), hash, key);
+         if (!match) {
+            return false;
+         }
+         visitor(match->value);
+         return true;
+      }
+
+      bool contains(const TKey& key) const {
+         auto hash = hash_of(key);
+         epoch_reclaimer::guard guard;
+         return find(current.load(std::memory_order_acquire), hash, key) != nullptr;
+      }
+
+      size_t size() const {
+         epoch_reclaimer::guard guard;
+         return current.load(std::memory_order_acquire)->count;
+      }
+
+      // Applies changes to a copy of the current snapshot and publishes the result in one step.
+      void publish(const batch& changes) {
+         if (changes.empty()) {
+            return;
+         }
+
+         snapshot* replaced;
+         {
+            std::lock_guard<std::mutex> lock(publish_mutex);
+            auto old_snapshot = current.load(std::memory_order_relaxed);
+            entry_map entries;
+            if (!changes.clears) {
+               entries.reserve(old_snapshot->count + changes.changes.size());
+               for (auto& s : old_snapshot->slots) {
+                  if (s.hash) {
+                     entries.emplace(s.key, s.value);
+                  }
+               }
+            }
+            for (auto& change : changes.changes) {
+               if (change.erases) {
+                  entries.erase(change.key);
+               } else {
+                  entries[change.key] = change.value;
+               }
+            }
+            current.store(build(entries), std::memory_order_release);
+            replaced = old_snapshot;
+         }
+         epoch_reclaimer::instance().retire(replaced);
+      }
+
+      void assign(const TKey& key, TValue value) {
+         batch changes;
+         changes.assign(key, std::move(value));
+         publish(changes);
+      }
+
+      void erase(const TKey& key) {
+         batch changes;
+         changes.erase(key);
+         publish(changes);
+      }
+
+   private:
+      // 0 marks an empty slot, so it is never a key's hash.
+      size_t hash_of(const TKey& key) const {
+         auto hash = hash_mix(key_hash(key));
+         return hash ? hash : 1;
+      }
+
+      const slot* find(const snapshot* s, size_t hash, const TKey& key) const {
+         for (auto i = hash & s->mask; s->slots[i].hash; i = (i + 1) & s->mask) {
+            auto& candidate = s->slots[i];
+            if (candidate.hash == hash && key_equal(candidate.key, key)) {
+               return &candidate;
+            }
+         }
+         return nullptr;
+      }
+
+      snapshot* build(const entry_map& entries) const {
+         size_t capacity = kMinCapacity;
+         while (capacity < entries.size() * 2) {
+            capacity <<= 1;
+         }
+
+         auto result = new snapshot();
+         result->mask = capacity - 1;
+         result->count = entries.size();
+         result->slots.resize(capacity, slot{ 0, TKey(), TValue() });
+         for (auto& entry : entries) {
+            auto hash = hash_of(entry.first);
+            auto i = hash & result->mask;
+            while (result->slots[i].hash) {
+               i = (i + 1) & result->mask;
+            }
+            result->slots[i] = slot{ hash, entry.first, entry.second };
+         }
+         return result;
+      }
+   };
+}
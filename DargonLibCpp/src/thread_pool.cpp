@@ -0,0 +1,45 @@
+#include "dlc_pch.hpp"
+#include <algorithm>
+#include "thread_pool.hpp"
+
+using namespace dargon;
+
+static thread_local bool tls_is_pool_worker = false;
+
+thread_pool::thread_pool(size_t thread_count) {
+   thread_count = std::max<size_t>(thread_count, 1);
+   for (size_t i = 0; i < thread_count; i++) {
+      workers.emplace_back([this] { worker_main(); });
+   }
+}
+
+thread_pool::~thread_pool() {
+   // An empty task tells one worker to exit; each worker consumes exactly one.
+   for (size_t i = 0; i < workers.size(); i++) {
+      tasks.push(nullptr);
+   }
+   for (auto& worker : workers) {
+      worker.join();
+   }
+}
+
+void thread_pool::enqueue(task_t task) {
+   if (task) {
+      tasks.push(std::move(task));
+   }
+}
+
+bool thread_pool::is_worker_thread() {
+   return tls_is_pool_worker;
+}
+
+void thread_pool::worker_main() {
+   tls_is_pool_worker = true;
+   while (true) {
+      auto task = tasks.pop();
+      if (!task) {
+         return;
+      }
+      task();
+   }
+}
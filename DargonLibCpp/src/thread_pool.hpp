@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <vector>
+#include "blocking_queue.hpp"
+#include "noncopyable.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Fixed-size pool of worker threads draining a shared blocking_queue of tasks.  Tasks run in
+   /// the order they were enqueued, though not necessarily one at a time.  Destroying the pool
+   /// runs every task already enqueued and then joins the workers.
+   /// </summary>
+   class thread_pool : dargon::noncopyable {
+   public:
+      typedef std::function<void()> task_t;
+
+   private:
+      blocking_queue<task_t> tasks;
+      std::vector<std::thread> workers;
+
+   public:
+      static const size_t kDefaultThreadCount = 4;
+
+      explicit thread_pool(size_t thread_count = kDefaultThreadCount);
+      ~thread_pool();
+
+      // Queues task to run on a worker thread. Tasks must not throw.
+      void enqueue(task_t task);
+
+      size_t thread_count() const { return workers.size(); }
+
+      // True if the calling thread is a worker of any thread_pool. Work that would block waiting
+      // on other pool tasks should run inline instead when this holds, or the pool can starve.
+      static bool is_worker_thread();
+
+   private:
+      void worker_main();
+   };
+}
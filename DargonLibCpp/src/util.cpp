@@ -5,8 +5,10 @@
 #include <string>
 #include <sstream> 
 #include <vector>
+#ifdef _WIN32
 #include <Windows.h>
 #include <TlHelp32.h>
+#endif
 #include "util.hpp"
 
 using namespace dargon;
@@ -19,6 +21,7 @@ std::string GetFileName(const std::string& path)
    return result;
 }
 
+#ifdef _WIN32
 HANDLE OpenMainThread()
 {
    //Takes a snapshot of the threads of the current process id
@@ -82,6 +85,7 @@ HMODULE WaitForModuleHandle(const char* moduleName)
    std::cout << "The " << moduleName << " module loaded.  hModule: " << hModule << std::endl;
    return hModule;
 }
+#endif
 
 std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems) {
    std::stringstream ss(s);
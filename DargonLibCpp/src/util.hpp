@@ -2,7 +2,9 @@
 
 #include "dlc_pch.hpp"
 
+#ifdef _WIN32
 #include <WinBase.h>
+#endif
 #include <string>
 #include <vector>
 
@@ -14,8 +16,10 @@
 
 std::string GetFileName(const std::string& filePath);
 
+#ifdef _WIN32
 HANDLE OpenMainThread();
 HMODULE WaitForModuleHandle(const char* moduleName);
+#endif
 
 // http://stackoverflow.com/questions/236129/how-to-split-a-string-in-c
 std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems);
@@ -0,0 +1,124 @@
+#include "dlc_pch.hpp"
+#include "vfm_block_cache.hpp"
+
+using namespace dargon;
+
+vfm_block_cache::vfm_block_cache(int64_t budget, int64_t block_size, size_t shard_count)
+   : block_size(block_size), bypass_threshold(block_size * 16), shard_budget(0), next_file_key(1), hits(0), misses(0), evictions(0), bypasses(0) {
+   shard_count = std::max<size_t>(shard_count, 1);
+   for (size_t i = 0; i < shard_count; i++) {
+      shards.emplace_back(std::make_unique<shard>());
+   }
+   set_budget(budget);
+}
+
+uint64_t vfm_block_cache::get_file_key(const std::string& path, uint64_t file_id, const std::string& view) {
+   std::lock_guard<std::mutex> lock(file_keys_mutex);
+   auto& keys_by_view = file_keys_by_path[path];
+   auto match = keys_by_view.find(std::make_pair(file_id, view));
+   if (match != keys_by_view.end()) {
+      return match->second;
+   }
+   auto key = next_file_key++;
+   keys_by_view.emplace(std::make_pair(file_id, view), key);
+   return key;
+}
+
+void vfm_block_cache::invalidate(const std::string& path) {
+   std::unordered_set<uint64_t> dropped_keys;
+   {
+      std::lock_guard<std::mutex> lock(file_keys_mutex);
+      auto match = file_keys_by_path.find(path);
+      if (match == file_keys_by_path.end()) {
+         return;
+      }
+      for (auto& view : match->second) {
+         dropped_keys.insert(view.second);
+      }
+      file_keys_by_path.erase(match);
+   }
+
+   std::vector<std::shared_ptr<const block_t>> dropped;
+   for (auto& s : shards) {
+      std::lock_guard<std::mutex> lock(s->mutex);
+      for (auto it = s->lru.begin(); it != s->lru.end(); ) {
+         if (dropped_keys.count(it->first.file_key)) {
+            s->bytes_cached -= it->second->size();
+            s->entries_by_key.erase(it->first);
+            dropped.emplace_back(std::move(it->second));
+            it = s->lru.erase(it);
+         } else {
+            ++it;
+         }
+      }
+   }
+}
+
+void vfm_block_cache::set_budget(int64_t budget) {
+   shard_budget = std::max<int64_t>(budget, 0) / static_cast<int64_t>(shards.size());
+   std::vector<std::shared_ptr<const block_t>> evicted;
+   for (auto& s : shards) {
+      std::lock_guard<std::mutex> lock(s->mutex);
+      trim_shard(*s, evicted);
+   }
+}
+
+vfm_block_cache_stats vfm_block_cache::stats() {
+   vfm_block_cache_stats result = {};
+   result.hits = hits;
+   result.misses = misses;
+   result.evictions = evictions;
+   result.bypasses = bypasses;
+   for (auto& s : shards) {
+      std::lock_guard<std::mutex> lock(s->mutex);
+      result.bytes_cached += s->bytes_cached;
+   }
+   return result;
+}
+
+vfm_block_cache::shard& vfm_block_cache::get_shard(const block_key& key) {
+   return *shards[block_key_hash()(key) % shards.size()];
+}
+
+std::shared_ptr<const vfm_block_cache::block_t> vfm_block_cache::lookup(uint64_t file_key, int64_t block_offset) {
+   block_key key = { file_key, block_offset };
+   auto& s = get_shard(key);
+   std::lock_guard<std::mutex> lock(s.mutex);
+   auto match = s.entries_by_key.find(key);
+   if (match == s.entries_by_key.end()) {
+      misses++;
+      return nullptr;
+   }
+   hits++;
+   s.lru.splice(s.lru.begin(), s.lru, match->second);
+   return match->second->second;
+}
+
+std::shared_ptr<const vfm_block_cache::block_t> vfm_block_cache::insert(uint64_t file_key, int64_t block_offset, std::shared_ptr<const block_t> block) {
+   block_key key = { file_key, block_offset };
+   auto& s = get_shard(key);
+   std::vector<std::shared_ptr<const block_t>> evicted;
+   std::lock_guard<std::mutex> lock(s.mutex);
+   auto match = s.entries_by_key.find(key);
+   if (match != s.entries_by_key.end()) {
+      // Raced another reader filling the same block; keep theirs.
+      return match->second->second;
+   }
+   s.lru.emplace_front(key, block);
+   s.entries_by_key.emplace(key, s.lru.begin());
+   s.bytes_cached += block->size();
+   trim_shard(s, evicted);
+   return block;
+}
+
+void vfm_block_cache::trim_shard(shard& s, std::vector<std::shared_ptr<const block_t>>& evicted) {
+   int64_t budget = shard_budget;
+   while (s.bytes_cached > budget && !s.lru.empty()) {
+      auto& victim = s.lru.back();
+      s.bytes_cached -= victim.second->size();
+      s.entries_by_key.erase(victim.first);
+      evicted.emplace_back(std::move(victim.second));
+      s.lru.pop_back();
+      evictions++;
+   }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "hash_mix.hpp"
+#include "noncopyable.hpp"
+
+namespace dargon {
+   struct vfm_block_cache_stats {
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t evictions;
+      uint64_t bypasses;
+      int64_t bytes_cached;
+   };
+
+   /// <summary>
+   /// Process-wide cache of fixed-size blocks of backing data, shared by every vfm sector that
+   /// reads through it.  Blocks are keyed by (backing file key, aligned block offset) and evicted
+   /// least-recently-used once the memory budget is exceeded.  Lookups are spread over
+   /// independently locked shards so concurrent game I/O threads rarely touch the same lock.
+   /// </summary>
+   class vfm_block_cache : dargon::noncopyable {
+   public:
+      typedef std::vector<uint8_t> block_t;
+
+   private:
+      struct block_key {
+         uint64_t file_key;
+         int64_t block_offset;
+
+         bool operator==(const block_key& other) const { return file_key == other.file_key && block_offset == other.block_offset; }
+      };
+
+      struct block_key_hash {
+         size_t operator()(const block_key& key) const {
+            return hash_mix(key.file_key * 0xC2B2AE3D27D4EB4FULL ^ static_cast<uint64_t>(key.block_offset));
+         }
+      };
+
+      typedef std::pair<block_key, std::shared_ptr<const block_t>> entry_t;
+      typedef std::list<entry_t> lru_list_t;
+
+      struct shard {
+         std::mutex mutex;
+         lru_list_t lru;
+         std::unordered_map<block_key, lru_list_t::iterator, block_key_hash> entries_by_key;
+         int64_t bytes_cached = 0;
+      };
+
+      const int64_t block_size;
+      const int64_t bypass_threshold;
+      std::atomic<int64_t> shard_budget;
+      std::vector<std::unique_ptr<shard>> shards;
+
+      std::mutex file_keys_mutex;
+      std::unordered_map<std::string, std::map<std::pair<uint64_t, std::string>, uint64_t>> file_keys_by_path;
+      uint64_t next_file_key;
+
+      std::atomic<uint64_t> hits;
+      std::atomic<uint64_t> misses;
+      std::atomic<uint64_t> evictions;
+      std::atomic<uint64_t> bypasses;
+
+   public:
+      static const int64_t kDefaultBudget = 32 * 1024 * 1024;
+      static const int64_t kDefaultBlockSize = 64 * 1024;
+      static const size_t kDefaultShardCount = 16;
+
+      vfm_block_cache(int64_t budget = kDefaultBudget, int64_t block_size = kDefaultBlockSize, size_t shard_count = kDefaultShardCount);
+
+      // Returns a stable key for the backing file opened at path as file_id (see
+      // vfm_backing_file::get_id), or for a decoded view of it named by view (decompressed
+      // bytes, say) that must not share blocks with its raw bytes. Sectors resolve their key once
+      // and pass it to read; sectors over the same opened file and view share cached blocks, and
+      // a file opened at path afresh never shares blocks with one opened before.
+      uint64_t get_file_key(const std::string& path, uint64_t file_id, const std::string& view = std::string());
+
+      // Drops every block cached for path and its views. Keys resolved from here on are fresh,
+      // so a fill of the old bytes still in flight is never served to sectors created afterwards.
+      void invalidate(const std::string& path);
+
+      // Copies length bytes at offset of the backing file identified by file_key into buffer,
+      // serving whole blocks from the cache where possible. fill(offset, length, buffer) reads
+      // from the backing file on a miss and returns the number of bytes read. Reads of at least
+      // the bypass threshold go straight to fill so streaming doesn't flush hot blocks. Returns
+      // the number of bytes copied, which is short only if fill was.
+      template <typename TFill>
+      int64_t read(uint64_t file_key, int64_t offset, int64_t length, uint8_t* buffer, TFill&& fill) {
+         if (length >= bypass_threshold) {
+            bypasses++;
+            return fill(offset, length, buffer);
+         }
+
+         int64_t total_copied = 0;
+         while (total_copied < length) {
+            auto position = offset + total_copied;
+            auto block_offset = position - (position % block_size);
+            auto block = lookup(file_key, block_offset);
+            if (!block) {
+               auto filled = std::make_shared<block_t>(static_cast<size_t>(block_size));
+               auto bytes_filled = fill(block_offset, block_size, filled->data());
+               if (bytes_filled <= 0) {
+                  break;
+               }
+               filled->resize(static_cast<size_t>(bytes_filled));
+               block = insert(file_key, block_offset, std::move(filled));
+            }
+
+            auto block_position = position - block_offset;
+            auto available = static_cast<int64_t>(block->size()) - block_position;
+            if (available <= 0) {
+               break;
+            }
+            auto copy_length = std::min(available, length - total_copied);
+            memcpy(buffer + total_copied, block->data() + block_position, static_cast<size_t>(copy_length));
+            total_copied += copy_length;
+         }
+         return total_copied;
+      }
+
+      void set_budget(int64_t budget);
+      vfm_block_cache_stats stats();
+
+   private:
+      shard& get_shard(const block_key& key);
+      std::shared_ptr<const block_t> lookup(uint64_t file_key, int64_t block_offset);
+      std::shared_ptr<const block_t> insert(uint64_t file_key, int64_t block_offset, std::shared_ptr<const block_t> block);
+      void trim_shard(shard& s, std::vector<std::shared_ptr<const block_t>>& evicted);
+   };
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "lz4_block.hpp"
+
+namespace dargon {
+   // "VFMZ"
+   const uint32_t vfm_compressed_magic = 0x5A4D4656U;
+
+   // A compressed object as stored in a mod pack: this header, then frame_count + 1 uint64
+   // offsets (relative to the header) bounding each frame's stored bytes, then the frames. Frame
+   // i holds uncompressed bytes [i * frame_size, (i + 1) * frame_size), clipped to
+   // uncompressed_length. A frame whose stored size equals its uncompressed size is raw;
+   // anything else is an LZ4 block. Frames decompress independently, so a read touches only
+   // the frames it overlaps.
+   struct vfm_compressed_header {
+      uint32_t magic;
+      uint32_t frame_size;
+      uint32_t frame_count;
+      uint32_t reserved;
+      int64_t uncompressed_length;
+   };
+   static_assert(sizeof(vfm_compressed_header) == 24, "vfm_compressed_header layout changed");
+
+   // Returns the uncompressed size of frame i.
+   inline int64_t vfm_compressed_frame_length(const vfm_compressed_header& header, uint32_t i) {
+      auto start = static_cast<int64_t>(i) * header.frame_size;
+      return std::min<int64_t>(header.frame_size, header.uncompressed_length - start);
+   }
+
+   // Decodes one stored frame into destination, which must hold exactly length bytes.
+   inline bool vfm_compressed_decode_frame(const uint8_t* stored, size_t stored_length, uint8_t* destination, size_t length) {
+      if (stored_length == length) {
+         memcpy(destination, stored, length);
+         return true;
+      }
+      return lz4_decompress_block(stored, stored_length, destination, length) == static_cast<int64_t>(length);
+   }
+
+   // Builds a compressed object from data. Frames that don't shrink are stored raw.
+   inline std::vector<uint8_t> vfm_compressed_encode(const uint8_t* data, size_t length, uint32_t frame_size = 64 * 1024) {
+      vfm_compressed_header header = {};
+      header.magic = vfm_compressed_magic;
+      header.frame_size = frame_size;
+      header.frame_count = static_cast<uint32_t>((length + frame_size - 1) / frame_size);
+      header.uncompressed_length = static_cast<int64_t>(length);
+
+      std::vector<uint64_t> offsets(header.frame_count + 1);
+      std::vector<uint8_t> result(sizeof(header) + offsets.size() * sizeof(uint64_t));
+      std::vector<uint8_t> compressed;
+      for (uint32_t i = 0; i < header.frame_count; i++) {
+         auto frame = data + static_cast<size_t>(i) * frame_size;
+         auto frame_length = static_cast<size_t>(vfm_compressed_frame_length(header, i));
+         lz4_compress_block(frame, frame_length, compressed);
+         offsets[i] = result.size();
+         if (compressed.size() < frame_length) {
+            result.insert(result.end(), compressed.begin(), compressed.end());
+         } else {
+            result.insert(result.end(), frame, frame + frame_length);
+         }
+      }
+      offsets[header.frame_count] = result.size();
+
+      memcpy(result.data(), &header, sizeof(header));
+      memcpy(result.data() + sizeof(header), offsets.data(), offsets.size() * sizeof(uint64_t));
+      return result;
+   }
+}
@@ -0,0 +1,144 @@
+#include "dlc_pch.hpp"
+#include <cstring>
+#include <sstream>
+#include "binary_reader.hpp"
+#include "vfm_compressed_sector.hpp"
+
+using namespace dargon;
+
+const dargon::guid vfm_compressed_sector::kGuid(guid::parse("A45949AD3A074A5DA57F555914C83287"));
+
+vfm_compressed_sector::vfm_compressed_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache)
+   : vfm_compressed_sector(handle_cache, block_cache, "", nullptr, 0, 0) {
+}
+
+vfm_compressed_sector::vfm_compressed_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache, std::string path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length)
+   : path(path), offset(offset), length(length), handle_cache(handle_cache), block_cache(block_cache), file(file), cache_key(0), loaded(false), header() {
+   resolve_cache_key();
+}
+
+int64_t vfm_compressed_sector::size() {
+   return length;
+}
+
+void vfm_compressed_sector::read(int64_t read_offset, int64_t read_length, uint8_t * buffer, int32_t buffer_offset) {
+   if (buffer_offset > 0) {
+      return read(read_offset, read_length, buffer + buffer_offset, 0);
+   }
+
+   int64_t bytes_read = 0;
+   if (ensure_loaded()) {
+      auto fill = [this](int64_t fill_offset, int64_t fill_length, uint8_t* fill_buffer) { return decompress(fill_offset, fill_length, fill_buffer); };
+      if (block_cache) {
+         bytes_read = block_cache->read(cache_key, read_offset, read_length, buffer, fill);
+      } else {
+         bytes_read = fill(read_offset, read_length, buffer);
+      }
+   }
+   if (bytes_read < read_length) {
+      memset(buffer + bytes_read, 0, static_cast<size_t>(read_length - bytes_read));
+   }
+}
+
+void vfm_compressed_sector::deserialize(dargon::binary_reader & reader) {
+   path = reader.read_null_terminated_string();
+
+   offset = reader.read_int64();
+   length = reader.read_int64();
+
+   file = handle_cache->get(path);
+   resolve_cache_key();
+}
+
+std::string vfm_compressed_sector::to_string() {
+   std::stringstream ss;
+   ss << "[vfm_compressed_sector " << path << " off = " + std::to_string(offset) << ", len = " << std::to_string(length) << ", frames = " << header.frame_count << " ]";
+   return ss.str();
+}
+
+void vfm_compressed_sector::resolve_cache_key() {
+   // Decompressed blocks must not collide with raw blocks of the same pack read by file sectors.
+   if (block_cache) {
+      cache_key = block_cache->get_file_key(path, file ? file->get_id() : 0, "lz4@" + std::to_string(offset));
+   }
+}
+
+bool vfm_compressed_sector::ensure_loaded() {
+   std::call_once(load_once, [this]() { load_frame_table(); });
+   return loaded;
+}
+
+void vfm_compressed_sector::load_frame_table() {
+   if (!file) {
+      std::cout << "VFM FAILED TO OPEN FILE " << path.c_str() << ":(" << std::endl;
+      return;
+   }
+
+   if (file->read(offset, sizeof(header), reinterpret_cast<uint8_t*>(&header)) != sizeof(header) || header.magic != vfm_compressed_magic) {
+      std::cout << "VFM compressed object at " << path << "@" << offset << " has no valid header" << std::endl;
+      return;
+   }
+   if (header.uncompressed_length != length || header.frame_size == 0 ||
+       header.frame_count != (length + header.frame_size - 1) / header.frame_size) {
+      std::cout << "VFM compressed object at " << path << "@" << offset << " doesn't match its sector" << std::endl;
+      return;
+   }
+
+   frame_offsets.resize(header.frame_count + 1);
+   auto table_length = static_cast<int64_t>(frame_offsets.size() * sizeof(uint64_t));
+   if (file->read(offset + sizeof(header), table_length, reinterpret_cast<uint8_t*>(frame_offsets.data())) != table_length) {
+      std::cout << "VFM compressed object at " << path << "@" << offset << " has a truncated frame table" << std::endl;
+      return;
+   }
+   for (size_t i = 0; i + 1 < frame_offsets.size(); i++) {
+      if (frame_offsets[i] > frame_offsets[i + 1]) {
+         std::cout << "VFM compressed object at " << path << "@" << offset << " has a corrupt frame table" << std::endl;
+         return;
+      }
+   }
+   loaded = true;
+}
+
+int64_t vfm_compressed_sector::decompress(int64_t read_offset, int64_t read_length, uint8_t* buffer) {
+   read_length = std::min(read_length, length - read_offset);
+   if (read_length <= 0) {
+      return 0;
+   }
+   if (!file) {
+      return 0;
+   }
+
+   std::vector<uint8_t> stored;
+   std::vector<uint8_t> frame;
+   int64_t produced = 0;
+   auto first_frame = static_cast<uint32_t>(read_offset / header.frame_size);
+   auto last_frame = static_cast<uint32_t>((read_offset + read_length - 1) / header.frame_size);
+   for (auto i = first_frame; i <= last_frame; i++) {
+      auto frame_start = static_cast<int64_t>(i) * header.frame_size;
+      auto frame_length = vfm_compressed_frame_length(header, i);
+      auto stored_length = static_cast<int64_t>(frame_offsets[i + 1] - frame_offsets[i]);
+      stored.resize(static_cast<size_t>(stored_length));
+      if (file->read(offset + static_cast<int64_t>(frame_offsets[i]), stored_length, stored.data()) != stored_length) {
+         break;
+      }
+
+      // Frames the read covers entirely decode straight into the caller's buffer.
+      auto copy_start = std::max(read_offset, frame_start);
+      auto copy_end = std::min(read_offset + read_length, frame_start + frame_length);
+      bool whole_frame = copy_start == frame_start && copy_end == frame_start + frame_length;
+      auto destination = whole_frame ? buffer + (frame_start - read_offset) : nullptr;
+      if (!whole_frame) {
+         frame.resize(static_cast<size_t>(frame_length));
+         destination = frame.data();
+      }
+      if (!vfm_compressed_decode_frame(stored.data(), stored.size(), destination, static_cast<size_t>(frame_length))) {
+         std::cout << "VFM compressed frame " << i << " of " << path << "@" << offset << " is corrupt" << std::endl;
+         break;
+      }
+      if (!whole_frame) {
+         memcpy(buffer + (copy_start - read_offset), frame.data() + (copy_start - frame_start), static_cast<size_t>(copy_end - copy_start));
+      }
+      produced += copy_end - copy_start;
+   }
+   return produced;
+}
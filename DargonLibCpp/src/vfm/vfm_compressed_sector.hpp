@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "vfm_sector.hpp"
+#include "vfm_block_cache.hpp"
+#include "vfm_compressed_format.hpp"
+#include "vfm_handle_cache.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Sector whose bytes are stored as a compressed object (see vfm_compressed_format.hpp) at
+   /// offset in a mod pack; length is the uncompressed size.  The object's frame table is read on
+   /// first use.  Reads decompress only the frames they overlap, and decompressed blocks are kept
+   /// in the shared block cache under a key distinct from the pack's raw bytes, so hot frames are
+   /// decompressed once and count against the same memory budget as everything else.  Frames
+   /// are read from the backing file the sector was created with.
+   /// </summary>
+   class vfm_compressed_sector : public vfm_sector {
+   public:
+      static const dargon::guid kGuid;
+
+   private:
+      std::string path;
+      int64_t offset;
+      int64_t length;
+      std::shared_ptr<vfm_handle_cache> handle_cache;
+      std::shared_ptr<vfm_block_cache> block_cache;
+      std::shared_ptr<vfm_backing_file> file;
+      uint64_t cache_key;
+
+      std::once_flag load_once;
+      bool loaded;
+      vfm_compressed_header header;
+      std::vector<uint64_t> frame_offsets;
+
+   public:
+      vfm_compressed_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache);
+      vfm_compressed_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache, std::string path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length);
+
+      const std::string& backing_path() const { return path; }
+
+      virtual int64_t size() override;
+      virtual void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override;
+      virtual void deserialize(dargon::binary_reader& reader) override;
+      virtual std::string to_string() override;
+
+   private:
+      bool ensure_loaded();
+      void load_frame_table();
+      void resolve_cache_key();
+
+      // Decompresses uncompressed bytes [read_offset, read_offset + read_length) into buffer,
+      // returning the number of bytes produced.
+      int64_t decompress(int64_t read_offset, int64_t read_length, uint8_t* buffer);
+   };
+}
@@ -0,0 +1,207 @@
+#include "dlc_pch.hpp"
+#include <algorithm>
+#include <iostream>
+#include "vfm_content_store.hpp"
+
+using namespace dargon;
+
+vfm_content_store::vfm_content_store(region_reader read_region, int64_t max_hashed_length, std::shared_ptr<thread_pool> hash_pool)
+   : read_region(read_region), max_hashed_length(max_hashed_length), hash_pool(hash_pool), next_serial(0), counters() {
+}
+
+std::shared_ptr<vfm_sector> vfm_content_store::intern(const std::string& path, int64_t offset, int64_t length, sector_creator create) {
+   region_key key = { path, offset, length };
+   std::shared_ptr<vfm_sector> sector;
+   bool share = false;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto existing = regions.find(key);
+      if (existing != regions.end()) {
+         sector = existing->second.sector.lock();
+         if (sector) {
+            counters.regions_shared++;
+            return sector;
+         }
+         forget_region(existing);
+      }
+
+      sector = create();
+      region_entry entry = { sector, next_serial++, false, sha256_digest() };
+      regions.emplace(key, entry);
+
+      // Only regions of exactly this length can hold the same bytes, so a region alone in its
+      // length is never hashed.
+      if (length > 0 && length <= max_hashed_length) {
+         auto& same_length = regions_by_length[length];
+         same_length.erase(std::remove_if(same_length.begin(), same_length.end(), [this](const region_key& other) {
+            auto entry = regions.find(other);
+            if (entry->second.sector.expired()) {
+               if (entry->second.hashed) {
+                  find_by_digest(entry->second.digest);
+               }
+               regions.erase(entry);
+               return true;
+            }
+            return false;
+         }), same_length.end());
+         same_length.push_back(key);
+         share = same_length.size() > 1;
+      }
+   }
+
+   if (share) {
+      if (hash_pool) {
+         auto self = shared_from_this();
+         hash_pool->enqueue([self, length] { self->share_by_content(length); });
+      } else {
+         share_by_content(length);
+      }
+   }
+   return sector;
+}
+
+void vfm_content_store::invalidate(const std::string& path) {
+   std::lock_guard<std::mutex> lock(mutex);
+
+   // Regions elsewhere may have been given a sector over path's bytes on the strength of a
+   // digest that no longer holds; they go too.
+   std::unordered_set<vfm_sector*> stale_sectors;
+   std::unordered_set<sha256_digest, sha256_digest_hash> stale_digests;
+   for (auto& region : regions) {
+      if (region.first.path == path) {
+         if (auto sector = region.second.sector.lock()) {
+            stale_sectors.insert(sector.get());
+         }
+         if (region.second.hashed) {
+            stale_digests.insert(region.second.digest);
+         }
+      }
+   }
+
+   for (auto it = regions.begin(); it != regions.end(); ) {
+      auto sector = it->second.sector.lock();
+      if (it->first.path == path || (sector && stale_sectors.count(sector.get()))) {
+         it = regions.erase(it);
+      } else {
+         ++it;
+      }
+   }
+   for (auto it = regions_by_length.begin(); it != regions_by_length.end(); ) {
+      auto& same_length = it->second;
+      same_length.erase(std::remove_if(same_length.begin(), same_length.end(), [this](const region_key& key) {
+         return regions.find(key) == regions.end();
+      }), same_length.end());
+      it = same_length.empty() ? regions_by_length.erase(it) : std::next(it);
+   }
+   for (auto it = sectors_by_digest.begin(); it != sectors_by_digest.end(); ) {
+      auto sector = it->second.lock();
+      if (!sector || stale_digests.count(it->first) || stale_sectors.count(sector.get())) {
+         it = sectors_by_digest.erase(it);
+      } else {
+         ++it;
+      }
+   }
+}
+
+vfm_content_store_stats vfm_content_store::stats() {
+   std::lock_guard<std::mutex> lock(mutex);
+   return counters;
+}
+
+void vfm_content_store::share_by_content(int64_t length) {
+   // Runs on the hash pool, whose tasks must not throw.
+   try {
+      std::vector<std::pair<region_key, uint64_t>> unhashed;
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         auto same_length = regions_by_length.find(length);
+         if (same_length == regions_by_length.end()) {
+            return;
+         }
+         for (auto& key : same_length->second) {
+            auto& entry = regions.find(key)->second;
+            if (!entry.hashed && !entry.sector.expired()) {
+               unhashed.emplace_back(key, entry.serial);
+            }
+         }
+      }
+
+      // Hashing reads whole regions, so it runs outside the lock.
+      for (auto& candidate : unhashed) {
+         sha256_digest digest;
+         if (!hash_region(candidate.first, digest)) {
+            continue;
+         }
+         std::lock_guard<std::mutex> lock(mutex);
+         // The region may have been hashed by another task, or invalidated and interned afresh
+         // over different bytes, while we were reading it.
+         auto entry = regions.find(candidate.first);
+         if (entry == regions.end() || entry->second.serial != candidate.second || entry->second.hashed) {
+            continue;
+         }
+         auto sector = entry->second.sector.lock();
+         if (!sector) {
+            forget_region(entry);
+            continue;
+         }
+         entry->second.hashed = true;
+         entry->second.digest = digest;
+         auto canonical = find_by_digest(digest);
+         if (!canonical) {
+            sectors_by_digest[digest] = sector;
+         } else if (canonical != sector) {
+            entry->second.sector = canonical;
+            counters.contents_shared++;
+         }
+      }
+   } catch (std::exception& e) {
+      std::cout << "vfm_content_store: content sharing of " << length << "-byte regions failed: " << e.what() << std::endl;
+   }
+}
+
+bool vfm_content_store::hash_region(const region_key& key, sha256_digest& digest) {
+   const int64_t kChunkSize = 64 * 1024;
+   std::vector<uint8_t> chunk(static_cast<size_t>(std::min(kChunkSize, key.length)));
+   sha256 hash;
+   for (int64_t position = 0; position < key.length; ) {
+      auto chunk_length = std::min(kChunkSize, key.length - position);
+      if (read_region(key.path, key.offset + position, chunk_length, chunk.data()) != chunk_length) {
+         return false;
+      }
+      hash.update(chunk.data(), static_cast<size_t>(chunk_length));
+      position += chunk_length;
+   }
+   digest = hash.finish();
+
+   std::lock_guard<std::mutex> lock(mutex);
+   counters.regions_hashed++;
+   counters.bytes_hashed += key.length;
+   return true;
+}
+
+std::shared_ptr<vfm_sector> vfm_content_store::find_by_digest(const sha256_digest& digest) {
+   auto match = sectors_by_digest.find(digest);
+   if (match == sectors_by_digest.end()) {
+      return nullptr;
+   }
+   auto sector = match->second.lock();
+   if (!sector) {
+      sectors_by_digest.erase(match);
+   }
+   return sector;
+}
+
+void vfm_content_store::forget_region(region_map::iterator entry) {
+   auto by_length = regions_by_length.find(entry->first.length);
+   if (by_length != regions_by_length.end()) {
+      auto& same_length = by_length->second;
+      same_length.erase(std::remove(same_length.begin(), same_length.end(), entry->first), same_length.end());
+      if (same_length.empty()) {
+         regions_by_length.erase(by_length);
+      }
+   }
+   if (entry->second.hashed) {
+      find_by_digest(entry->second.digest);   // drops the digest too if its sector has expired
+   }
+   regions.erase(entry);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "hash_mix.hpp"
+#include "noncopyable.hpp"
+#include "sha256.hpp"
+#include "thread_pool.hpp"
+
+namespace dargon {
+   class vfm_sector;
+
+   struct vfm_content_store_stats {
+      uint64_t regions_shared;         // interned regions that reused a sector over the same region
+      uint64_t contents_shared;        // regions pointed at a sector over identical bytes elsewhere
+      uint64_t regions_hashed;
+      int64_t bytes_hashed;
+   };
+
+   /// <summary>
+   /// Resolves backing-file regions to shared sector instances.  A region already interned by
+   /// any vfm gets the same sector back.  Beyond that, regions whose bytes are identical (the
+   /// same object shipped by two mods, say) come to share one sector, so their blocks are cached
+   /// once and one file handle serves both.  Content is compared by SHA-256, and a region is only
+   /// hashed once another live region of exactly the same length exists, so unique objects are
+   /// never read.  Hashing runs on hash_pool, off the open and read paths that intern regions: a
+   /// region's first intern gets a sector of its own, and once its bytes are found to match
+   /// another live region's, later interns of it get that region's sector.  Regions longer than
+   /// max_hashed_length are shared by identity only.  The store holds its sectors weakly; they
+   /// live as long as some vfm uses them, and entries whose sectors have expired are pruned as
+   /// lookups come across them.
+   /// </summary>
+   class vfm_content_store : public std::enable_shared_from_this<vfm_content_store>, dargon::noncopyable {
+   public:
+      // Reads length bytes at offset of the file at path into buffer, returning the count read.
+      typedef std::function<int64_t(const std::string& path, int64_t offset, int64_t length, uint8_t* buffer)> region_reader;
+      typedef std::function<std::shared_ptr<vfm_sector>()> sector_creator;
+
+   private:
+      struct region_key {
+         std::string path;
+         int64_t offset;
+         int64_t length;
+
+         bool operator==(const region_key& other) const { return offset == other.offset && length == other.length && path == other.path; }
+      };
+
+      struct region_key_hash {
+         size_t operator()(const region_key& key) const {
+            return std::hash<std::string>()(key.path) ^ hash_mix(static_cast<uint64_t>(key.offset)) ^ static_cast<size_t>(key.length);
+         }
+      };
+
+      struct region_entry {
+         std::weak_ptr<vfm_sector> sector;
+         uint64_t serial;                 // tells a re-interned region from the one a hash was started for
+         bool hashed;
+         sha256_digest digest;
+      };
+
+      typedef std::unordered_map<region_key, region_entry, region_key_hash> region_map;
+
+      region_reader read_region;
+      int64_t max_hashed_length;
+      std::shared_ptr<thread_pool> hash_pool;
+
+      std::mutex mutex;
+      region_map regions;
+      std::unordered_map<int64_t, std::vector<region_key>> regions_by_length;
+      std::unordered_map<sha256_digest, std::weak_ptr<vfm_sector>, sha256_digest_hash> sectors_by_digest;
+      uint64_t next_serial;
+      vfm_content_store_stats counters;
+
+   public:
+      static const int64_t kDefaultMaxHashedLength = 4 * 1024 * 1024;
+
+      // Must be owned by a shared_ptr. Without a hash_pool, hashing runs inline at the end of
+      // intern, which suits tests and tools but not the game's threads.
+      vfm_content_store(region_reader read_region, int64_t max_hashed_length = kDefaultMaxHashedLength, std::shared_ptr<thread_pool> hash_pool = nullptr);
+
+      // Returns the shared sector for [offset, offset + length) of path, invoking create for a
+      // new one only if no live sector is known to cover that region or identical bytes
+      // elsewhere. Never reads the region itself.
+      std::shared_ptr<vfm_sector> intern(const std::string& path, int64_t offset, int64_t length, sector_creator create);
+
+      // Forgets every region of path, and every region sharing a sector with one, so they're
+      // interned and hashed afresh. Sectors already handed out are left as they are.
+      void invalidate(const std::string& path);
+
+      vfm_content_store_stats stats();
+
+   private:
+      // Hashes every unhashed region of key's length and points regions with matching bytes at
+      // one sector.
+      void share_by_content(int64_t length);
+      bool hash_region(const region_key& key, sha256_digest& digest);
+      std::shared_ptr<vfm_sector> find_by_digest(const sha256_digest& digest);
+      void forget_region(region_map::iterator entry);
+   };
+}
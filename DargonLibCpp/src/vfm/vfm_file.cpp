@@ -1,13 +1,21 @@
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
 
+#include "countdown_event.hpp"
 #include "vfm_file.hpp"
 #include "vfm_sector.hpp"
 
 using namespace dargon;
 
+vfm_file::vfm_file() : min_parallel_read_length(kDefaultMinParallelReadLength) {}
+
 void vfm_file::assign_sector(vfm_sector_range sector_range, std::shared_ptr<vfm_sector> sector) { 
    sectors.push_back(std::make_pair(sector_range, sector));
+   index.reset();
 }
 
 vfm_file::sector_collection::iterator vfm_file::sectors_begin() { 
@@ -18,54 +26,333 @@ vfm_file::sector_collection::iterator vfm_file::sectors_end() {
    return sectors.end(); 
 }
 
+void vfm_file::build_index() {
+   vfm_sector_index::entry_collection entries;
+   entries.reserve(sectors.size());
+   for (auto& pair : sectors) {
+      entries.emplace_back(pair.first, pair.second.get());
+   }
+   index = std::make_unique<vfm_sector_index>(std::move(entries));
+}
+
+void vfm_file::assign_index(vfm_sector_index::entry_collection entries, std::vector<std::shared_ptr<const void>> owners) {
+   sectors.clear();
+   table.reset();
+   index = std::make_unique<vfm_sector_index>(std::move(entries));
+   index_owners = std::move(owners);
+}
+
+vfm_sector_index::entry_collection vfm_file::entries() {
+   vfm_sector_index::entry_collection result;
+   if (table) {
+      result.reserve(table->sector_count());
+      for (uint32_t i = 0; i < table->sector_count(); i++) {
+         auto& entry = table->sector(i);
+         result.emplace_back(vfm_sector_range(entry.start_inclusive, entry.end_exclusive), resolve_table_sector(i));
+      }
+   } else if (index) {
+      result.assign(index->begin(), index->end());
+   }
+   return result;
+}
+
+void vfm_file::assign_table(std::shared_ptr<const void> owner, const vfm_v2_view& view, table_sector_resolver resolver) {
+   sectors.clear();
+   index.reset();
+   index_owners.clear();
+   table_owner = std::move(owner);
+   table = std::make_unique<vfm_v2_view>(view);
+   table_resolver = std::move(resolver);
+   table_sectors.reset(new std::atomic<vfm_sector*>[view.sector_count()]());
+   table_sector_owners.clear();
+}
+
+vfm_sector* vfm_file::resolve_table_sector(uint32_t sector_index) {
+   auto sector = table_sectors[sector_index].load(std::memory_order_acquire);
+   if (sector != nullptr) {
+      return sector;
+   }
+
+   std::lock_guard<std::mutex> lock(table_sectors_mutex);
+   sector = table_sectors[sector_index].load(std::memory_order_relaxed);
+   if (sector == nullptr) {
+      auto created = table_resolver(*table, sector_index);
+      if (created) {
+         sector = created.get();
+         table_sector_owners.push_back(std::move(created));
+         table_sectors[sector_index].store(sector, std::memory_order_release);
+      }
+   }
+   return sector;
+}
+
+void vfm_file::set_parallel_reads(std::shared_ptr<thread_pool> pool, int64_t min_length) {
+   parallel_read_pool = pool;
+   min_parallel_read_length = min_length;
+}
+
 int64_t vfm_file::read(int64_t offset, int64_t length, uint8_t * buffer, int64_t buffer_offset) {
    if (buffer_offset != 0) {
       return this->read(offset, length, buffer + buffer_offset, 0);
    }
    auto bytesRead = std::min(size() - offset, length);
+   if (bytesRead <= 0) {
+      return 0;
+   }
 //   std::cout << "I am size " << std::dec << size() << " and we are reading offset " << offset << " length " << length << " yielding br " << bytesRead << std::endl;
-   ZeroMemory(buffer, bytesRead);
 
-   auto sectors_to_read = get_sectors_for_range(vfm_sector_range(offset, offset + bytesRead));
-   if (sectors_to_read->size() >= 2) {
-//      __debugbreak();
-   }
+   // Sectors write every byte they cover, so only the gaps between them need zeroing.
+   auto read_end = offset + bytesRead;
+   int64_t covered_end = offset;
+   auto zero_gap_before = [offset, buffer, &covered_end](const vfm_sector_range& range) {
+      if (range.start_inclusive > covered_end) {
+         memset(buffer + (covered_end - offset), 0, static_cast<size_t>(range.start_inclusive - covered_end));
+      }
+      covered_end = std::max(covered_end, range.end_exclusive);
+   };
+
+   auto read_one = [offset, bytesRead, buffer](const vfm_sector_index_entry& entry) { read_sector(entry, offset, bytesRead, buffer); };
+   if (parallel_read_pool && bytesRead >= min_parallel_read_length && !thread_pool::is_worker_thread()) {
+      std::vector<vfm_sector_index_entry> spanned;
+      for_each_sector(offset, read_end, [&spanned, &zero_gap_before](const vfm_sector_index_entry& entry) {
+         zero_gap_before(entry.range);
+         spanned.push_back(entry);
+      });
+
+      // Hand all but the first sector to the pool and read that one here while they run.
+      if (spanned.size() > 1) {
+         countdown_event remaining(static_cast<UINT32>(spanned.size() - 1));
+         std::mutex error_mutex;
+         std::exception_ptr error;
 
-   for (auto i = 0; i < sectors_to_read->size(); i++) {
-      auto sector_range = sectors_to_read->at(i).first;
-      auto sector = sectors_to_read->at(i).second;
+         // Pool tasks reference this frame, so it mustn't unwind until all of them have signalled,
+         // even if the read here throws. They catch what their reads throw so they always signal,
+         // and the first exception is rethrown once they're done.
+         struct wait_on_exit {
+            countdown_event& remaining;
+            ~wait_on_exit() { remaining.wait(); }
+         };
+         {
+            wait_on_exit wait_for_pool = { remaining };
+            for (size_t i = 1; i < spanned.size(); i++) {
+               auto entry = spanned[i];
+               try {
+                  parallel_read_pool->enqueue([read_one, entry, &remaining, &error_mutex, &error] {
+                     try {
+                        read_one(entry);
+                     } catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) {
+                           error = std::current_exception();
+                        }
+                     }
+                     remaining.signal();
+                  });
+               } catch (...) {
+                  // Signal for the tasks that were never enqueued before unwinding.
+                  for (auto unqueued = i; unqueued < spanned.size(); unqueued++) {
+                     remaining.signal();
+                  }
+                  throw;
+               }
+            }
+            read_one(spanned[0]);
+         }
+         if (error) {
+            std::rethrow_exception(error);
+         }
+      } else if (!spanned.empty()) {
+         read_one(spanned[0]);
+      }
+   } else {
+      for_each_sector(offset, read_end, [&read_one, &zero_gap_before](const vfm_sector_index_entry& entry) {
+         zero_gap_before(entry.range);
+         read_one(entry);
+      });
+   }
+   zero_gap_before(vfm_sector_range(read_end, read_end));
+   return bytesRead;
+}
 
-      int64_t sector_read_offset = std::max(0LL, offset - sector_range.start_inclusive);
-      int64_t buffer_write_offset = (sector_range.start_inclusive + sector_read_offset) - offset;
-      int64_t copy_length = std::min(sector_range.size() - sector_read_offset, bytesRead - buffer_write_offset);
+int64_t vfm_file::read_ranges(std::vector<vfm_read_request>& requests, int64_t max_gap) {
+   auto file_size = size();
+   std::vector<vfm_read_request*> sorted;
+   sorted.reserve(requests.size());
+   int64_t total_read = 0;
+   for (auto& request : requests) {
+      request.bytes_read = std::max<int64_t>(0, std::min(file_size - request.offset, request.length));
+      if (request.bytes_read > 0) {
+         sorted.push_back(&request);
+         total_read += request.bytes_read;
+      }
+   }
+   std::sort(sorted.begin(), sorted.end(), [](const vfm_read_request* a, const vfm_read_request* b) { return a->offset < b->offset; });
 
-      assert(buffer_write_offset >= 0);
+   // How far into each request's buffer sector reads have written, for zeroing the gaps.
+   std::vector<int64_t> covered_ends(sorted.size());
+   for (size_t i = 0; i < sorted.size(); i++) {
+      covered_ends[i] = sorted[i]->offset;
+   }
+   auto cover = [&sorted, &covered_ends](size_t i, int64_t start, int64_t end) {
+      auto request = sorted[i];
+      if (start > covered_ends[i]) {
+         memset(request->buffer + (covered_ends[i] - request->offset), 0, static_cast<size_t>(start - covered_ends[i]));
+      }
+      covered_ends[i] = std::max(covered_ends[i], end);
+   };
 
-//      std::cout << "   sector " << i << " has range [" << sector_range.start_inclusive << ", " << sector_range.end_exclusive << ") " << std::endl;
-//      std::cout << "      read offset: " << sector_read_offset << " length " << copy_length << " buffer_offset " << buffer_write_offset << std::endl;
+   struct piece {
+      size_t request;
+      int64_t start;
+      int64_t end;
+   };
+   std::vector<piece> pieces;
+   std::vector<uint8_t> scratch;
 
-      if (copy_length + buffer_write_offset > bytesRead) {
-         std::cout << std::dec << copy_length << " + " << buffer_write_offset << " > " << bytesRead << " =(" << std::endl;
-         __debugbreak();
+   // A run is a maximal sequence of requests each starting within max_gap of the furthest end
+   // before it; sectors are visited once per run.
+   size_t run_begin = 0;
+   while (run_begin < sorted.size()) {
+      auto run_end_offset = sorted[run_begin]->offset + sorted[run_begin]->bytes_read;
+      auto run_end = run_begin + 1;
+      while (run_end < sorted.size() && sorted[run_end]->offset - run_end_offset <= max_gap) {
+         run_end_offset = std::max(run_end_offset, sorted[run_end]->offset + sorted[run_end]->bytes_read);
+         run_end++;
       }
 
-      sector->read(sector_read_offset, copy_length, buffer, buffer_write_offset);
+      auto first_live = run_begin;
+      for_each_sector(sorted[run_begin]->offset, run_end_offset, [&](const vfm_sector_index_entry& entry) {
+         auto& range = entry.range;
+         while (first_live < run_end && sorted[first_live]->offset + sorted[first_live]->bytes_read <= range.start_inclusive) {
+            first_live++;
+         }
+
+         // Pieces come out ordered by start, as requests are and every start is clamped to the sector's.
+         pieces.clear();
+         for (auto i = first_live; i < run_end && sorted[i]->offset < range.end_exclusive; i++) {
+            auto start = std::max(sorted[i]->offset, range.start_inclusive);
+            auto end = std::min(sorted[i]->offset + sorted[i]->bytes_read, range.end_exclusive);
+            if (start < end) {
+               cover(i, start, end);
+               pieces.push_back(piece { i, start, end });
+            }
+         }
+
+         for (size_t group_begin = 0; group_begin < pieces.size(); ) {
+            auto group_start = pieces[group_begin].start;
+            auto group_end = pieces[group_begin].end;
+            auto group_end_index = group_begin + 1;
+            while (group_end_index < pieces.size() && pieces[group_end_index].start - group_end <= max_gap) {
+               group_end = std::max(group_end, pieces[group_end_index].end);
+               group_end_index++;
+            }
+
+            auto sector_offset = entry.sector_offset + (group_start - range.start_inclusive);
+            if (group_end_index - group_begin == 1) {
+               auto& only = pieces[group_begin];
+               auto destination = sorted[only.request]->buffer + (only.start - sorted[only.request]->offset);
+               if (entry.sector != nullptr) {
+                  entry.sector->read(sector_offset, only.end - only.start, destination, 0);
+               } else {
+                  memset(destination, 0, static_cast<size_t>(only.end - only.start));
+               }
+            } else {
+               scratch.resize(static_cast<size_t>(group_end - group_start));
+               if (entry.sector != nullptr) {
+                  entry.sector->read(sector_offset, group_end - group_start, scratch.data(), 0);
+               } else {
+                  memset(scratch.data(), 0, scratch.size());
+               }
+               for (auto i = group_begin; i < group_end_index; i++) {
+                  auto& part = pieces[i];
+                  auto destination = sorted[part.request]->buffer + (part.start - sorted[part.request]->offset);
+                  memcpy(destination, scratch.data() + (part.start - group_start), static_cast<size_t>(part.end - part.start));
+               }
+            }
+            group_begin = group_end_index;
+         }
+      });
+      run_begin = run_end;
    }
-   return bytesRead;
+
+   for (size_t i = 0; i < sorted.size(); i++) {
+      auto end = sorted[i]->offset + sorted[i]->bytes_read;
+      cover(i, end, end);
+   }
+   return total_read;
 }
 
-int64_t vfm_file::size() {
-   return sectors[sectors.size() - 1].first.end_exclusive;
+void vfm_file::read_sector(const vfm_sector_index_entry& entry, int64_t offset, int64_t length, uint8_t* buffer) {
+   auto& sector_range = entry.range;
+
+   int64_t sector_read_offset = std::max<int64_t>(0, offset - sector_range.start_inclusive);
+   int64_t buffer_write_offset = (sector_range.start_inclusive + sector_read_offset) - offset;
+   int64_t copy_length = std::min(sector_range.size() - sector_read_offset, length - buffer_write_offset);
+
+   assert(buffer_write_offset >= 0);
+
+//   std::cout << "   sector has range [" << sector_range.start_inclusive << ", " << sector_range.end_exclusive << ") " << std::endl;
+//   std::cout << "      read offset: " << sector_read_offset << " length " << copy_length << " buffer_offset " << buffer_write_offset << std::endl;
+
+   if (copy_length + buffer_write_offset > length) {
+      std::cout << std::dec << copy_length << " + " << buffer_write_offset << " > " << length << " =(" << std::endl;
+#ifdef _WIN32
+      __debugbreak();
+#else
+      abort();
+#endif
+   }
+
+   if (entry.sector != nullptr) {
+      entry.sector->read(entry.sector_offset + sector_read_offset, copy_length, buffer, buffer_write_offset);
+   } else {
+      memset(buffer + buffer_write_offset, 0, static_cast<size_t>(copy_length));
+   }
+}
+
+void vfm_file::read_async(thread_pool& pool, int64_t offset, int64_t length, uint8_t* buffer, read_completion_callback on_complete) {
+   auto self = shared_from_this();
+   pool.enqueue([self, offset, length, buffer, on_complete] {
+      // Pool tasks must not throw, so a failed read is handed to on_complete instead.
+      int64_t bytes_read = 0;
+      std::exception_ptr error;
+      try {
+         bytes_read = self->read(offset, length, buffer, 0);
+      } catch (...) {
+         error = std::current_exception();
+      }
+      on_complete(bytes_read, error);
+   });
 }
 
-std::unique_ptr<std::vector<std::pair<vfm_sector_range, std::shared_ptr<vfm_sector>>>> vfm_file::get_sectors_for_range(const vfm_sector_range& test_range) {
-   auto collection = std::make_unique<std::vector<std::pair<vfm_sector_range, std::shared_ptr<vfm_sector>>>>();
-   for (auto it = sectors.begin(); it != sectors.end(); it++) {
-      auto sector_range = it->first;
-      auto sector = it->second;
-      if (test_range.intersects(sector_range)) {
-         collection->emplace_back(*it);
+std::future<int64_t> vfm_file::read_async(thread_pool& pool, int64_t offset, int64_t length, uint8_t* buffer) {
+   auto promise = std::make_shared<std::promise<int64_t>>();
+   auto result = promise->get_future();
+   read_async(pool, offset, length, buffer, [promise](int64_t bytes_read, std::exception_ptr error) {
+      if (error) {
+         promise->set_exception(error);
+      } else {
+         promise->set_value(bytes_read);
       }
+   });
+   return result;
+}
+
+int64_t vfm_file::size() {
+   if (table) {
+      return table->extent();
    }
-   return collection;
+   return index ? index->extent() : 0;
+}
+
+const uint8_t* vfm_file::borrow(int64_t offset, int64_t length) {
+   const uint8_t* result = nullptr;
+   bool first = true;
+   for_each_sector(offset, offset + std::max<int64_t>(length, 1), [&](const vfm_sector_index_entry& entry) {
+      if (first && entry.sector != nullptr && entry.range.fully_contains(vfm_sector_range(offset, offset + length))) {
+         result = entry.sector->borrow(entry.sector_offset + offset - entry.range.start_inclusive, length);
+      }
+      first = false;
+   });
+   return result;
 }
@@ -1,28 +1,129 @@
 #pragma once
 
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <vector>
 
 #include "base.hpp"
 #include "binary_reader.hpp"
+#include "thread_pool.hpp"
 
+#include "vfm_format_v2.hpp"
 #include "vfm_sector.hpp"
+#include "vfm_sector_index.hpp"
 
 namespace dargon {
-   class vfm_file : dargon::noncopyable {
+   // One destination of vfm_file::read_ranges.
+   struct vfm_read_request {
+      int64_t offset;
+      int64_t length;
+      uint8_t* buffer;
+      int64_t bytes_read;     // set by read_ranges
+   };
+
+   class vfm_file : public std::enable_shared_from_this<vfm_file>, dargon::noncopyable {
+   public:
+      typedef std::function<void(int64_t bytes_read, std::exception_ptr error)> read_completion_callback;
+      typedef std::function<std::shared_ptr<vfm_sector>(const vfm_v2_view& table, uint32_t sector_index)> table_sector_resolver;
+
+   private:
       typedef std::vector<std::pair<vfm_sector_range, std::shared_ptr<vfm_sector>>> sector_collection;
 
       sector_collection sectors;
+      std::unique_ptr<vfm_sector_index> index;
+      std::vector<std::shared_ptr<const void>> index_owners;
+      std::shared_ptr<thread_pool> parallel_read_pool;
+      int64_t min_parallel_read_length;
+
+      // Set instead of sectors/index for files backed by a v2 table used in place.
+      std::shared_ptr<const void> table_owner;
+      std::unique_ptr<vfm_v2_view> table;
+      table_sector_resolver table_resolver;
+      std::unique_ptr<std::atomic<vfm_sector*>[]> table_sectors;
+      std::mutex table_sectors_mutex;
+      std::vector<std::shared_ptr<vfm_sector>> table_sector_owners;
       
    public:
+
+      static const int64_t kDefaultMinParallelReadLength = 256 * 1024;
+      static const int64_t kDefaultMaxReadRangesGap = 16 * 1024;
+
+      vfm_file();
+
       void assign_sector(vfm_sector_range sector_range, std::shared_ptr<vfm_sector> sector);
       sector_collection::iterator sectors_begin();
       sector_collection::iterator sectors_end();
 
+      // Builds the read index over the assigned sectors. Must be invoked after the last
+      // assign_sector and before the file is shared with readers; vfm_reader does so on load.
+      // Until then the file reads as empty.
+      void build_index();
+
+      // Serves reads from prebuilt entries, e.g. a composition of other files' sectors, in place of
+      // assigned sectors. owners must keep every entry's sector alive.
+      void assign_index(vfm_sector_index::entry_collection entries, std::vector<std::shared_ptr<const void>> owners);
+
+      // Returns every sector entry in order. Table sectors not yet created are created.
+      vfm_sector_index::entry_collection entries();
+
+      // Serves reads from a v2 sector table in place of assigned sectors. The sector object for a
+      // table entry is created by resolver the first time a read touches it; a null result leaves
+      // that range reading as zeroes. owner must keep the table's memory alive.
+      void assign_table(std::shared_ptr<const void> owner, const vfm_v2_view& table, table_sector_resolver resolver);
+
+      // Reads of at least min_length bytes that span several sectors then read those sectors
+      // concurrently on pool, returning once the slowest finishes. Reads issued from a pool
+      // worker stay serial so they can't wait on work queued behind them. A null pool disables.
+      void set_parallel_reads(std::shared_ptr<thread_pool> pool, int64_t min_length = kDefaultMinParallelReadLength);
+
       int64_t size();
       int64_t read(int64_t offset, int64_t length, uint8_t* buffer, int64_t buffer_offset);
 
+      // Reads a batch of ranges, e.g. many small entries pulled from one archive. Requests are
+      // sorted and merged so the index is walked once per run of nearby requests, and requests
+      // within max_gap bytes of each other in the same sector are served by one sector read
+      // (the gap is read and discarded), so backing reads drop to about one per such run. Sets
+      // each request's bytes_read to what read would return and returns their sum. Requests may
+      // overlap one another, their buffers may not. Reads are serial.
+      int64_t read_ranges(std::vector<vfm_read_request>& requests, int64_t max_gap = kDefaultMaxReadRangesGap);
+
+      // Queues a read on pool and returns immediately; on_complete is then invoked on the worker
+      // with the number of bytes read, or with the exception the read threw (bytes_read is then
+      // 0), and the future overload rethrows it from get(). buffer must stay valid until then. The file keeps itself
+      // alive while the read is outstanding, so it must be owned by a shared_ptr.
+      void read_async(thread_pool& pool, int64_t offset, int64_t length, uint8_t* buffer, read_completion_callback on_complete);
+      std::future<int64_t> read_async(thread_pool& pool, int64_t offset, int64_t length, uint8_t* buffer);
+
+      // Returns a pointer to length bytes at offset if they lie within a single sector that keeps
+      // its data in memory (see vfm_sector::borrow), otherwise nullptr; callers then fall back to
+      // read. The pointer is valid for as long as the vfm_file is.
+      const uint8_t* borrow(int64_t offset, int64_t length);
+
    private:
-      std::unique_ptr<std::vector<std::pair<vfm_sector_range, std::shared_ptr<vfm_sector>>>> get_sectors_for_range(const vfm_sector_range& range);
+      static void read_sector(const vfm_sector_index_entry& entry, int64_t offset, int64_t length, uint8_t* buffer);
+      vfm_sector* resolve_table_sector(uint32_t sector_index);
+
+      // Invokes visit(entry) for each sector intersecting [offset, end), in order.
+      template <typename TVisit>
+      void for_each_sector(int64_t offset, int64_t end, TVisit&& visit) {
+         if (table) {
+            for (auto i = table->find_first(offset); i < table->sector_count(); i++) {
+               auto& entry = table->sector(i);
+               if (entry.start_inclusive >= end) {
+                  break;
+               }
+               visit(vfm_sector_index_entry(vfm_sector_range(entry.start_inclusive, entry.end_exclusive), resolve_table_sector(i)));
+            }
+         } else if (index) {
+            for (auto it = index->find_first(offset); it != index->end() && it->range.start_inclusive < end; ++it) {
+               visit(*it);
+            }
+         }
+      }
    };
-}
\ No newline at end of file
+}
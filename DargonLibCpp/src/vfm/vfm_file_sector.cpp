@@ -1,4 +1,5 @@
 #include "dlc_pch.hpp"
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include "binary_reader.hpp"
@@ -8,10 +9,18 @@ using namespace dargon;
 
 const dargon::guid vfm_file_sector::kGuid(guid::parse("5DB2B4C239AE4629988ACFFFCE89F230"));
 
-vfm_file_sector::vfm_file_sector(std::shared_ptr<dargon::IO::IoProxy> io_proxy) : io_proxy(io_proxy), offset(0), length(0) {
+vfm_file_sector::vfm_file_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache) 
+   : offset(0), length(0), handle_cache(handle_cache), block_cache(block_cache), file_key(0) {
 
 }
 
+vfm_file_sector::vfm_file_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache, std::string path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length)
+   : path(path), offset(offset), length(length), handle_cache(handle_cache), block_cache(block_cache), file(file), file_key(0) {
+   if (block_cache) {
+      file_key = block_cache->get_file_key(path, file ? file->get_id() : 0);
+   }
+}
+
 int64_t vfm_file_sector::size() {
    return length;
 }
@@ -21,27 +30,28 @@ void vfm_file_sector::read(int64_t read_offset, int64_t read_length, uint8_t * b
       return read(read_offset, read_length, buffer + buffer_offset, 0);
    }
 
-   auto file = io_proxy->CreateFileW(dargon::wide(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   auto read_backing_file = [this](int64_t backing_offset, int64_t backing_length, uint8_t* backing_buffer) -> int64_t {
+      if (!file) {
+         std::cout << "VFM FAILED TO OPEN FILE " << path.c_str() << ":(" << std::endl;
+#ifdef _WIN32
+         MessageBoxA(NULL, ("VFM Failed to open file " + path).c_str(), "", MB_OK);
+#endif
+         return 0;
+      }
+      return file->read(backing_offset, backing_length, backing_buffer);
+   };
 
-   if (file == INVALID_HANDLE_VALUE) {
-      std::cout << "VFM FAILED TO OPEN FILE " << path.c_str() << ":(" << std::endl;
-      MessageBoxA(NULL, ("VFM Failed to open file " + path).c_str(), "", MB_OK);
+   int64_t bytes_read;
+   if (block_cache) {
+      bytes_read = block_cache->read(file_key, offset + read_offset, read_length, buffer, read_backing_file);
+   } else {
+      bytes_read = read_backing_file(offset + read_offset, read_length, buffer);
    }
 
-   LARGE_INTEGER li_read_offset;
-   li_read_offset.QuadPart = read_offset + offset;
-   io_proxy->SetFilePointerEx(file, li_read_offset, nullptr, FILE_BEGIN);
-
-   int64_t bytes_remaining = read_length;
-   int64_t total_bytes_read = 0;
-   while (bytes_remaining > 0) {
-      DWORD bytes_read = 0;
-      io_proxy->ReadFile(file, buffer + total_bytes_read, bytes_remaining, &bytes_read, nullptr);
-      bytes_remaining -= bytes_read;
-      total_bytes_read += bytes_read;
+   // vfm_file leaves sectors' ranges to them, so a short read must still fill its range.
+   if (bytes_read < read_length) {
+      memset(buffer + bytes_read, 0, static_cast<size_t>(read_length - bytes_read));
    }
-
-   io_proxy->CloseHandle(file);
 }
 
 void vfm_file_sector::deserialize(dargon::binary_reader & reader) {
@@ -49,6 +59,11 @@ void vfm_file_sector::deserialize(dargon::binary_reader & reader) {
    
    offset = reader.read_int64();
    length = reader.read_int64();
+
+   file = handle_cache->get(path);
+   if (block_cache) {
+      file_key = block_cache->get_file_key(path, file ? file->get_id() : 0);
+   }
 }
 
 std::string vfm_file_sector::to_string() {
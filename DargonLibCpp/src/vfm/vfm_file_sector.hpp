@@ -2,7 +2,8 @@
 
 #include <memory>
 #include "vfm_sector.hpp"
-#include "io/IoProxy.hpp"
+#include "vfm_block_cache.hpp"
+#include "vfm_handle_cache.hpp"
 
 namespace dargon {
    class vfm_file_sector : public vfm_sector {
@@ -13,10 +14,19 @@ namespace dargon {
       std::string path;
       int64_t offset;
       int64_t length;
-      std::shared_ptr<dargon::IO::IoProxy> io_proxy;
+      std::shared_ptr<vfm_handle_cache> handle_cache;
+      std::shared_ptr<vfm_block_cache> block_cache;
+      std::shared_ptr<vfm_backing_file> file;
+      uint64_t file_key;
 
    public:
-      vfm_file_sector(std::shared_ptr<dargon::IO::IoProxy> io_proxy);
+      // Sectors read the backing file they're given (or, when deserialized, the one the handle
+      // cache has open then) for their whole lifetime, never whatever is at path later.
+      vfm_file_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache);
+      vfm_file_sector(std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache, std::string path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length);
+
+      const std::string& backing_path() const { return path; }
+      int64_t backing_offset() const { return offset; }
 
       virtual int64_t size() override;
       virtual void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override;
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dargon {
+   // "VFM2". v1 files begin with vfm_sector_collection_magic ("VFMS") instead.
+   const uint32_t vfm_v2_magic = 0x324D4656U;
+   const uint32_t vfm_v2_version = 2;
+   const uint32_t vfm_v2_no_path = 0xFFFFFFFFU;
+
+   // On-disk structures. Every field is little-endian and naturally aligned, so a mapped file can
+   // be read through these types directly. Offsets are from the start of the file.
+   struct vfm_v2_header {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t header_size;
+      uint32_t sector_count;
+      int64_t extent;
+      uint64_t sector_table_offset;
+      uint64_t path_table_offset;
+      uint32_t path_count;
+      uint32_t fence_shift;            // 0 if the file has no lookup index
+      uint64_t fence_table_offset;
+      uint32_t fence_count;
+      uint32_t reserved;
+      uint64_t string_data_offset;
+      uint64_t string_data_length;
+      uint64_t payload_offset;         // type-specific sector data, addressed by source_offset
+      uint64_t payload_length;
+   };
+   static_assert(sizeof(vfm_v2_header) == 96, "vfm_v2_header layout changed");
+
+   // Sorted by start_inclusive; ranges never overlap.
+   struct vfm_v2_sector_entry {
+      uint8_t type[16];
+      int64_t start_inclusive;
+      int64_t end_exclusive;
+      int64_t source_offset;           // offset in the backing file, or in the payload section
+      uint32_t path_index;             // vfm_v2_no_path for sectors without a backing file
+      uint32_t flags;
+   };
+   static_assert(sizeof(vfm_v2_sector_entry) == 48, "vfm_v2_sector_entry layout changed");
+
+   struct vfm_v2_path_entry {
+      uint64_t offset;                 // into the string data section; not null-terminated
+      uint32_t length;
+      uint32_t reserved;
+   };
+   static_assert(sizeof(vfm_v2_path_entry) == 16, "vfm_v2_path_entry layout changed");
+
+   /// <summary>
+   /// Read-only view over a v2 vfm image held in memory, typically a mapped file.  Construction
+   /// bounds-checks the header and tables and checks the lookup index is in order, but touches
+   /// no sector entries.  The lookup index, when present, stores for every
+   /// 2^fence_shift bytes of the virtual file the first sector ending past that point; a lookup
+   /// then binary-searches only the handful of entries between two fences.  The view does not own
+   /// the memory it reads.
+   /// </summary>
+   class vfm_v2_view {
+      const uint8_t* data;
+      size_t length;
+      const vfm_v2_header* header;
+      const vfm_v2_sector_entry* sectors;
+      const vfm_v2_path_entry* paths;
+      const uint32_t* fences;
+
+   public:
+      static bool is_v2(const uint8_t* data, size_t length) {
+         uint32_t magic = 0;
+         if (length >= sizeof(magic)) {
+            memcpy(&magic, data, sizeof(magic));
+         }
+         return magic == vfm_v2_magic;
+      }
+
+      vfm_v2_view(const uint8_t* data, size_t length) : data(data), length(length), fences(nullptr) {
+         if (length < sizeof(vfm_v2_header) || !is_v2(data, length)) {
+            throw std::runtime_error("not a v2 vfm image");
+         }
+         header = reinterpret_cast<const vfm_v2_header*>(data);
+         if (header->version != vfm_v2_version || header->header_size < sizeof(vfm_v2_header)) {
+            throw std::runtime_error("unsupported v2 vfm version");
+         }
+         sectors = table<vfm_v2_sector_entry>(header->sector_table_offset, header->sector_count);
+         paths = table<vfm_v2_path_entry>(header->path_table_offset, header->path_count);
+         if (header->fence_shift != 0) {
+            fences = table<uint32_t>(header->fence_table_offset, header->fence_count);
+            check_fences();
+         }
+         check_range(header->string_data_offset, header->string_data_length);
+         check_range(header->payload_offset, header->payload_length);
+      }
+
+      uint32_t sector_count() const { return header->sector_count; }
+      int64_t extent() const { return header->extent; }
+      const vfm_v2_sector_entry& sector(uint32_t i) const { return sectors[i]; }
+      uint32_t path_count() const { return header->path_count; }
+
+      // Returns the backing path of path table entry i.
+      std::string path(uint32_t i) const {
+         if (i >= header->path_count) {
+            throw std::runtime_error("v2 vfm path index out of range");
+         }
+         auto& entry = paths[i];
+         if (entry.length > header->string_data_length || entry.offset > header->string_data_length - entry.length) {
+            throw std::runtime_error("v2 vfm path out of range");
+         }
+         return std::string(reinterpret_cast<const char*>(data + header->string_data_offset + entry.offset), entry.length);
+      }
+
+      // Returns the payload bytes [offset, offset + length), or nullptr if out of range.
+      const uint8_t* payload(int64_t offset, int64_t length) const {
+         if (offset < 0 || length < 0 || static_cast<uint64_t>(offset) > header->payload_length ||
+             static_cast<uint64_t>(length) > header->payload_length - static_cast<uint64_t>(offset)) {
+            return nullptr;
+         }
+         return data + header->payload_offset + offset;
+      }
+
+      // Returns the index of the first sector ending after offset, or sector_count() if none does.
+      uint32_t find_first(int64_t offset) const {
+         uint32_t lo = 0;
+         uint32_t hi = header->sector_count;
+         if (fences != nullptr && offset >= 0) {
+            auto bucket = static_cast<uint64_t>(offset) >> header->fence_shift;
+            if (bucket >= header->fence_count) {
+               return header->sector_count;
+            }
+            lo = std::min(fences[bucket], hi);
+            if (bucket + 1 < header->fence_count) {
+               hi = static_cast<uint32_t>(std::min<uint64_t>(fences[bucket + 1] + 1ULL, hi));
+            }
+         }
+         auto match = std::partition_point(sectors + lo, sectors + hi, [offset](const vfm_v2_sector_entry& entry) {
+            return entry.end_exclusive <= offset;
+         });
+         return static_cast<uint32_t>(match - sectors);
+      }
+
+   private:
+      // find_first trusts the fences to cover the extent and to never point backwards.
+      void check_fences() const {
+         if (header->fence_shift >= 64 || header->extent < 0 ||
+             header->fence_count != (static_cast<uint64_t>(header->extent) >> header->fence_shift) + 1) {
+            throw std::runtime_error("v2 vfm lookup index doesn't match extent");
+         }
+         for (uint32_t i = 0; i < header->fence_count; i++) {
+            if (fences[i] > header->sector_count || (i > 0 && fences[i] < fences[i - 1])) {
+               throw std::runtime_error("v2 vfm lookup index out of order");
+            }
+         }
+      }
+
+      void check_range(uint64_t offset, uint64_t range_length) const {
+         if (offset > length || range_length > length - offset) {
+            throw std::runtime_error("v2 vfm table out of range");
+         }
+      }
+
+      template <typename T>
+      const T* table(uint64_t offset, uint64_t count) const {
+         check_range(offset, count * sizeof(T));
+         if (offset % alignof(T) != 0) {
+            throw std::runtime_error("v2 vfm table misaligned");
+         }
+         return reinterpret_cast<const T*>(data + offset);
+      }
+   };
+
+   /// <summary>
+   /// Builds a v2 vfm image from a list of sectors.  Paths are deduplicated, sectors are sorted,
+   /// and a lookup index is added with roughly one fence per sector.
+   /// </summary>
+   class vfm_v2_builder {
+   public:
+      struct sector_description {
+         uint8_t type[16];
+         int64_t start_inclusive;
+         int64_t end_exclusive;
+         std::string path;                // empty for sectors without a backing file
+         int64_t source_offset;
+         uint32_t flags;
+      };
+
+   private:
+      std::vector<sector_description> sectors;
+      std::vector<uint8_t> payload;
+
+   public:
+      void add_sector(sector_description sector) { sectors.push_back(std::move(sector)); }
+
+      // Appends bytes to the payload section and returns their offset, for use as source_offset.
+      int64_t add_payload(const uint8_t* bytes, size_t count) {
+         auto offset = static_cast<int64_t>(payload.size());
+         payload.insert(payload.end(), bytes, bytes + count);
+         return offset;
+      }
+
+      std::vector<uint8_t> build(bool include_lookup_index = true) const {
+         auto sorted = sectors;
+         std::stable_sort(sorted.begin(), sorted.end(), [](const sector_description& a, const sector_description& b) {
+            return a.start_inclusive < b.start_inclusive;
+         });
+         int64_t extent = 0;
+         for (size_t i = 0; i < sorted.size(); i++) {
+            if (i > 0 && sorted[i].start_inclusive < sorted[i - 1].end_exclusive) {
+               throw std::runtime_error("vfm sectors overlap");
+            }
+            extent = std::max(extent, sorted[i].end_exclusive);
+         }
+
+         std::vector<vfm_v2_path_entry> path_entries;
+         std::string string_data;
+         std::unordered_map<std::string, uint32_t> path_indices;
+         std::vector<vfm_v2_sector_entry> entries(sorted.size());
+         for (size_t i = 0; i < sorted.size(); i++) {
+            auto& source = sorted[i];
+            auto& entry = entries[i];
+            memcpy(entry.type, source.type, sizeof(entry.type));
+            entry.start_inclusive = source.start_inclusive;
+            entry.end_exclusive = source.end_exclusive;
+            entry.source_offset = source.source_offset;
+            entry.flags = source.flags;
+            entry.path_index = vfm_v2_no_path;
+            if (!source.path.empty()) {
+               auto match = path_indices.find(source.path);
+               if (match == path_indices.end()) {
+                  vfm_v2_path_entry path_entry = { string_data.size(), static_cast<uint32_t>(source.path.size()), 0 };
+                  match = path_indices.emplace(source.path, static_cast<uint32_t>(path_entries.size())).first;
+                  path_entries.push_back(path_entry);
+                  string_data += source.path;
+               }
+               entry.path_index = match->second;
+            }
+         }
+
+         std::vector<uint32_t> fences;
+         uint32_t fence_shift = 0;
+         if (include_lookup_index && !entries.empty() && extent > 0) {
+            fence_shift = 12;
+            while ((extent >> fence_shift) > static_cast<int64_t>(entries.size()) && fence_shift < 62) {
+               fence_shift++;
+            }
+            auto fence_count = static_cast<size_t>(extent >> fence_shift) + 1;
+            fences.resize(fence_count);
+            size_t next = 0;
+            for (size_t bucket = 0; bucket < fence_count; bucket++) {
+               auto bucket_start = static_cast<int64_t>(bucket) << fence_shift;
+               while (next < entries.size() && entries[next].end_exclusive <= bucket_start) {
+                  next++;
+               }
+               fences[bucket] = static_cast<uint32_t>(next);
+            }
+         }
+
+         auto align = [](uint64_t value) { return (value + 7) & ~static_cast<uint64_t>(7); };
+         vfm_v2_header header = {};
+         header.magic = vfm_v2_magic;
+         header.version = vfm_v2_version;
+         header.header_size = sizeof(vfm_v2_header);
+         header.sector_count = static_cast<uint32_t>(entries.size());
+         header.extent = extent;
+         header.sector_table_offset = align(sizeof(vfm_v2_header));
+         header.path_table_offset = align(header.sector_table_offset + entries.size() * sizeof(vfm_v2_sector_entry));
+         header.path_count = static_cast<uint32_t>(path_entries.size());
+         header.fence_shift = fence_shift;
+         header.fence_table_offset = align(header.path_table_offset + path_entries.size() * sizeof(vfm_v2_path_entry));
+         header.fence_count = static_cast<uint32_t>(fences.size());
+         header.string_data_offset = align(header.fence_table_offset + fences.size() * sizeof(uint32_t));
+         header.string_data_length = string_data.size();
+         header.payload_offset = align(header.string_data_offset + string_data.size());
+         header.payload_length = payload.size();
+
+         std::vector<uint8_t> image(static_cast<size_t>(header.payload_offset + payload.size()));
+         auto write = [&image](uint64_t offset, const void* source, size_t count) {
+            if (count != 0) {
+               memcpy(image.data() + offset, source, count);
+            }
+         };
+         write(0, &header, sizeof(header));
+         write(header.sector_table_offset, entries.data(), entries.size() * sizeof(vfm_v2_sector_entry));
+         write(header.path_table_offset, path_entries.data(), path_entries.size() * sizeof(vfm_v2_path_entry));
+         write(header.fence_table_offset, fences.data(), fences.size() * sizeof(uint32_t));
+         write(header.string_data_offset, string_data.data(), string_data.size());
+         write(header.payload_offset, payload.data(), payload.size());
+         return image;
+      }
+   };
+}
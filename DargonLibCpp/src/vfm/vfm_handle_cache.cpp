@@ -0,0 +1,90 @@
+#include "dlc_pch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "vfm_handle_cache.hpp"
+
+using namespace dargon;
+
+namespace {
+   std::atomic<uint64_t> next_backing_file_id(1);
+}
+
+vfm_backing_file::vfm_backing_file(std::shared_ptr<io_backend> io, io_backend::file_handle handle) : io(io), handle(handle), id(next_backing_file_id++) {}
+
+vfm_backing_file::~vfm_backing_file() {
+   io->close(handle);
+}
+
+int64_t vfm_backing_file::read(int64_t offset, int64_t length, uint8_t* buffer) {
+   return io->read_at(handle, offset, length, buffer);
+}
+
+vfm_handle_cache::vfm_handle_cache(std::shared_ptr<io_backend> io, size_t capacity) : io(io), capacity(std::max<size_t>(capacity, 1)) {}
+
+std::shared_ptr<vfm_backing_file> vfm_handle_cache::get(const std::string& path) {
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto match = entries_by_path.find(path);
+      if (match != entries_by_path.end()) {
+         lru.splice(lru.begin(), lru, match->second);
+         return match->second->second;
+      }
+   }
+
+   // Open outside the lock; a slow open must not stall hits on other paths.
+   auto handle = io->open_read(path);
+   if (handle == io_backend::kInvalidFile) {
+      return nullptr;
+   }
+   auto file = std::make_shared<vfm_backing_file>(io, handle);
+
+   std::unique_lock<std::mutex> lock(mutex);
+   auto match = entries_by_path.find(path);
+   if (match != entries_by_path.end()) {
+      // Another thread opened the same path first; use its handle and let ours close.
+      lru.splice(lru.begin(), lru, match->second);
+      return match->second->second;
+   }
+   lru.emplace_front(path, file);
+   entries_by_path.emplace(path, lru.begin());
+   trim_to_capacity(lock);
+   return file;
+}
+
+void vfm_handle_cache::invalidate(const std::string& path) {
+   // Declared before the lock so the handle closes after it is released.
+   std::shared_ptr<vfm_backing_file> dropped;
+   std::lock_guard<std::mutex> lock(mutex);
+   auto match = entries_by_path.find(path);
+   if (match == entries_by_path.end()) {
+      return;
+   }
+   dropped = std::move(match->second->second);
+   lru.erase(match->second);
+   entries_by_path.erase(match);
+}
+
+void vfm_handle_cache::set_capacity(size_t new_capacity) {
+   std::unique_lock<std::mutex> lock(mutex);
+   capacity = std::max<size_t>(new_capacity, 1);
+   trim_to_capacity(lock);
+}
+
+size_t vfm_handle_cache::size() {
+   std::lock_guard<std::mutex> lock(mutex);
+   return lru.size();
+}
+
+void vfm_handle_cache::trim_to_capacity(std::unique_lock<std::mutex>& lock) {
+   std::vector<std::shared_ptr<vfm_backing_file>> evicted;
+   while (lru.size() > capacity) {
+      entries_by_path.erase(lru.back().first);
+      evicted.emplace_back(std::move(lru.back().second));
+      lru.pop_back();
+   }
+
+   // Handles close as the evicted references are released; do that outside the lock.
+   lock.unlock();
+   evicted.clear();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "noncopyable.hpp"
+#include "io/io_backend.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// An open, read-only handle to a file backing vfm sectors.  Reads are positional (they carry
+   /// their own offset) so any number of threads may share one handle without seeking.  The
+   /// handle is closed when the last reference to it is released.
+   /// </summary>
+   class vfm_backing_file : dargon::noncopyable {
+      std::shared_ptr<io_backend> io;
+      io_backend::file_handle handle;
+      uint64_t id;
+
+   public:
+      vfm_backing_file(std::shared_ptr<io_backend> io, io_backend::file_handle handle);
+      ~vfm_backing_file();
+
+      // Reads up to length bytes at offset into buffer, returning the number of bytes read. Fewer
+      // bytes are returned only at end of file or on error.
+      int64_t read(int64_t offset, int64_t length, uint8_t* buffer);
+
+      io_backend::file_handle get_handle() const { return handle; }
+
+      // Distinct for every backing file opened in the process, however its path was reused.
+      uint64_t get_id() const { return id; }
+   };
+
+   /// <summary>
+   /// Bounded cache of open backing files keyed by path, from which a factory's sectors take their
+   /// files when created.  When more than capacity files are cached the least recently used one
+   /// is dropped from the cache; its handle closes once no sector or in-flight read holds it.
+   /// </summary>
+   class vfm_handle_cache : dargon::noncopyable {
+      typedef std::pair<std::string, std::shared_ptr<vfm_backing_file>> entry_t;
+      typedef std::list<entry_t> lru_list_t;
+
+      std::shared_ptr<io_backend> io;
+      size_t capacity;
+      std::mutex mutex;
+      lru_list_t lru;
+      std::unordered_map<std::string, lru_list_t::iterator> entries_by_path;
+
+   public:
+      static const size_t kDefaultCapacity = 64;
+
+      vfm_handle_cache(std::shared_ptr<io_backend> io, size_t capacity = kDefaultCapacity);
+
+      // Returns an open backing file for path, opening it on a miss. Returns nullptr if the file
+      // could not be opened.
+      std::shared_ptr<vfm_backing_file> get(const std::string& path);
+
+      // Drops the cached handle for path, if any, so the next get reopens the file. The old
+      // handle closes once no sector or in-flight read holds it.
+      void invalidate(const std::string& path);
+
+      void set_capacity(size_t capacity);
+      size_t size();
+
+   private:
+      void trim_to_capacity(std::unique_lock<std::mutex>& lock);
+   };
+}
@@ -0,0 +1,62 @@
+#include "dlc_pch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "binary_reader.hpp"
+#include "vfm_inline_sector.hpp"
+
+using namespace dargon;
+
+const dargon::guid vfm_inline_sector::kGuid(guid::parse("649232BFD1614CB5AA1287C8083BA598"));
+
+vfm_inline_sector::vfm_inline_sector() : data(nullptr), length(0) {
+}
+
+vfm_inline_sector::vfm_inline_sector(std::vector<uint8_t> bytes) : bytes(std::move(bytes)) {
+   data = this->bytes.data();
+   length = static_cast<int64_t>(this->bytes.size());
+}
+
+vfm_inline_sector::vfm_inline_sector(std::shared_ptr<const void> owner, const uint8_t* data, int64_t length)
+   : owner(owner), data(data), length(length) {
+}
+
+int64_t vfm_inline_sector::size() {
+   return length;
+}
+
+void vfm_inline_sector::read(int64_t read_offset, int64_t read_length, uint8_t * buffer, int32_t buffer_offset) {
+   int64_t available = 0;
+   if (read_offset >= 0 && read_offset < length) {
+      available = std::min(read_length, length - read_offset);
+      memcpy(buffer + buffer_offset, data + read_offset, static_cast<size_t>(available));
+   }
+   if (available < read_length) {
+      memset(buffer + buffer_offset + available, 0, static_cast<size_t>(read_length - available));
+   }
+}
+
+const uint8_t* vfm_inline_sector::borrow(int64_t read_offset, int64_t read_length) {
+   if (read_offset < 0 || read_offset + read_length > length) {
+      return nullptr;
+   }
+   return data + read_offset;
+}
+
+void vfm_inline_sector::deserialize(dargon::binary_reader & reader) {
+   auto serialized_length = reader.read_int64();
+   if (serialized_length < 0 || serialized_length > INT32_MAX) {
+      throw std::runtime_error("inline vfm sector length out of range");
+   }
+   owner.reset();
+   bytes.resize(static_cast<size_t>(serialized_length));
+   if (serialized_length > 0) {
+      reader.read_bytes(bytes.data(), static_cast<int32_t>(serialized_length));
+   }
+   data = bytes.data();
+   length = serialized_length;
+}
+
+std::string vfm_inline_sector::to_string() {
+   return "[vfm_inline_sector len = " + std::to_string(length) + " ]";
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "vfm_sector.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Sector whose bytes are embedded in the vfm itself (or whatever payload it was deserialized
+   /// from) and held in memory, for small overrides that don't merit a backing file.  Reads are a
+   /// memcpy and the bytes can always be borrowed.  Serialized as an int64 length followed by the
+   /// bytes.  A sector can instead point into memory owned by someone else, e.g. the payload
+   /// section of a mapped v2 vfm, in which case it keeps that owner alive.
+   /// </summary>
+   class vfm_inline_sector : public vfm_sector {
+   public:
+      static const dargon::guid kGuid;
+
+   private:
+      std::vector<uint8_t> bytes;
+      std::shared_ptr<const void> owner;
+      const uint8_t* data;
+      int64_t length;
+
+   public:
+      vfm_inline_sector();
+      vfm_inline_sector(std::vector<uint8_t> bytes);
+      vfm_inline_sector(std::shared_ptr<const void> owner, const uint8_t* data, int64_t length);
+
+      virtual int64_t size() override;
+      virtual void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override;
+      virtual const uint8_t* borrow(int64_t read_offset, int64_t read_length) override;
+      virtual void deserialize(dargon::binary_reader& reader) override;
+      virtual std::string to_string() override;
+   };
+}
@@ -0,0 +1,44 @@
+#include "dlc_pch.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include "vfm_mapped_image.hpp"
+
+using namespace dargon;
+
+vfm_mapped_image::vfm_mapped_image(std::shared_ptr<io_backend> io, const std::string& path) : io(io), range(), length(0) {
+   auto file = io->open_read(path);
+   if (file == io_backend::kInvalidFile) {
+      throw std::runtime_error("failed to open " + path);
+   }
+
+   try {
+      map_whole_file(file, path);
+   } catch (...) {
+      io->close(file);
+      throw;
+   }
+
+   // The view keeps the file alive on its own.
+   io->close(file);
+}
+
+vfm_mapped_image::vfm_mapped_image(std::shared_ptr<io_backend> io, io_backend::file_handle file, const std::string& path) : io(io), range(), length(0) {
+   map_whole_file(file, path);
+}
+
+vfm_mapped_image::~vfm_mapped_image() {
+   if (range.view != nullptr) {
+      io->unmap(range);
+   }
+}
+
+void vfm_mapped_image::map_whole_file(io_backend::file_handle file, const std::string& path) {
+   auto file_size = io->size(file);
+   if (file_size <= 0 || static_cast<uint64_t>(file_size) > SIZE_MAX) {
+      throw std::runtime_error("cannot map " + path + ": empty or too large");
+   }
+   if (!io->map(file, 0, file_size, range)) {
+      throw std::runtime_error("failed to map " + path);
+   }
+   length = static_cast<size_t>(file_size);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "noncopyable.hpp"
+#include "io/io_backend.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// A whole file mapped read-only into memory, e.g. a v2 vfm whose tables are used in place.
+   /// The view stays valid for the lifetime of the object.
+   /// </summary>
+   class vfm_mapped_image : dargon::noncopyable {
+      std::shared_ptr<io_backend> io;
+      io_backend::mapped_range range;
+      size_t length;
+
+      void map_whole_file(io_backend::file_handle file, const std::string& path);
+
+   public:
+      // Throws std::runtime_error if path can't be opened or mapped.
+      vfm_mapped_image(std::shared_ptr<io_backend> io, const std::string& path);
+
+      // Maps the file open as file, which the caller keeps owning; path only names it in errors.
+      vfm_mapped_image(std::shared_ptr<io_backend> io, io_backend::file_handle file, const std::string& path);
+      ~vfm_mapped_image();
+
+      const uint8_t* data() const { return range.data; }
+      size_t size() const { return length; }
+   };
+}
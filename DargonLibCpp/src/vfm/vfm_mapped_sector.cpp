@@ -0,0 +1,88 @@
+#include "dlc_pch.hpp"
+#include <cstring>
+#include <sstream>
+#include "binary_reader.hpp"
+#include "vfm_mapped_sector.hpp"
+
+using namespace dargon;
+
+const dargon::guid vfm_mapped_sector::kGuid(guid::parse("1E04A4EADC2A4B788029D123D3FEBE02"));
+
+vfm_mapped_sector::vfm_mapped_sector(std::shared_ptr<vfm_mapping_cache> mapping_cache, std::shared_ptr<vfm_handle_cache> handle_cache) 
+   : vfm_mapped_sector(mapping_cache, handle_cache, "", nullptr, 0, 0) {
+}
+
+vfm_mapped_sector::vfm_mapped_sector(std::shared_ptr<vfm_mapping_cache> mapping_cache, std::shared_ptr<vfm_handle_cache> handle_cache, std::string path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length) 
+   : path(path), offset(offset), length(length), mapping_cache(mapping_cache), handle_cache(handle_cache), file(file), data(nullptr) {
+}
+
+int64_t vfm_mapped_sector::size() {
+   return length;
+}
+
+void vfm_mapped_sector::read(int64_t read_offset, int64_t read_length, uint8_t * buffer, int32_t buffer_offset) {
+   if (buffer_offset > 0) {
+      return read(read_offset, read_length, buffer + buffer_offset, 0);
+   }
+
+   auto mapped = ensure_mapped();
+   if (mapped != nullptr) {
+      memcpy(buffer, mapped + read_offset, read_length);
+      return;
+   }
+
+   int64_t bytes_read = 0;
+   if (file) {
+      bytes_read = file->read(offset + read_offset, read_length, buffer);
+   } else {
+      std::cout << "VFM FAILED TO OPEN FILE " << path.c_str() << ":(" << std::endl;
+   }
+   if (bytes_read < read_length) {
+      memset(buffer + bytes_read, 0, static_cast<size_t>(read_length - bytes_read));
+   }
+}
+
+const uint8_t* vfm_mapped_sector::borrow(int64_t read_offset, int64_t read_length) {
+   auto mapped = ensure_mapped();
+   if (mapped == nullptr || read_offset < 0 || read_offset + read_length > length) {
+      return nullptr;
+   }
+   return mapped + read_offset;
+}
+
+void vfm_mapped_sector::deserialize(dargon::binary_reader & reader) {
+   path = reader.read_null_terminated_string();
+
+   offset = reader.read_int64();
+   length = reader.read_int64();
+
+   file = handle_cache->get(path);
+}
+
+std::string vfm_mapped_sector::to_string() {
+   std::stringstream ss;
+   ss << "[vfm_mapped_sector " << path << " off = " + std::to_string(offset) << ", len = " << std::to_string(length) << ", mapped = " << (data != nullptr) << " ]";
+   return ss.str();
+}
+
+const uint8_t* vfm_mapped_sector::ensure_mapped() {
+   std::call_once(map_once, [this]() { map_view(); });
+   return data;
+}
+
+void vfm_mapped_sector::map_view() {
+   if (length == 0) {
+      return;
+   }
+
+   view = mapping_cache->get(path, file);
+   if (!view) {
+      return;
+   }
+   if (offset < 0 || length > static_cast<int64_t>(view->size()) - offset) {
+      std::cout << "VFM SECTOR RUNS PAST END OF " << path.c_str() << ":(" << std::endl;
+      view.reset();
+      return;
+   }
+   data = view->data() + offset;
+}
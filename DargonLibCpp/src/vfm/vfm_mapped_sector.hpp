@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include "vfm_sector.hpp"
+#include "vfm_handle_cache.hpp"
+#include "vfm_mapping_cache.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// File-backed sector that serves reads with a memcpy out of a view of its backing file,
+   /// taken from the mapping cache on first use and shared with every other sector over the same
+   /// file.  Shares the on-disk layout of vfm_file_sector.  If the file gets no view (the mapping
+   /// budget is spent or address space is exhausted) reads fall back to positional reads.  Both
+   /// the view and those reads come from the backing file the sector was created with.
+   /// </summary>
+   class vfm_mapped_sector : public vfm_sector {
+   public:
+      static const dargon::guid kGuid;
+
+   private:
+      std::string path;
+      int64_t offset;
+      int64_t length;
+      std::shared_ptr<vfm_mapping_cache> mapping_cache;
+      std::shared_ptr<vfm_handle_cache> handle_cache;
+      std::shared_ptr<vfm_backing_file> file;
+
+      std::once_flag map_once;
+      std::shared_ptr<vfm_mapped_image> view;
+      const uint8_t* data;
+
+   public:
+      vfm_mapped_sector(std::shared_ptr<vfm_mapping_cache> mapping_cache, std::shared_ptr<vfm_handle_cache> handle_cache);
+      vfm_mapped_sector(std::shared_ptr<vfm_mapping_cache> mapping_cache, std::shared_ptr<vfm_handle_cache> handle_cache, std::string path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length);
+
+      virtual int64_t size() override;
+      virtual void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override;
+      virtual const uint8_t* borrow(int64_t read_offset, int64_t read_length) override;
+      virtual void deserialize(dargon::binary_reader& reader) override;
+      virtual std::string to_string() override;
+
+   private:
+      const uint8_t* ensure_mapped();
+      void map_view();
+   };
+}
@@ -0,0 +1,75 @@
+#include "dlc_pch.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "vfm_mapping_cache.hpp"
+
+using namespace dargon;
+
+vfm_mapping_cache::vfm_mapping_cache(std::shared_ptr<io_backend> io, int64_t budget)
+   : io(io), budget(budget), bytes_mapped(std::make_shared<std::atomic<int64_t>>(0)) {}
+
+std::shared_ptr<vfm_mapped_image> vfm_mapping_cache::get(const std::string& path, const std::shared_ptr<vfm_backing_file>& file) {
+   if (budget <= 0 || !file) {
+      return nullptr;
+   }
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto match = entries_by_file.find(file.get());
+      if (match != entries_by_file.end()) {
+         return match->second.view;
+      }
+   }
+
+   // Map outside the lock; mapping a file must not stall hits on other files. Declared before
+   // the lock below so a view we end up not using is unmapped after it's released.
+   std::unique_ptr<vfm_mapped_image> image;
+   try {
+      image.reset(new vfm_mapped_image(io, file->get_handle(), path));
+   } catch (std::runtime_error& e) {
+      std::cout << "VFM FAILED TO MAP " << path.c_str() << ": " << e.what() << std::endl;
+   }
+
+   std::lock_guard<std::mutex> lock(mutex);
+   auto match = entries_by_file.find(file.get());
+   if (match != entries_by_file.end()) {
+      // Another thread mapped the same file first.
+      return match->second.view;
+   }
+
+   std::shared_ptr<vfm_mapped_image> view;
+   if (image) {
+      auto length = static_cast<int64_t>(image->size());
+      if (*bytes_mapped + length <= budget) {
+         *bytes_mapped += length;
+         auto counter = bytes_mapped;
+         view = std::shared_ptr<vfm_mapped_image>(image.release(), [counter, length](vfm_mapped_image* released) {
+            *counter -= length;
+            delete released;
+         });
+      } else {
+         std::cout << "VFM NOT MAPPING " << path.c_str() << ": mapping budget exhausted" << std::endl;
+      }
+   }
+   entry added = { path, file, view };
+   entries_by_file.emplace(file.get(), added);
+   return view;
+}
+
+void vfm_mapping_cache::invalidate(const std::string& path) {
+   // Declared before the lock so views are unmapped, and files closed, after it is released.
+   std::vector<entry> dropped;
+   std::lock_guard<std::mutex> lock(mutex);
+   for (auto it = entries_by_file.begin(); it != entries_by_file.end(); ) {
+      if (it->second.path == path) {
+         dropped.push_back(std::move(it->second));
+         it = entries_by_file.erase(it);
+      } else {
+         ++it;
+      }
+   }
+}
+
+int64_t vfm_mapping_cache::size() {
+   return bytes_mapped->load();
+}
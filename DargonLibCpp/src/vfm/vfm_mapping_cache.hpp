@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "noncopyable.hpp"
+#include "vfm_handle_cache.hpp"
+#include "vfm_mapped_image.hpp"
+#include "io/io_backend.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Whole-file views of the files backing mapped sectors, shared by every sector a factory
+   /// creates so that a file is mapped once however many sectors cover it.  Views are made from
+   /// the open backing file a sector was given, so they always show the bytes the sector's vfm was
+   /// loaded against.  Views are admitted while the bytes mapped stay within budget; past it, or
+   /// when a file can't be mapped, get returns nullptr and sectors read through their backing file
+   /// instead.  A view is unmapped once neither the cache nor any sector holds it.
+   /// </summary>
+   class vfm_mapping_cache : dargon::noncopyable {
+      struct entry {
+         std::string path;
+         std::shared_ptr<vfm_backing_file> file;
+         std::shared_ptr<vfm_mapped_image> view;   // null for files refused a view
+      };
+
+      std::shared_ptr<io_backend> io;
+      int64_t budget;
+      std::shared_ptr<std::atomic<int64_t>> bytes_mapped;   // shared with views, which may outlive the cache
+      std::mutex mutex;
+      std::unordered_map<const vfm_backing_file*, entry> entries_by_file;
+
+   public:
+      static const int64_t kDefaultBudget = 256 * 1024 * 1024;
+
+      // A budget of zero maps nothing.
+      vfm_mapping_cache(std::shared_ptr<io_backend> io, int64_t budget = kDefaultBudget);
+
+      // Returns a view of the whole of file, open at path, or nullptr if it can't be mapped within
+      // budget. A file refused a view isn't tried again until its path is invalidated.
+      std::shared_ptr<vfm_mapped_image> get(const std::string& path, const std::shared_ptr<vfm_backing_file>& file);
+
+      // Drops the views of path, if any, so files opened at path afresh are mapped afresh. Sectors
+      // holding the old views keep them until they're released.
+      void invalidate(const std::string& path);
+
+      // Bytes mapped by live views, counting views dropped from the cache but still held.
+      int64_t size();
+   };
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vfm_sector_range.hpp"
+
+namespace dargon {
+   class vfm_sector;
+
+   // A sector as read from a vfm, before the reader instantiates it. Sectors backed by a plain
+   // region of a file carry backing_path and backing_offset and leave sector null; the reader
+   // creates them after optimization. Any other sector is carried through as-is in sector.
+   struct vfm_sector_layout {
+      vfm_sector_range range;
+      std::string backing_path;
+      int64_t backing_offset;
+      std::shared_ptr<vfm_sector> sector;
+
+      vfm_sector_layout() : range(), backing_offset(0) { }
+      vfm_sector_layout(vfm_sector_range range, std::string backing_path, int64_t backing_offset) : range(range), backing_path(std::move(backing_path)), backing_offset(backing_offset) { }
+      vfm_sector_layout(vfm_sector_range range, std::shared_ptr<vfm_sector> sector) : range(range), backing_offset(0), sector(std::move(sector)) { }
+
+      bool is_file_backed() const { return !sector; }
+   };
+
+   struct vfm_optimizer_stats {
+      size_t sectors_before;
+      size_t sectors_after;
+      size_t empty_dropped;
+      size_t merged;
+   };
+
+   /// <summary>
+   /// Load-time cleanup of a vfm's sector table.  The linker builds tables by repeatedly deleting
+   /// ranges and assigning sectors, which leaves runs of adjacent fragments pointing at contiguous
+   /// bytes of the same file.  optimize sorts the table, drops empty sectors and collapses each such
+   /// run into one sector, so reads issue fewer sub-reads and the index stays small.
+   /// </summary>
+   class vfm_optimizer {
+   public:
+      static vfm_optimizer_stats optimize(std::vector<vfm_sector_layout>& layout) {
+         vfm_optimizer_stats stats = {};
+         stats.sectors_before = layout.size();
+
+         auto empty_end = std::remove_if(layout.begin(), layout.end(), [](const vfm_sector_layout& entry) { return entry.range.size() <= 0; });
+         stats.empty_dropped = static_cast<size_t>(layout.end() - empty_end);
+         layout.erase(empty_end, layout.end());
+
+         std::stable_sort(layout.begin(), layout.end(), [](const vfm_sector_layout& a, const vfm_sector_layout& b) {
+            return a.range.start_inclusive < b.range.start_inclusive;
+         });
+
+         size_t kept = 0;
+         for (size_t i = 0; i < layout.size(); i++) {
+            if (kept > 0 && can_merge(layout[kept - 1], layout[i])) {
+               layout[kept - 1].range.end_exclusive = layout[i].range.end_exclusive;
+               stats.merged++;
+               continue;
+            }
+            if (kept != i) {
+               layout[kept] = std::move(layout[i]);
+            }
+            kept++;
+         }
+         layout.resize(kept);
+
+         stats.sectors_after = layout.size();
+         return stats;
+      }
+
+   private:
+      // True if next continues previous both in the virtual file and in the same backing file.
+      static bool can_merge(const vfm_sector_layout& previous, const vfm_sector_layout& next) {
+         return previous.is_file_backed() && next.is_file_backed() &&
+                previous.range.end_exclusive == next.range.start_inclusive &&
+                previous.backing_offset + previous.range.size() == next.backing_offset &&
+                previous.backing_path == next.backing_path;
+      }
+   };
+}
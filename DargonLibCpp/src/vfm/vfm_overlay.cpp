@@ -0,0 +1,54 @@
+#include "dlc_pch.hpp"
+#include <chrono>
+#include "vfm_file.hpp"
+#include "vfm_overlay.hpp"
+
+using namespace dargon;
+
+void vfm_overlay::add_layer(const std::string& name, std::shared_ptr<vfm_file> file) {
+   std::lock_guard<std::mutex> lock(mutex);
+   layers.push_back(layer { name, file, true });
+}
+
+bool vfm_overlay::set_layer_enabled(const std::string& name, bool enabled) {
+   std::lock_guard<std::mutex> lock(mutex);
+   bool found = false;
+   for (auto& layer : layers) {
+      if (layer.name == name) {
+         layer.enabled = enabled;
+         found = true;
+      }
+   }
+   return found;
+}
+
+std::shared_ptr<vfm_file> vfm_overlay::compose() {
+   std::vector<std::shared_ptr<vfm_file>> files;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& layer : layers) {
+         if (layer.enabled) {
+            files.push_back(layer.file);
+         }
+      }
+   }
+
+   auto start_time = std::chrono::steady_clock::now();
+   std::vector<vfm_sector_index::entry_collection> layer_entries;
+   std::vector<std::shared_ptr<const void>> owners;
+   size_t entry_count = 0;
+   for (auto& file : files) {
+      layer_entries.push_back(file->entries());
+      entry_count += layer_entries.back().size();
+      owners.push_back(file);
+   }
+   auto merged = vfm_overlay_merge(layer_entries);
+   auto merged_count = merged.size();
+
+   auto result = std::make_shared<vfm_file>();
+   result->assign_index(std::move(merged), std::move(owners));
+
+   auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+   std::cout << "vfm overlay: " << std::dec << files.size() << " layers, " << entry_count << " ranges -> " << merged_count << " in " << elapsed.count() << "us" << std::endl;
+   return result;
+}
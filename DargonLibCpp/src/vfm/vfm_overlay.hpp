@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "noncopyable.hpp"
+#include "vfm_sector_index.hpp"
+
+namespace dargon {
+   class vfm_file;
+
+   namespace vfm_overlay_detail {
+      inline bool starts_before(const vfm_sector_index_entry& a, const vfm_sector_index_entry& b) {
+         return a.range.start_inclusive < b.range.start_inclusive;
+      }
+
+      inline vfm_sector_index_entry piece_of(const vfm_sector_index_entry& entry, int64_t start, int64_t end) {
+         return vfm_sector_index_entry(vfm_sector_range(start, end), entry.sector, entry.sector_offset + (start - entry.range.start_inclusive));
+      }
+
+      // Lays upper over lower; both sorted and non-overlapping. Costs a binary search per upper
+      // entry plus a bulk copy of lower's untouched runs.
+      inline vfm_sector_index::entry_collection overlay(vfm_sector_index::entry_collection lower, const vfm_sector_index::entry_collection& upper) {
+         vfm_sector_index::entry_collection result;
+         result.reserve(lower.size() + 2 * upper.size());
+         auto position = lower.begin();
+         for (auto& entry : upper) {
+            auto start = entry.range.start_inclusive;
+            auto end = entry.range.end_exclusive;
+            if (start >= end) {
+               continue;
+            }
+
+            auto first_touched = std::partition_point(position, lower.end(), [start](const vfm_sector_index_entry& piece) { return piece.range.end_exclusive <= start; });
+            result.insert(result.end(), position, first_touched);
+            position = first_touched;
+
+            // Keep the parts of touched pieces outside [start, end). A tail stays in lower, as
+            // later upper entries may clip it further.
+            while (position != lower.end() && position->range.start_inclusive < end) {
+               auto piece = *position;
+               if (piece.range.start_inclusive < start) {
+                  result.push_back(piece_of(piece, piece.range.start_inclusive, start));
+               }
+               if (piece.range.end_exclusive > end) {
+                  *position = piece_of(piece, end, piece.range.end_exclusive);
+                  break;
+               }
+               ++position;
+            }
+            result.push_back(entry);
+         }
+         result.insert(result.end(), position, lower.end());
+         return result;
+      }
+
+      inline vfm_sector_index::entry_collection merge(const std::vector<vfm_sector_index::entry_collection>& layers, size_t first, size_t last) {
+         if (last - first == 1) {
+            auto result = layers[first];
+            if (!std::is_sorted(result.begin(), result.end(), starts_before)) {
+               std::stable_sort(result.begin(), result.end(), starts_before);
+            }
+            result.erase(std::remove_if(result.begin(), result.end(), [](const vfm_sector_index_entry& entry) { return entry.range.size() <= 0; }), result.end());
+            return result;
+         }
+         auto middle = first + (last - first) / 2;
+         return overlay(merge(layers, first, middle), merge(layers, middle, last));
+      }
+   }
+
+   // Merges layers, lowest priority first, into one sorted, non-overlapping entry list. Where
+   // layers overlap the later layer wins; earlier entries are clipped around it, with
+   // sector_offset adjusted so the surviving pieces still read the right bytes. Each layer's own
+   // entries must not overlap. Layers are merged pairwise as a balanced tree, so a large base is
+   // copied O(log layers) times rather than once per layer.
+   inline vfm_sector_index::entry_collection vfm_overlay_merge(const std::vector<vfm_sector_index::entry_collection>& layers) {
+      if (layers.empty()) {
+         return vfm_sector_index::entry_collection();
+      }
+      return vfm_overlay_detail::merge(layers, 0, layers.size());
+   }
+
+   /// <summary>
+   /// A base vfm and an ordered stack of per-mod delta layers over it.  compose merges the
+   /// enabled layers into a new, immutable vfm_file; toggling a mod and composing again rebuilds
+   /// only that in-memory index, never the files underneath.  Files already handed out keep
+   /// serving the composition they were built from.
+   /// </summary>
+   class vfm_overlay : dargon::noncopyable {
+      struct layer {
+         std::string name;
+         std::shared_ptr<vfm_file> file;
+         bool enabled;
+      };
+
+      std::mutex mutex;
+      std::vector<layer> layers;
+
+   public:
+      // Layers compose in the order added; later layers override earlier ones.
+      void add_layer(const std::string& name, std::shared_ptr<vfm_file> file);
+
+      // Returns false if no layer has the given name.
+      bool set_layer_enabled(const std::string& name, bool enabled);
+
+      std::shared_ptr<vfm_file> compose();
+   };
+}
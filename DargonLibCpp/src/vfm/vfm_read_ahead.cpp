@@ -0,0 +1,146 @@
+#include "dlc_pch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "vfm_read_ahead.hpp"
+
+using namespace dargon;
+
+vfm_read_ahead::vfm_read_ahead(std::shared_ptr<vfm_file> file, std::shared_ptr<thread_pool> pool, int64_t min_window, int64_t max_window)
+   : file(file), pool(pool), min_window(std::max<int64_t>(min_window, 1)), max_window(std::max(min_window, max_window)),
+     expected_offset(0), sequential_run(0), window(this->min_window), generation(0), counters() {}
+
+int64_t vfm_read_ahead::read(int64_t offset, int64_t length, uint8_t* buffer) {
+   length = std::min(length, file->size() - offset);
+   if (length <= 0) {
+      return 0;
+   }
+
+   std::unique_lock<std::mutex> lock(mutex);
+   bool sequential = offset == expected_offset;
+   sequential_run = sequential ? sequential_run + 1 : 0;
+   expected_offset = offset + length;
+
+   auto bytes_copied = copy_prefetched(offset, length, buffer, lock);
+   counters.bytes_served += bytes_copied;
+   bool hit = bytes_copied == length;
+   if (hit) {
+      counters.hits++;
+      window = std::min(window * 2, max_window);
+   } else {
+      counters.misses++;
+      window = std::max(window / 2, min_window);
+
+      // Whatever is buffered or being fetched lies behind or away from the reader now; drop it
+      // so the next prefetch starts from where the reader actually is. A prefetch still in
+      // flight is discarded when it lands, and readers waiting on it stop waiting.
+      generation++;
+      current.reset();
+      if (next.in_flight) {
+         prefetch_completed.notify_all();
+      }
+      next.reset();
+
+      lock.unlock();
+      bytes_copied += file->read(offset + bytes_copied, length - bytes_copied, buffer, bytes_copied);
+      lock.lock();
+   }
+
+   // Forward hops that land in the buffer keep the stream alive as well as strictly
+   // sequential reads do.
+   if (hit || sequential_run > 0) {
+      schedule_prefetch(lock);
+   }
+   return bytes_copied;
+}
+
+vfm_read_ahead_stats vfm_read_ahead::stats() {
+   std::lock_guard<std::mutex> lock(mutex);
+   auto result = counters;
+   result.window_size = window;
+   return result;
+}
+
+int64_t vfm_read_ahead::copy_prefetched(int64_t offset, int64_t length, uint8_t* buffer, std::unique_lock<std::mutex>& lock) {
+   int64_t bytes_copied = 0;
+   while (bytes_copied < length) {
+      auto position = offset + bytes_copied;
+      if (!current.contains(position)) {
+         if (!next.contains(position)) {
+            break;
+         }
+         if (next.in_flight) {
+            // A pool worker waiting on a prefetch queued behind it could starve the pool.
+            if (thread_pool::is_worker_thread()) {
+               break;
+            }
+            prefetch_completed.wait(lock, [this] { return !next.in_flight; });
+            continue;
+         }
+         current = std::move(next);
+         next.reset();
+      }
+
+      auto buffer_position = position - current.start;
+      auto copy_length = std::min(current.length - buffer_position, length - bytes_copied);
+      memcpy(buffer + bytes_copied, current.data.data() + buffer_position, static_cast<size_t>(copy_length));
+      bytes_copied += copy_length;
+   }
+   return bytes_copied;
+}
+
+void vfm_read_ahead::schedule_prefetch(std::unique_lock<std::mutex>& lock) {
+   if (next.in_flight || next.length > 0) {
+      return;
+   }
+
+   // Refill once the reader is within half a window of the end of what is buffered.
+   auto start = current.contains(expected_offset) ? current.start + current.length : expected_offset;
+   if (start - expected_offset > window / 2) {
+      return;
+   }
+   auto length = std::min(window, file->size() - start);
+   if (length <= 0) {
+      return;
+   }
+
+   next.start = start;
+   next.length = length;
+   next.in_flight = true;
+   counters.prefetches++;
+
+   auto self = shared_from_this();
+   auto scheduled_generation = generation;
+   pool->enqueue([self, start, length, scheduled_generation] { self->run_prefetch(start, length, scheduled_generation); });
+}
+
+void vfm_read_ahead::run_prefetch(int64_t start, int64_t length, uint64_t scheduled_generation) {
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (scheduled_generation != generation) {
+         return;
+      }
+   }
+
+   std::vector<uint8_t> data(static_cast<size_t>(length));
+   int64_t bytes_read = 0;
+   try {
+      bytes_read = std::max<int64_t>(file->read(start, length, data.data(), 0), 0);
+   } catch (std::exception& e) {
+      // Pool tasks must not throw; the reader's own read will hit the error again.
+      std::cout << "vfm_read_ahead: prefetch failed: " << e.what() << std::endl;
+   }
+   data.resize(static_cast<size_t>(bytes_read));
+
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      // A miss since scheduling dropped the buffer we were for, and perhaps rescheduled it.
+      if (scheduled_generation == generation && next.in_flight) {
+         next.data = std::move(data);
+         next.length = bytes_read;
+         next.in_flight = false;
+         counters.bytes_prefetched += bytes_read;
+      }
+   }
+   prefetch_completed.notify_all();
+}
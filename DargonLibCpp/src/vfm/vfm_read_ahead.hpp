@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "noncopyable.hpp"
+#include "thread_pool.hpp"
+#include "vfm_file.hpp"
+
+namespace dargon {
+   struct vfm_read_ahead_stats {
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t prefetches;
+      int64_t bytes_prefetched;
+      int64_t bytes_served;
+      int64_t window_size;
+   };
+
+   /// <summary>
+   /// Per-handle read-ahead over a vfm_file.  Once a handle reads sequentially, the bytes past
+   /// its read position are fetched on a thread pool into a staging buffer, so the next reads
+   /// are copies from memory rather than trips through the sectors.  The prefetch window
+   /// doubles while reads are served from the buffer and halves when they are not, so random
+   /// access settles at the minimum window and stops paying for prefetches it never uses.
+   /// </summary>
+   class vfm_read_ahead : public std::enable_shared_from_this<vfm_read_ahead>, dargon::noncopyable {
+      struct prefetch_buffer {
+         int64_t start = 0;
+         int64_t length = 0;
+         bool in_flight = false;
+         std::vector<uint8_t> data;
+
+         bool contains(int64_t offset) const { return start <= offset && offset < start + length; }
+         void reset() { start = 0; length = 0; in_flight = false; data.clear(); }
+      };
+
+      std::shared_ptr<vfm_file> file;
+      std::shared_ptr<thread_pool> pool;
+      const int64_t min_window;
+      const int64_t max_window;
+
+      std::mutex mutex;
+      std::condition_variable prefetch_completed;
+      prefetch_buffer current;
+      prefetch_buffer next;
+      int64_t expected_offset;
+      int sequential_run;
+      int64_t window;
+      uint64_t generation;             // bumped on every miss, outdating prefetches in flight
+      vfm_read_ahead_stats counters;
+
+   public:
+      static const int64_t kDefaultMinWindow = 64 * 1024;
+      static const int64_t kDefaultMaxWindow = 2 * 1024 * 1024;
+
+      vfm_read_ahead(std::shared_ptr<vfm_file> file, std::shared_ptr<thread_pool> pool, int64_t min_window = kDefaultMinWindow, int64_t max_window = kDefaultMaxWindow);
+
+      // Reads as vfm_file::read does, serving what it can from prefetched data.
+      int64_t read(int64_t offset, int64_t length, uint8_t* buffer);
+
+      vfm_read_ahead_stats stats();
+
+   private:
+      int64_t copy_prefetched(int64_t offset, int64_t length, uint8_t* buffer, std::unique_lock<std::mutex>& lock);
+      void schedule_prefetch(std::unique_lock<std::mutex>& lock);
+      void run_prefetch(int64_t start, int64_t length, uint64_t scheduled_generation);
+   };
+}
@@ -0,0 +1,170 @@
+#include "dlc_pch.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+#include "vfm_compressed_sector.hpp"
+#include "vfm_inline_sector.hpp"
+#include "vfm_mapped_image.hpp"
+#include "vfm_mapped_sector.hpp"
+#include "vfm_reader.hpp"
+#include "vfm_zero_sector.hpp"
+
+using namespace dargon;
+
+bool vfm_reader::validate(const std::string& path) {
+   auto file = io->open_read(path);
+   if (file == io_backend::kInvalidFile) {
+      std::cout << "Failed to open vfm " << path << std::endl;
+      return false;
+   }
+
+   vfm_v2_header header = {};
+   auto bytes_read = io->read_at(file, 0, sizeof(header), reinterpret_cast<uint8_t*>(&header));
+   io->close(file);
+   if (bytes_read < static_cast<int64_t>(sizeof(header.magic))) {
+      std::cout << "Failed to read vfm header of " << path << std::endl;
+      return false;
+   }
+
+   if (header.magic == vfm_sector_collection_magic) {
+      return true;
+   }
+   if (header.magic == vfm_v2_magic && bytes_read == static_cast<int64_t>(sizeof(header)) && header.version == vfm_v2_version && header.header_size >= sizeof(header)) {
+      return true;
+   }
+   std::cout << "vfm " << path << " has bad magic or version " << std::hex << header.magic << std::dec << " " << header.version << std::endl;
+   return false;
+}
+
+std::shared_ptr<vfm_file> vfm_reader::load(const std::string& path) {
+   std::shared_ptr<vfm_mapped_image> image;
+   try {
+      image = std::make_shared<vfm_mapped_image>(io, path);
+   } catch (std::runtime_error& e) {
+      std::cout << "Failed to map vfm " << path << ": " << e.what() << std::endl;
+   }
+
+   if (image) {
+      if (vfm_v2_view::is_v2(image->data(), image->size())) {
+         return load_v2(image, image->data(), image->size());
+      }
+      binary_reader reader(image->data(), image->size());
+      return load(reader);
+   }
+
+   auto fs = std::make_shared<std::fstream>();
+   fs->open(path.c_str(), std::fstream::in | std::fstream::binary);
+   if (!fs->is_open()) {
+      std::cout << "Failed to open " << path << std::endl;
+   }
+   binary_reader reader(fs);
+   return load(reader);
+}
+
+void vfm_reader::invalidate(const std::string& path) {
+   std::vector<std::string> paths;
+   try {
+      paths = backing_paths(path);
+   } catch (std::runtime_error& e) {
+      std::cout << "Failed to read backing paths of vfm " << path << ": " << e.what() << std::endl;
+   }
+   for (auto& backing_path : paths) {
+      sector_factory->invalidate(backing_path);
+   }
+}
+
+std::vector<std::string> vfm_reader::backing_paths(const std::string& path) {
+   std::vector<std::string> result;
+   auto image = std::make_shared<vfm_mapped_image>(io, path);
+   if (vfm_v2_view::is_v2(image->data(), image->size())) {
+      vfm_v2_view view(image->data(), image->size());
+      for (uint32_t i = 0; i < view.path_count(); i++) {
+         result.push_back(view.path(i));
+      }
+      return result;
+   }
+
+   binary_reader reader(image->data(), image->size());
+   std::unordered_set<std::string> seen;
+   for_each_v1_sector(reader, [&](const dargon::guid& guid, const vfm_sector_range&, const std::shared_ptr<vfm_sector>& sector) {
+      const std::string* backing_path = nullptr;
+      if (guid == vfm_file_sector::kGuid) {
+         backing_path = &std::static_pointer_cast<vfm_file_sector>(sector)->backing_path();
+      } else if (guid == vfm_compressed_sector::kGuid) {
+         backing_path = &std::static_pointer_cast<vfm_compressed_sector>(sector)->backing_path();
+      }
+      if (backing_path && seen.insert(*backing_path).second) {
+         result.push_back(*backing_path);
+      }
+   });
+   return result;
+}
+
+std::shared_ptr<vfm_overlay> vfm_reader::load_overlay(const std::vector<std::string>& paths) {
+   auto overlay = std::make_shared<vfm_overlay>();
+   for (auto& path : paths) {
+      overlay->add_layer(path, load(path));
+   }
+   return overlay;
+}
+
+std::shared_ptr<vfm_file> vfm_reader::load_v2(std::shared_ptr<const void> owner, const uint8_t* data, size_t length) {
+   vfm_v2_view view(data, length);
+
+   // Sectors are created on first read, but must read the backing files as they are now; open
+   // them up front for the resolver to hand out.
+   auto factory = sector_factory;
+   auto files = std::make_shared<std::vector<std::shared_ptr<vfm_backing_file>>>();
+   for (uint32_t i = 0; i < view.path_count(); i++) {
+      std::shared_ptr<vfm_backing_file> file;
+      try {
+         file = factory->open(view.path(i));
+      } catch (std::runtime_error& e) {
+         std::cout << "vfm v2 path " << i << " is corrupt: " << e.what() << std::endl;
+      }
+      files->push_back(file);
+   }
+
+   auto max_mapped_size = max_mapped_sector_size;
+   auto resolver = [owner, factory, files, max_mapped_size](const vfm_v2_view& table, uint32_t sector_index) -> std::shared_ptr<vfm_sector> {
+      auto& entry = table.sector(sector_index);
+      auto length = entry.end_exclusive - entry.start_inclusive;
+      if (memcmp(entry.type, vfm_inline_sector::kGuid.data, GUID_LENGTH) == 0) {
+         // Inline bytes live in the image's payload section; the sector reads them in place.
+         auto bytes = table.payload(entry.source_offset, length);
+         if (bytes == nullptr) {
+            std::cout << "vfm v2 sector " << sector_index << " has out of range inline data" << std::endl;
+            return nullptr;
+         }
+         return std::make_shared<vfm_inline_sector>(owner, bytes, length);
+      }
+      if (memcmp(entry.type, vfm_zero_sector::kGuid.data, GUID_LENGTH) == 0) {
+         return std::make_shared<vfm_zero_sector>(length);
+      }
+
+      bool is_file_sector = memcmp(entry.type, vfm_file_sector::kGuid.data, GUID_LENGTH) == 0;
+      bool is_mapped_sector = memcmp(entry.type, vfm_mapped_sector::kGuid.data, GUID_LENGTH) == 0;
+      bool is_compressed_sector = memcmp(entry.type, vfm_compressed_sector::kGuid.data, GUID_LENGTH) == 0;
+      if ((!is_file_sector && !is_mapped_sector && !is_compressed_sector) || entry.path_index == vfm_v2_no_path) {
+         std::cout << "vfm v2 sector " << sector_index << " has unsupported type" << std::endl;
+         return nullptr;
+      }
+
+      try {
+         auto path = table.path(entry.path_index);
+         auto& file = (*files)[entry.path_index];
+         if (is_compressed_sector) {
+            return factory->create_compressed(path, file, entry.source_offset, length);
+         }
+         return factory->intern(path, file, entry.source_offset, length, is_mapped_sector || length <= max_mapped_size);
+      } catch (std::runtime_error& e) {
+         std::cout << "vfm v2 sector " << sector_index << " is corrupt: " << e.what() << std::endl;
+         return nullptr;
+      }
+   };
+
+   auto result = std::make_shared<vfm_file>();
+   result->assign_table(owner, view, resolver);
+   result->set_parallel_reads(parallel_read_pool, min_parallel_read_length);
+   return result;
+}
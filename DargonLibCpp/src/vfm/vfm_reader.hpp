@@ -1,12 +1,18 @@
 #pragma once
 
 #include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include "base.hpp"
 #include "binary_reader.hpp"
 
+#include "io/io_backend.hpp"
 #include "vfm_file.hpp"
+#include "vfm_file_sector.hpp"
+#include "vfm_format_v2.hpp"
+#include "vfm_optimizer.hpp"
+#include "vfm_overlay.hpp"
 #include "vfm_sector.hpp"
 #include "vfm_sector_factory.hpp"
 
@@ -14,19 +20,88 @@ namespace dargon {
    const uint32_t vfm_sector_collection_magic = 0x534D4656U;
 
    class vfm_reader {
+      std::shared_ptr<io_backend> io;
       std::shared_ptr<vfm_sector_factory> sector_factory;
+      int64_t max_mapped_sector_size;
+      std::shared_ptr<thread_pool> parallel_read_pool;
+      int64_t min_parallel_read_length;
 
    public:
-      vfm_reader(std::shared_ptr<vfm_sector_factory> sector_factory) 
-      : sector_factory(sector_factory) { }
+      // File sectors up to this size are read through a view of their backing file, within the
+      // factory's mapping budget. Larger ones (e.g. whole base archives) stay on positional reads.
+      static const int64_t kDefaultMaxMappedSectorSize = 4 * 1024 * 1024;
 
+      vfm_reader(std::shared_ptr<io_backend> io, std::shared_ptr<vfm_sector_factory> sector_factory, int64_t max_mapped_sector_size = kDefaultMaxMappedSectorSize) 
+      : io(io), sector_factory(sector_factory), max_mapped_sector_size(max_mapped_sector_size), min_parallel_read_length(vfm_file::kDefaultMinParallelReadLength) { }
+
+      // Files loaded from here on read spanning sectors concurrently; see vfm_file::set_parallel_reads.
+      void set_parallel_reads(std::shared_ptr<thread_pool> pool, int64_t min_length = vfm_file::kDefaultMinParallelReadLength) {
+         parallel_read_pool = pool;
+         min_parallel_read_length = min_length;
+      }
+
+      // Checks that path opens and starts with a v1 or supported v2 header, without reading the
+      // sector table. Cheap enough to run for every remap command at injection time.
+      bool validate(const std::string& path);
+
+      // Loads the vfm at path. v2 files are mapped and their tables used in place; anything else
+      // is parsed as v1.
+      std::shared_ptr<vfm_file> load(const std::string& path);
+
+      // Drops everything the sector factory caches for the files the vfm at path reads from,
+      // so the next load sees them as they are on disk now. Reads the vfm's path or sector table.
+      void invalidate(const std::string& path);
+
+      // Loads each of paths as a layer of a new overlay, lowest priority (the base) first.
+      std::shared_ptr<vfm_overlay> load_overlay(const std::vector<std::string>& paths);
+
+      // Composes overlay into a file set up like the ones this reader loads.
+      std::shared_ptr<vfm_file> compose(vfm_overlay& overlay) {
+         auto result = overlay.compose();
+         result->set_parallel_reads(parallel_read_pool, min_parallel_read_length);
+         return result;
+      }
+
+      // Loads a v2 image from memory kept alive by owner.
+      std::shared_ptr<vfm_file> load_v2(std::shared_ptr<const void> owner, const uint8_t* data, size_t length);
+
+      // Parses a v1 sector collection.
       std::shared_ptr<vfm_file> load(dargon::binary_reader& reader) {
+         std::vector<vfm_sector_layout> layout;
+         for_each_v1_sector(reader, [&](const dargon::guid& guid, const vfm_sector_range& sector_range, const std::shared_ptr<vfm_sector>& sector) {
+            if (guid == vfm_file_sector::kGuid) {
+               auto file_sector = std::static_pointer_cast<vfm_file_sector>(sector);
+               layout.emplace_back(sector_range, file_sector->backing_path(), file_sector->backing_offset());
+            } else {
+               layout.emplace_back(sector_range, sector);
+            }
+         });
+
+         vfm_optimizer::optimize(layout);
+
+         auto result = std::make_shared<vfm_file>();
+         for (auto& entry : layout) {
+            auto sector = entry.sector;
+            if (entry.is_file_backed()) {
+               auto length = entry.range.size();
+               sector = sector_factory->intern(entry.backing_path, entry.backing_offset, length, length <= max_mapped_sector_size);
+            }
+            result->assign_sector(entry.range, sector);
+         }
+         result->build_index();
+         result->set_parallel_reads(parallel_read_pool, min_parallel_read_length);
+         return result;
+      }
+
+   private:
+      // Calls visitor(guid, range, sector) for each sector of a v1 sector collection, in order.
+      template <typename TVisitor>
+      void for_each_v1_sector(dargon::binary_reader& reader, TVisitor&& visitor) {
          auto magic = reader.read_uint32();
          if (magic != vfm_sector_collection_magic) {
             std::cout << "sector collection magic mismatch. got " << std::hex << magic << " but expected " << vfm_sector_collection_magic << std::endl;
-            throw std::exception("sector collection magic mismatch.");
+            throw std::runtime_error("sector collection magic mismatch.");
          }
-         auto result = std::make_shared<vfm_file>();
          auto sector_count = reader.read_uint32();
          for (auto i = 0; i < sector_count; i++) {
             auto guid = reader.read_guid();
@@ -35,9 +110,11 @@ namespace dargon {
             vfm_sector_range sector_range(range_start_inclusive, range_end_exclusive);
             auto sector = sector_factory->create(guid);
             sector->deserialize(reader);
-            result->assign_sector(sector_range, sector);
+            visitor(guid, sector_range, sector);
          }
-         return result;
       }
+
+      // Returns the paths of the files the vfm at path reads from.
+      std::vector<std::string> backing_paths(const std::string& path);
    };
 }
\ No newline at end of file
@@ -2,25 +2,18 @@
 #include "util.hpp";
 #include "noncopyable.hpp";
 #include "binary_reader.hpp";
+#include "vfm_sector_range.hpp"
 
 namespace dargon {
-   struct vfm_sector_range {
-      int64_t start_inclusive;
-      int64_t end_exclusive;
-
-      vfm_sector_range() : vfm_sector_range(0, 0) { }
-      vfm_sector_range(int64_t start_inclusive, int64_t end_exclusive) : start_inclusive(start_inclusive), end_exclusive(end_exclusive) { }
-      long size() const { return end_exclusive - start_inclusive; }
-
-      bool intersects(const vfm_sector_range& range) const { return !((start_inclusive >= range.end_exclusive) || (range.start_inclusive >= end_exclusive)); }
-      bool fully_contains(const vfm_sector_range& range) const { return start_inclusive <= range.start_inclusive && range.end_exclusive <= end_exclusive; }
-      bool contains(long x) const { return start_inclusive <= x && x < end_exclusive; }
-   };
-
    class vfm_sector : dargon::noncopyable {
    public:
       virtual int64_t size() = 0;
       virtual void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t bufferOffset) = 0;
+
+      // Returns a pointer to the sector's bytes at read_offset if the sector keeps them in memory
+      // for at least read_length bytes, letting callers that can consume a view skip the copy.
+      virtual const uint8_t* borrow(int64_t read_offset, int64_t read_length) { return nullptr; }
+
       virtual void deserialize(dargon::binary_reader& reader) = 0;
       virtual std::string to_string() = 0;
    };
@@ -0,0 +1,101 @@
+#include "dlc_pch.hpp"
+#include <iterator>
+#include <stdexcept>
+#include "vfm_sector_collection.hpp"
+#include "vfm_compressed_sector.hpp"
+#include "vfm_file_sector.hpp"
+#include "vfm_inline_sector.hpp"
+#include "vfm_mapped_sector.hpp"
+#include "vfm_writer.hpp"
+#include "vfm_zero_sector.hpp"
+
+using namespace dargon;
+
+vfm_sector_source vfm_sector_source::file(const std::string& path, int64_t offset) {
+   return vfm_sector_source{ vfm_file_sector::kGuid, path, offset, nullptr };
+}
+
+vfm_sector_source vfm_sector_source::mapped(const std::string& path, int64_t offset) {
+   return vfm_sector_source{ vfm_mapped_sector::kGuid, path, offset, nullptr };
+}
+
+vfm_sector_source vfm_sector_source::compressed(const std::string& path, int64_t offset) {
+   return vfm_sector_source{ vfm_compressed_sector::kGuid, path, offset, nullptr };
+}
+
+vfm_sector_source vfm_sector_source::inline_bytes(std::vector<uint8_t> bytes) {
+   return vfm_sector_source{ vfm_inline_sector::kGuid, "", 0, std::make_shared<const std::vector<uint8_t>>(std::move(bytes)) };
+}
+
+vfm_sector_source vfm_sector_source::zero() {
+   return vfm_sector_source{ vfm_zero_sector::kGuid, "", 0, nullptr };
+}
+
+bool vfm_sector_source::can_split() const {
+   return type != vfm_compressed_sector::kGuid;
+}
+
+vfm_sector_source vfm_sector_source::advanced(int64_t delta) const {
+   auto result = *this;
+   if (type != vfm_zero_sector::kGuid) {
+      result.offset += delta;
+   }
+   return result;
+}
+
+void vfm_sector_collection::assign_sector(vfm_sector_range range, vfm_sector_source source) {
+   if (range.size() <= 0) {
+      return;
+   }
+   delete_range(range);
+   sectors.emplace(range.start_inclusive, sector{ range, std::move(source) });
+}
+
+void vfm_sector_collection::delete_range(vfm_sector_range range) {
+   if (range.size() <= 0) {
+      return;
+   }
+
+   // Check both cuts before making either, so a failed delete leaves the table untouched.
+   for (auto position : { range.start_inclusive, range.end_exclusive }) {
+      auto cut = find_containing(position);
+      if (cut && cut->range.start_inclusive != position && !cut->source.can_split()) {
+         throw std::runtime_error("vfm edit would split a compressed sector");
+      }
+   }
+
+   split_at(range.start_inclusive);
+   split_at(range.end_exclusive);
+   sectors.erase(sectors.lower_bound(range.start_inclusive), sectors.lower_bound(range.end_exclusive));
+}
+
+std::vector<uint8_t> vfm_sector_collection::serialize() const {
+   return vfm_writer::write_v1(*this);
+}
+
+std::vector<uint8_t> vfm_sector_collection::serialize_v2() const {
+   return vfm_writer::write_v2(*this);
+}
+
+void vfm_sector_collection::split_at(int64_t position) {
+   auto next = sectors.upper_bound(position);
+   if (next == sectors.begin()) {
+      return;
+   }
+   auto& head = std::prev(next)->second;
+   if (head.range.start_inclusive == position || head.range.end_exclusive <= position) {
+      return;
+   }
+   sector tail = { vfm_sector_range(position, head.range.end_exclusive), head.source.advanced(position - head.range.start_inclusive) };
+   head.range.end_exclusive = position;
+   sectors.emplace_hint(next, position, std::move(tail));
+}
+
+const vfm_sector_collection::sector* vfm_sector_collection::find_containing(int64_t position) const {
+   auto it = sectors.upper_bound(position);
+   if (it == sectors.begin()) {
+      return nullptr;
+   }
+   auto& candidate = std::prev(it)->second;
+   return candidate.range.end_exclusive > position ? &candidate : nullptr;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "guid.hpp"
+#include "vfm_sector_range.hpp"
+
+namespace dargon {
+   // What a sector of a vfm being edited reads, as it will be serialized. offset is into path for
+   // file, mapped and compressed sectors and into bytes for inline ones.
+   struct vfm_sector_source {
+      dargon::guid type;
+      std::string path;
+      int64_t offset;
+      std::shared_ptr<const std::vector<uint8_t>> bytes;
+
+      static vfm_sector_source file(const std::string& path, int64_t offset);
+      static vfm_sector_source mapped(const std::string& path, int64_t offset);
+      static vfm_sector_source compressed(const std::string& path, int64_t offset);
+      static vfm_sector_source inline_bytes(std::vector<uint8_t> bytes);
+      static vfm_sector_source zero();
+
+      // A compressed object decodes as a whole, so its sectors can't be cut.
+      bool can_split() const;
+
+      // The source of the same sector's bytes from delta onwards.
+      vfm_sector_source advanced(int64_t delta) const;
+   };
+
+   /// <summary>
+   /// Editable table of a vfm's sectors, the native counterpart of the linker's SectorCollection.
+   /// Sectors are kept sorted and non-overlapping in a tree keyed by start, so assign_sector and
+   /// delete_range cost O(log n) plus the sectors they remove.  Cutting a sector adjusts its
+   /// source offset so the surviving pieces still read the same bytes.  serialize writes what
+   /// vfm_reader loads (see vfm_writer).
+   /// </summary>
+   class vfm_sector_collection {
+   public:
+      struct sector {
+         vfm_sector_range range;
+         vfm_sector_source source;
+      };
+      typedef std::map<int64_t, sector> sector_map;
+
+   private:
+      sector_map sectors;
+
+   public:
+      // Maps range to source, replacing whatever range covered before. Empty ranges are ignored.
+      // Throws std::runtime_error if that would cut a compressed sector.
+      void assign_sector(vfm_sector_range range, vfm_sector_source source);
+
+      // Unmaps range; it then reads as zeroes. Throws std::runtime_error if that would cut a
+      // compressed sector, in which case nothing is removed.
+      void delete_range(vfm_sector_range range);
+
+      size_t sector_count() const { return sectors.size(); }
+
+      // End of the last sector, or 0 if there are none.
+      int64_t size() const { return sectors.empty() ? 0 : sectors.rbegin()->second.range.end_exclusive; }
+
+      sector_map::const_iterator begin() const { return sectors.begin(); }
+      sector_map::const_iterator end() const { return sectors.end(); }
+
+      // Serializes as a v1 sector collection.
+      std::vector<uint8_t> serialize() const;
+
+      // Serializes as a v2 image, with inline sectors' bytes in its payload section.
+      std::vector<uint8_t> serialize_v2() const;
+
+   private:
+      // If a sector strictly contains position, splits it there.
+      void split_at(int64_t position);
+      const sector* find_containing(int64_t position) const;
+   };
+}
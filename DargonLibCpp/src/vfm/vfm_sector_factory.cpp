@@ -1,16 +1,96 @@
 #include "dlc_pch.hpp"
+#include <stdexcept>
 #include "vfm_sector_factory.hpp"
+#include "vfm_compressed_sector.hpp"
 #include "vfm_file_sector.hpp"
+#include "vfm_inline_sector.hpp"
+#include "vfm_mapped_sector.hpp"
+#include "vfm_zero_sector.hpp"
 
 using namespace dargon;
 
-vfm_sector_factory::vfm_sector_factory(std::shared_ptr<dargon::IO::IoProxy> io_proxy) : io_proxy(io_proxy) {}
+vfm_sector_factory::vfm_sector_factory(std::shared_ptr<io_backend> io) 
+   : vfm_sector_factory(io, std::make_shared<vfm_handle_cache>(io), std::make_shared<vfm_block_cache>()) {}
+
+vfm_sector_factory::vfm_sector_factory(std::shared_ptr<io_backend> io, std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache, std::shared_ptr<vfm_mapping_cache> mapping_cache) 
+   : io(io), handle_cache(handle_cache), block_cache(block_cache), mapping_cache(mapping_cache ? mapping_cache : std::make_shared<vfm_mapping_cache>(io)) {}
 
 std::shared_ptr<vfm_sector> vfm_sector_factory::create(dargon::guid type) {
    if (type == vfm_file_sector::kGuid) {
-      return std::shared_ptr<vfm_sector>(new vfm_file_sector(io_proxy));
+      return std::shared_ptr<vfm_sector>(new vfm_file_sector(handle_cache, block_cache));
+   } else if (type == vfm_mapped_sector::kGuid) {
+      return std::shared_ptr<vfm_sector>(new vfm_mapped_sector(mapping_cache, handle_cache));
+   } else if (type == vfm_compressed_sector::kGuid) {
+      return std::shared_ptr<vfm_sector>(new vfm_compressed_sector(handle_cache, block_cache));
+   } else if (type == vfm_inline_sector::kGuid) {
+      return std::shared_ptr<vfm_sector>(new vfm_inline_sector());
+   } else if (type == vfm_zero_sector::kGuid) {
+      return std::shared_ptr<vfm_sector>(new vfm_zero_sector());
    } else {
       std::cout << "Did not have for guid " << type.to_string() << " didn't match " << vfm_file_sector::kGuid.to_string() << std::endl;
-      throw std::exception("vfm sector type not supported");
+      throw std::runtime_error("vfm sector type not supported");
+   }
+}
+
+std::shared_ptr<vfm_backing_file> vfm_sector_factory::open(const std::string& path) {
+   return handle_cache->get(path);
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::create_file(const std::string& path, int64_t offset, int64_t length) {
+   return create_file(path, open(path), offset, length);
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::create_file(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length) {
+   return std::shared_ptr<vfm_sector>(new vfm_file_sector(handle_cache, block_cache, path, file, offset, length));
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::create_mapped(const std::string& path, int64_t offset, int64_t length) {
+   return create_mapped(path, open(path), offset, length);
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::create_mapped(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length) {
+   return std::shared_ptr<vfm_sector>(new vfm_mapped_sector(mapping_cache, handle_cache, path, file, offset, length));
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::create_compressed(const std::string& path, int64_t offset, int64_t length) {
+   return create_compressed(path, open(path), offset, length);
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::create_compressed(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length) {
+   return std::shared_ptr<vfm_sector>(new vfm_compressed_sector(handle_cache, block_cache, path, file, offset, length));
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::intern(const std::string& path, int64_t offset, int64_t length, bool mapped) {
+   return intern(path, open(path), offset, length, mapped);
+}
+
+std::shared_ptr<vfm_sector> vfm_sector_factory::intern(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length, bool mapped) {
+   auto create = [this, &path, &file, offset, length, mapped] { return mapped ? create_mapped(path, file, offset, length) : create_file(path, file, offset, length); };
+   if (!content_store) {
+      return create();
    }
+   return content_store->intern(path, offset, length, create);
 }
+
+void vfm_sector_factory::enable_content_sharing(int64_t max_hashed_length, std::shared_ptr<thread_pool> hash_pool) {
+   if (max_hashed_length <= 0) {
+      content_store.reset();
+      return;
+   }
+   auto files = handle_cache;
+   content_store = std::make_shared<vfm_content_store>([files](const std::string& path, int64_t offset, int64_t length, uint8_t* buffer) -> int64_t {
+      auto file = files->get(path);
+      return file ? file->read(offset, length, buffer) : 0;
+   }, max_hashed_length, hash_pool);
+}
+
+void vfm_sector_factory::invalidate(const std::string& path) {
+   if (content_store) {
+      content_store->invalidate(path);
+   }
+   if (block_cache) {
+      block_cache->invalidate(path);
+   }
+   mapping_cache->invalidate(path);
+   handle_cache->invalidate(path);
+}
\ No newline at end of file
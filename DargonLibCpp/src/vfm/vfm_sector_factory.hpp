@@ -2,14 +2,57 @@
 #include <memory>
 #include "guid.hpp"
 #include "vfm_sector.hpp"
-#include "io/IoProxy.hpp"
+#include "vfm_block_cache.hpp"
+#include "vfm_content_store.hpp"
+#include "vfm_handle_cache.hpp"
+#include "vfm_mapping_cache.hpp"
+#include "io/io_backend.hpp"
 
 namespace dargon {
    class vfm_sector_factory {
-      std::shared_ptr<dargon::IO::IoProxy> io_proxy;
+      std::shared_ptr<io_backend> io;
+      std::shared_ptr<vfm_handle_cache> handle_cache;
+      std::shared_ptr<vfm_block_cache> block_cache;
+      std::shared_ptr<vfm_content_store> content_store;
+      std::shared_ptr<vfm_mapping_cache> mapping_cache;
 
    public:
-      vfm_sector_factory(std::shared_ptr<dargon::IO::IoProxy> io_proxy);
+      vfm_sector_factory(std::shared_ptr<io_backend> io);
+
+      // block_cache may be null, in which case file sectors read straight from their backing files.
+      // Without a mapping_cache, one with the default budget is used.
+      vfm_sector_factory(std::shared_ptr<io_backend> io, std::shared_ptr<vfm_handle_cache> handle_cache, std::shared_ptr<vfm_block_cache> block_cache, std::shared_ptr<vfm_mapping_cache> mapping_cache = nullptr);
       std::shared_ptr<vfm_sector> create(dargon::guid type);
+
+      // Returns the backing file open at path, opening it if need be, or nullptr if it can't be
+      // opened. Sectors read the file they are created with for as long as they live, so a vfm
+      // whose backing files are opened at load never sees a file replaced on disk after it.
+      std::shared_ptr<vfm_backing_file> open(const std::string& path);
+
+      // The overloads without file create the sector over open(path).
+      std::shared_ptr<vfm_sector> create_file(const std::string& path, int64_t offset, int64_t length);
+      std::shared_ptr<vfm_sector> create_file(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length);
+      std::shared_ptr<vfm_sector> create_mapped(const std::string& path, int64_t offset, int64_t length);
+      std::shared_ptr<vfm_sector> create_mapped(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length);
+
+      // Returns a sector over [offset, offset + length) of path, mapped or positional as asked,
+      // shared with every other vfm interning the same region or identical bytes elsewhere once
+      // content sharing is enabled. Without it this is create_mapped or create_file.
+      std::shared_ptr<vfm_sector> intern(const std::string& path, int64_t offset, int64_t length, bool mapped);
+      std::shared_ptr<vfm_sector> intern(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length, bool mapped);
+
+      // Enables content sharing for intern, hashing regions on hash_pool. Regions longer than
+      // max_hashed_length are shared only with identical regions; zero disables sharing.
+      void enable_content_sharing(int64_t max_hashed_length = vfm_content_store::kDefaultMaxHashedLength, std::shared_ptr<thread_pool> hash_pool = nullptr);
+      std::shared_ptr<vfm_content_store> get_content_store() { return content_store; }
+
+      // Drops what the handle, block and mapping caches and the content store hold for the file
+      // at path, for when it may have changed on disk. Sectors already created keep reading the
+      // file they were created with.
+      void invalidate(const std::string& path);
+
+      // length is the uncompressed size of the compressed object at offset in path.
+      std::shared_ptr<vfm_sector> create_compressed(const std::string& path, int64_t offset, int64_t length);
+      std::shared_ptr<vfm_sector> create_compressed(const std::string& path, std::shared_ptr<vfm_backing_file> file, int64_t offset, int64_t length);
    };
 }
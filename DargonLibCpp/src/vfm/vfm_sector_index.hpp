@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "noncopyable.hpp"
+#include "vfm_sector_range.hpp"
+
+namespace dargon {
+   class vfm_sector;
+
+   struct vfm_sector_index_entry {
+      vfm_sector_range range;
+      vfm_sector* sector;
+      int64_t sector_offset;           // offset in sector of range.start_inclusive; nonzero for clipped sectors
+
+      vfm_sector_index_entry() : range(), sector(nullptr), sector_offset(0) { }
+      vfm_sector_index_entry(vfm_sector_range range, vfm_sector* sector, int64_t sector_offset = 0) : range(range), sector(sector), sector_offset(sector_offset) { }
+   };
+
+   /// <summary>
+   /// Immutable, sorted view of a vfm's sectors used to service reads.  Entries are ordered by
+   /// range and may not overlap, so the first sector touching an offset is found by binary search
+   /// and the rest of a read is a forward walk.  The index holds raw sector pointers; whoever owns
+   /// the index must keep the sectors alive for as long as it is in use.
+   /// </summary>
+   class vfm_sector_index : dargon::noncopyable {
+   public:
+      typedef std::vector<vfm_sector_index_entry> entry_collection;
+      typedef entry_collection::const_iterator const_iterator;
+
+   private:
+      entry_collection entries;
+
+   public:
+      vfm_sector_index() { }
+      explicit vfm_sector_index(entry_collection unsorted_entries) : entries(std::move(unsorted_entries)) {
+         std::stable_sort(entries.begin(), entries.end(), [](const vfm_sector_index_entry& a, const vfm_sector_index_entry& b) {
+            return a.range.start_inclusive < b.range.start_inclusive;
+         });
+         for (size_t i = 1; i < entries.size(); i++) {
+            if (entries[i - 1].range.end_exclusive > entries[i].range.start_inclusive) {
+               throw std::runtime_error("vfm sector index given overlapping sectors.");
+            }
+         }
+      }
+
+      const_iterator begin() const { return entries.begin(); }
+      const_iterator end() const { return entries.end(); }
+      size_t size() const { return entries.size(); }
+      bool empty() const { return entries.empty(); }
+
+      // One past the last byte covered by a sector, or 0 if the index is empty.
+      int64_t extent() const { return entries.empty() ? 0 : entries.back().range.end_exclusive; }
+
+      // Returns the first entry whose range ends after offset. Callers walk forward from it until
+      // an entry starts at or beyond the end of their read.
+      const_iterator find_first(int64_t offset) const {
+         return std::partition_point(entries.begin(), entries.end(), [offset](const vfm_sector_index_entry& entry) {
+            return entry.range.end_exclusive <= offset;
+         });
+      }
+   };
+}
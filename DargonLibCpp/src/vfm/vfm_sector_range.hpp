@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dargon {
+   struct vfm_sector_range {
+      int64_t start_inclusive;
+      int64_t end_exclusive;
+
+      vfm_sector_range() : vfm_sector_range(0, 0) { }
+      vfm_sector_range(int64_t start_inclusive, int64_t end_exclusive) : start_inclusive(start_inclusive), end_exclusive(end_exclusive) { }
+      int64_t size() const { return end_exclusive - start_inclusive; }
+
+      bool intersects(const vfm_sector_range& range) const { return !((start_inclusive >= range.end_exclusive) || (range.start_inclusive >= end_exclusive)); }
+      bool fully_contains(const vfm_sector_range& range) const { return start_inclusive <= range.start_inclusive && range.end_exclusive <= end_exclusive; }
+      bool contains(int64_t x) const { return start_inclusive <= x && x < end_exclusive; }
+   };
+}
@@ -0,0 +1,110 @@
+#include "dlc_pch.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "vfm_writer.hpp"
+#include "vfm_compressed_sector.hpp"
+#include "vfm_file_sector.hpp"
+#include "vfm_format_v2.hpp"
+#include "vfm_inline_sector.hpp"
+#include "vfm_mapped_sector.hpp"
+#include "vfm_reader.hpp"
+#include "vfm_zero_sector.hpp"
+
+using namespace dargon;
+
+namespace {
+   // Appends in the layout binary_reader reads: host byte order, which is little-endian on
+   // every platform Dargon runs on.
+   class byte_writer {
+      std::vector<uint8_t>& output;
+
+   public:
+      byte_writer(std::vector<uint8_t>& output) : output(output) { }
+
+      void write_bytes(const void* bytes, size_t count) {
+         auto begin = static_cast<const uint8_t*>(bytes);
+         output.insert(output.end(), begin, begin + count);
+      }
+
+      template <typename T>
+      void write(T value) {
+         write_bytes(&value, sizeof(value));
+      }
+
+      void write_null_terminated_string(const std::string& value) {
+         write_bytes(value.c_str(), value.size() + 1);
+      }
+   };
+
+   bool is_path_backed(const dargon::guid& type) {
+      return type == vfm_file_sector::kGuid || type == vfm_mapped_sector::kGuid || type == vfm_compressed_sector::kGuid;
+   }
+
+   const uint8_t* inline_bytes_of(const vfm_sector_collection::sector& sector) {
+      auto& bytes = sector.source.bytes;
+      if (!bytes || sector.source.offset < 0 || sector.source.offset + sector.range.size() > static_cast<int64_t>(bytes->size())) {
+         throw std::runtime_error("inline vfm sector is missing bytes");
+      }
+      return bytes->data() + sector.source.offset;
+   }
+}
+
+std::vector<uint8_t> vfm_writer::write_v1(const vfm_sector_collection& sectors) {
+   std::vector<uint8_t> result;
+   byte_writer writer(result);
+   writer.write<uint32_t>(vfm_sector_collection_magic);
+   writer.write<uint32_t>(static_cast<uint32_t>(sectors.sector_count()));
+   for (auto& pair : sectors) {
+      auto& sector = pair.second;
+      auto& type = sector.source.type;
+      auto length = sector.range.size();
+      writer.write_bytes(type.data, GUID_LENGTH);
+      writer.write<int64_t>(sector.range.start_inclusive);
+      writer.write<int64_t>(sector.range.end_exclusive);
+      if (is_path_backed(type)) {
+         writer.write_null_terminated_string(sector.source.path);
+         writer.write<int64_t>(sector.source.offset);
+         writer.write<int64_t>(length);
+      } else if (type == vfm_inline_sector::kGuid) {
+         writer.write<int64_t>(length);
+         writer.write_bytes(inline_bytes_of(sector), static_cast<size_t>(length));
+      } else if (type == vfm_zero_sector::kGuid) {
+         writer.write<int64_t>(length);
+      } else {
+         throw std::runtime_error("vfm sector type not supported");
+      }
+   }
+   return result;
+}
+
+std::vector<uint8_t> vfm_writer::write_v2(const vfm_sector_collection& sectors) {
+   vfm_v2_builder builder;
+   for (auto& pair : sectors) {
+      auto& sector = pair.second;
+      auto& type = sector.source.type;
+      vfm_v2_builder::sector_description description = {};
+      memcpy(description.type, type.data, GUID_LENGTH);
+      description.start_inclusive = sector.range.start_inclusive;
+      description.end_exclusive = sector.range.end_exclusive;
+      if (is_path_backed(type)) {
+         description.path = sector.source.path;
+         description.source_offset = sector.source.offset;
+      } else if (type == vfm_inline_sector::kGuid) {
+         description.source_offset = builder.add_payload(inline_bytes_of(sector), static_cast<size_t>(sector.range.size()));
+      } else if (type != vfm_zero_sector::kGuid) {
+         throw std::runtime_error("vfm sector type not supported");
+      }
+      builder.add_sector(std::move(description));
+   }
+   return builder.build();
+}
+
+void vfm_writer::save(const std::string& path, const std::vector<uint8_t>& bytes) {
+   std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+   stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+   stream.close();
+   if (!stream) {
+      throw std::runtime_error("failed to write vfm " + path);
+   }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vfm_sector_collection.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Serializes sector collections into the formats vfm_reader loads.  write_v1 produces the
+   /// same bytes as the linker's SectorCollectionSerializer: the collection magic, a uint32
+   /// sector count, then per sector its type guid, int64 range and the type's own fields, all
+   /// little-endian.  write_v2 produces a v2 image (see vfm_format_v2.hpp).
+   /// </summary>
+   class vfm_writer {
+   public:
+      static std::vector<uint8_t> write_v1(const vfm_sector_collection& sectors);
+      static std::vector<uint8_t> write_v2(const vfm_sector_collection& sectors);
+
+      // Writes bytes to path, replacing it. Throws std::runtime_error on failure.
+      static void save(const std::string& path, const std::vector<uint8_t>& bytes);
+   };
+}
@@ -0,0 +1,30 @@
+#include "dlc_pch.hpp"
+#include <cstring>
+#include "binary_reader.hpp"
+#include "vfm_zero_sector.hpp"
+
+using namespace dargon;
+
+const dargon::guid vfm_zero_sector::kGuid(guid::parse("12CFF9C8963B4AF4AF26542A56ED419F"));
+
+vfm_zero_sector::vfm_zero_sector() : length(0) {
+}
+
+vfm_zero_sector::vfm_zero_sector(int64_t length) : length(length) {
+}
+
+int64_t vfm_zero_sector::size() {
+   return length;
+}
+
+void vfm_zero_sector::read(int64_t read_offset, int64_t read_length, uint8_t * buffer, int32_t buffer_offset) {
+   memset(buffer + buffer_offset, 0, static_cast<size_t>(read_length));
+}
+
+void vfm_zero_sector::deserialize(dargon::binary_reader & reader) {
+   length = reader.read_int64();
+}
+
+std::string vfm_zero_sector::to_string() {
+   return "[vfm_zero_sector len = " + std::to_string(length) + " ]";
+}
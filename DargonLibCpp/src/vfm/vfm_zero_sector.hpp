@@ -0,0 +1,26 @@
+#pragma once
+
+#include "vfm_sector.hpp"
+
+namespace dargon {
+   /// <summary>
+   /// Sector that reads as zeroes, for padding and sparse regions of a virtual file.  Nothing
+   /// is stored but its length, serialized as an int64.
+   /// </summary>
+   class vfm_zero_sector : public vfm_sector {
+   public:
+      static const dargon::guid kGuid;
+
+   private:
+      int64_t length;
+
+   public:
+      vfm_zero_sector();
+      vfm_zero_sector(int64_t length);
+
+      virtual int64_t size() override;
+      virtual void read(int64_t read_offset, int64_t read_length, uint8_t* buffer, int32_t buffer_offset) override;
+      virtual void deserialize(dargon::binary_reader& reader) override;
+      virtual std::string to_string() override;
+   };
+}